@@ -0,0 +1,398 @@
+#include <iostream>
+#include <cmath>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <common/shader.hpp>
+#include <common/texture.hpp>
+#include <common/maths.hpp>
+#include <common/camera.hpp>
+#include <common/model.hpp>
+#include <common/light.hpp>
+#include <common/viewbuffer.hpp>
+#include <common/assetloader.hpp>
+#include <common/texturebatch.hpp>
+#include <common/textureuploader.hpp>
+
+// Function prototypes
+void keyboardInput(GLFWwindow *window);
+void mouseInput(GLFWwindow *window);
+
+// Frame timers
+float previousTime = 0.0f;  // time of previous iteration of the loop
+float deltaTime    = 0.0f;  // time elapsed since the previous frame
+
+// Create camera object
+Camera camera(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f));
+
+// Object struct
+struct Object
+{
+    glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
+    glm::vec3 rotation = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 scale    = glm::vec3(1.0f, 1.0f, 1.0f);
+    float angle = 0.0f;
+    std::string name;
+};
+
+int main( void )
+{
+    // =========================================================================
+    // Window creation - you shouldn't need to change this code
+    // -------------------------------------------------------------------------
+    // Initialise GLFW
+    if( !glfwInit() )
+    {
+        fprintf( stderr, "Failed to initialize GLFW\n" );
+        getchar();
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_SAMPLES, 4);
+    glfwWindowHint(GLFW_RESIZABLE,GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    // Open a window and create its OpenGL context
+    GLFWwindow* window;
+    window = glfwCreateWindow(1024, 768, "Asset Streaming Demo", NULL, NULL);
+    
+    if( window == NULL ){
+        fprintf(stderr, "Failed to open GLFW window.\n");
+        getchar();
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+
+    // Initialize GLEW
+    glewExperimental = true; // Needed for core profile
+    if (glewInit() != GLEW_OK) {
+        fprintf(stderr, "Failed to initialize GLEW\n");
+        getchar();
+        glfwTerminate();
+        return -1;
+    }
+    // -------------------------------------------------------------------------
+    // End of window creation
+    // =========================================================================
+    
+    // Enable depth test
+    glEnable(GL_DEPTH_TEST);
+    
+    // Use back face culling
+    glEnable(GL_CULL_FACE);
+    
+    // Ensure we can capture keyboard inputs
+    glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
+    
+    // Capture mouse inputs
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    glfwPollEvents();
+    glfwSetCursorPos(window, 1024 / 2, 768 / 2);
+    
+    // Start compiling the shader programs, which the driver can do while
+    // the models load
+    ShaderBatch shaderBatch;
+    ProgramFuture shader      = shaderBatch.add("vertexShader.glsl", "fragmentShader.glsl");
+    ProgramFuture lightShader = shaderBatch.add("lightVertexShader.glsl", "lightFragmentShader.glsl");
+    
+    // Load models using the compact vertex format decoded by vertexShader.glsl
+    ModelSettings settings;
+    settings.format = VertexFormat::Compact;
+    settings.optimize = true;
+    settings.residency = Residency::Drop;
+    settings.compressTextures = true;
+    
+    // Stream texture levels a few megabytes a frame instead of all at once,
+    // only as sharp as the objects are on screen and within 64 MB
+    TextureResidency residency;
+    residency.onDemand    = true;
+    residency.budgetBytes = 64u << 20;
+    TextureUploader::global().setResidency(residency);
+    TextureCache::global().setUploader(&TextureUploader::global());
+    Model sphere("../assets/sphere.obj", settings);
+    
+    // Load the teapot in the background, drawing the sphere until it's ready
+    AssetLoader loader;
+    std::shared_ptr<Model> teapot = loader.loadModel("../assets/teapot.obj", settings, &sphere);
+    
+    // Load the textures, packing the specular map into the diffuse map's
+    // alpha so the fragment shader samples two textures instead of three
+    loader.addMaterial(teapot, "../assets/blue.bmp", "../assets/neutral_specular.png",
+                       "../assets/diamond_normal.png");
+    
+    
+    // Define teapot object lighting properties
+    teapot->ka = 0.2f;
+    teapot->kd = 0.7f;
+    teapot->ks = 1.0f;
+    teapot->Ns = 20.0f;
+    
+    // Add light sources
+    Light lightSources;
+    lightSources.addPointLight(glm::vec3(2.0f, 2.0f, 2.0f),         // position
+                               glm::vec3(1.0f, 1.0f, 1.0f),         // colour
+                               1.0f, 0.1f, 0.02f);                  // attenuation
+    
+    lightSources.addPointLight(glm::vec3(1.0f, 1.0f, -8.0f),        // position
+                               glm::vec3(1.0f, 1.0f, 1.0f),         // colour
+                               1.0f, 0.1f, 0.02f);                  // attenuation
+    
+    lightSources.addSpotLight(glm::vec3(0.0f, 3.0f, 0.0f),          // position
+                              glm::vec3(0.0f, -1.0f, 0.0f),         // direction
+                              glm::vec3(1.0f, 1.0f, 1.0f),          // colour
+                              1.0f, 0.1f, 0.02f,                    // attenuation
+                              std::cos(Maths::radians(45.0f)));     // cos(phi)
+    
+    lightSources.addDirectionalLight(glm::vec3(1.0f, -1.0f, 0.0f),  // direction
+                                     glm::vec3(1.0f, 1.0f, 0.0f));  // colour
+    
+    // Teapot positions
+    glm::vec3 teapotPositions[] = {
+        glm::vec3( 0.0f,  0.0f,  0.0f),
+        glm::vec3( 2.0f,  5.0f, -10.0f),
+        glm::vec3(-3.0f, -2.0f, -3.0f),
+        glm::vec3(-4.0f, -2.0f, -8.0f),
+        glm::vec3( 2.0f,  2.0f, -6.0f),
+        glm::vec3(-4.0f,  3.0f, -8.0f),
+        glm::vec3( 0.0f, -2.0f, -5.0f),
+        glm::vec3( 4.0f,  2.0f, -4.0f),
+        glm::vec3( 2.0f,  0.0f, -2.0f),
+        glm::vec3(-1.0f,  1.0f, -2.0f)
+    };
+
+    // Add teapots to objects vector
+    std::vector<Object> objects;
+    Object object;
+    object.name = "teapot";
+    for (unsigned int i = 0 ; i < 10 ; i++)
+    {
+        object.position = teapotPositions[i];
+        object.rotation = glm::vec3(1.0f, 1.0f, 1.0f);
+        object.scale    = glm::vec3(0.75f, 0.75f, 0.75f);
+        object.angle    = Maths::radians(20.0f * i);
+        objects.push_back(object);
+    }
+
+    // Load a 2D plane model for the floor and start decoding its textures,
+    // along with the wall's below, in parallel
+    TextureBatch textureBatch;
+    Model floor("../assets/plane.obj", settings);
+    textureBatch.addMaterial(floor, "../assets/stones_diffuse.png", "../assets/stones_specular.png",
+                             "../assets/stones_normal.png");
+
+    // Define floor light properties
+    floor.ka = 0.2f;
+    floor.kd = 1.0f;
+    floor.ks = 1.0f;
+    floor.Ns = 20.0f;
+
+    // Add floor model to objects vector
+    object.position = glm::vec3(0.0f, -0.85f, 0.0f);
+    object.scale = glm::vec3(1.0f, 1.0f, 1.0f);
+    object.rotation = glm::vec3(0.0f, 1.0f, 0.0f);
+    object.angle = 0.0f;
+    object.name = "floor";
+    objects.push_back(object);
+
+    // Exercise 1
+    // Load the wall model
+    Model wall("../assets/plane.obj", settings);
+    textureBatch.addMaterial(wall, "../assets/bricks_diffuse.png", "../assets/bricks_specular.png",
+                             "../assets/bricks_normal.png");
+    
+    // Upload the floor and wall textures
+    textureBatch.upload();
+    textureBatch.printStats();
+
+    wall.ka = 0.2f;
+    wall.kd = 1.0f;
+    wall.ks = 1.0f;
+    wall.Ns = 20.0f;
+
+    object.position = glm::vec3(0.0f, 4.0f, -5.0f);
+    object.scale = glm::vec3(5.0f, 1.0f, 5.0f);
+    object.rotation = glm::vec3(1.0f, 0.0f, 0.0f);
+    object.angle = Maths::radians(90.0f);
+    object.name = "wall";
+    objects.push_back(object);
+    
+    // Frustum culling of the objects
+    CullingBatch culling;
+    CullingStats cullingTotal;
+    std::vector<glm::mat4> models(objects.size());
+    
+    // Wait for the shader programs
+    GLProgram program      = shader.get();
+    GLProgram lightProgram = lightShader.get();
+    unsigned int shaderID      = program.get();
+    unsigned int lightShaderID = lightProgram.get();
+    
+    // Activate shader
+    glUseProgram(shaderID);
+    
+    // Uniforms sent every frame, resolved once
+    ShaderProgram &shaderProgram = ShaderProgram::get(shaderID);
+    Uniform MUniform("M");
+    
+    // Camera matrices shared by both programs
+    ViewBuffer viewBuffer;
+    
+    // Render loop
+    while (!glfwWindowShouldClose(window))
+    {
+        // Update timer
+        float time   = glfwGetTime();
+        deltaTime    = time - previousTime;
+        previousTime = time;
+        
+        // Upload assets that have finished loading
+        loader.update(2.0f);
+        TextureUploader::global().update();
+        
+        // Get inputs
+        keyboardInput(window);
+        mouseInput(window);
+        
+        // Clear the window
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        
+        // Calculate view and projection matrices
+        camera.target = camera.eye + camera.front;
+        camera.calculateMatrices();
+        viewBuffer.update(camera);
+        
+        // Calculate the model matrices and cull the objects outside the view
+        // frustum before drawing
+        culling.clear();
+        for (unsigned int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
+        {
+            glm::mat4 translate = Maths::translate(objects[i].position);
+            glm::mat4 scale     = Maths::scale(objects[i].scale);
+            glm::mat4 rotate    = Maths::rotate(objects[i].angle, objects[i].rotation);
+            models[i] = translate * rotate * scale;
+            
+            // The sphere is drawn in place of the teapot until it has loaded
+            const Bounds &bounds = objects[i].name == "floor" ? floor.bounds :
+                                   objects[i].name == "wall"  ? wall.bounds  :
+                                   teapot->isReady() ? teapot->bounds : sphere.bounds;
+            culling.add(transformSphere(bounds, models[i]));
+        }
+        culling.cull(Frustum(viewBuffer.block.viewProjection));
+        cullingTotal.add(culling.stats);
+        
+        // Activate shader
+        glUseProgram(shaderID);
+        
+        // Send light source properties to the shader
+        lightSources.toShader(shaderID, camera.view());
+        
+        // Loop through the visible objects
+        for (unsigned int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
+        {
+            if (!culling.visible[i])
+                continue;
+            const glm::mat4 &model = models[i];
+            
+            // Send the model matrix to the vertex shader, the camera's are in
+            // the view buffer
+            shaderProgram.set(MUniform, model);
+            
+            // Ask for the texture levels the model needs at its size on screen
+            if (objects[i].name == "teapot" && teapot->isReady())
+                teapot->requestTextures(TextureUploader::global(), camera, model);
+            
+            if (objects[i].name == "floor")
+                floor.requestTextures(TextureUploader::global(), camera, model);
+            
+            if (objects[i].name == "wall")
+                wall.requestTextures(TextureUploader::global(), camera, model);
+            
+            // Draw the model
+            if (objects[i].name == "teapot")
+                teapot->draw(shaderID);
+
+            if (objects[i].name == "floor")
+                floor.draw(shaderID);
+
+            if (objects[i].name == "wall")
+                wall.draw(shaderID);
+        }
+        
+        // Draw light sources
+        lightSources.draw(lightShaderID, sphere);
+        
+        // Swap buffers
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+    
+    // Texture cache counters
+    TextureCacheStats textureStats = TextureCache::global().stats();
+    printf("Texture cache: %zu hits, %zu misses, %zu textures using %.1f MB\n", textureStats.hits,
+           textureStats.misses, textureStats.textures, textureStats.bytes / (1024.0 * 1024.0));
+    const TextureUploadStats &uploadStats = TextureUploader::global().stats();
+    printf("Texture streaming: %.1f MB in %zu copies over %zu frames, peak %.1f MB a frame, %zu stalls, %.1f ms\n",
+           uploadStats.bytes / (1024.0 * 1024.0), uploadStats.copies, uploadStats.frames,
+           uploadStats.peakBytes / (1024.0 * 1024.0), uploadStats.stalls, uploadStats.milliseconds);
+    printf("Texture residency: %.1f MB resident, %zu levels dropped\n",
+           uploadStats.resident / (1024.0 * 1024.0), uploadStats.dropped);
+    
+    // Culling counters
+    printf("Frustum culling: %zu objects tested, %zu culled, %.3f ms\n",
+           cullingTotal.tested, cullingTotal.culled, cullingTotal.milliseconds);
+    
+    // Cleanup
+    teapot->deleteBuffers();
+    lightSources.deleteBuffers();
+    viewBuffer.deleteBuffers();
+    program.reset();
+    lightProgram.reset();
+    
+    // GL objects still held, e.g. by the texture cache, go with the context
+    releaseGLContext();
+    
+    // Close OpenGL window and terminate GLFW
+    glfwTerminate();
+    return 0;
+}
+
+void keyboardInput(GLFWwindow *window)
+{
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, true);
+    
+    // Move the camera using WSAD keys
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.eye += 5.0f * deltaTime * camera.front;
+
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.eye -= 5.0f * deltaTime * camera.front;
+
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.eye -= 5.0f * deltaTime * camera.right;
+
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.eye += 5.0f * deltaTime * camera.right;
+}
+
+void mouseInput(GLFWwindow *window)
+{
+    // Get mouse cursor position and reset to centre
+    double xPos, yPos;
+    glfwGetCursorPos(window, &xPos, &yPos);
+    glfwSetCursorPos(window, 1024 / 2, 768 / 2);
+    
+    // Update yaw and pitch angles
+    camera.yaw   += 0.005f * float(xPos - 1024 / 2);
+    camera.pitch += 0.005f * float(768 / 2 - yPos);
+    
+    // Calculate camera vectors from the yaw and pitch angles
+    camera.calculateCameraVectors();
+}
+
@@ -0,0 +1,24 @@
+#version 330 core
+
+// Inputs
+layout(location = 0) in vec3 position;
+
+// Uniforms
+uniform mat4 M;
+
+// Camera matrices, shared by every program
+layout(std140) uniform View
+{
+    mat4 V;
+    mat4 P;
+    mat4 VP;
+    mat4 invV;
+    mat4 invP;
+    mat4 invVP;
+};
+
+void main()
+{
+    // Output vertex postion
+    gl_Position = VP * (M * vec4(position, 1.0));
+}
@@ -150,7 +150,8 @@ int main( void )
     glGenVertexArrays(1, &VAO);
     glBindVertexArray(VAO);
 
-    unsigned int shaderID = LoadShaders("vertexShader.glsl","fragmentShader.glsl");
+    GLProgram shader = LoadShaders("vertexShader.glsl","fragmentShader.glsl");
+    unsigned int shaderID = shader.get();
 
     glUseProgram(shaderID);
 
@@ -205,7 +206,7 @@ int main( void )
 
     glDeleteBuffers(1, &VBO);
     glDeleteVertexArrays(1, &VAO);
-    glDeleteProgram(shaderID);
+    shader.reset();
     
 	// Close OpenGL window and terminate GLFW
 	glfwTerminate();
@@ -122,8 +122,8 @@ int main( void )
     glBufferData(GL_ARRAY_BUFFER, sizeof(uv), uv, GL_STATIC_DRAW);
 
     // Compile shader program
-    unsigned int shaderID;
-    shaderID = LoadShaders("vertexShader.glsl", "fragmentShader.glsl");
+    GLProgram shader = LoadShaders("vertexShader.glsl", "fragmentShader.glsl");
+    unsigned int shaderID = shader.get();
 
     // Use the shader program
     glUseProgram(shaderID);
@@ -208,7 +208,7 @@ int main( void )
     // Cleanup
     glDeleteBuffers(1, &VBO);
     glDeleteVertexArrays(1, &VAO);
-    glDeleteProgram(shaderID);
+    shader.reset();
     
 	// Close OpenGL window and terminate GLFW
 	glfwTerminate();
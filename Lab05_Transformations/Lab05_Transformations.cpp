@@ -116,8 +116,8 @@ int main( void )
                  GL_STATIC_DRAW);
     
     // Compile shader program
-    unsigned int shaderID;
-    shaderID = LoadShaders("vertexShader.glsl", "fragmentShader.glsl");
+    GLProgram shader = LoadShaders("vertexShader.glsl", "fragmentShader.glsl");
+    unsigned int shaderID = shader.get();
     
     // Load the textures
     unsigned int texture;
@@ -240,7 +240,7 @@ int main( void )
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
     glDeleteBuffers(1, &uvBuffer);
-    glDeleteProgram(shaderID);
+    shader.reset();
     
     // Close OpenGL window and terminate GLFW
     glfwTerminate();
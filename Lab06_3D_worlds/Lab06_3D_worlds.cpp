@@ -5,9 +5,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <common/shader.hpp>
+#include <common/shaderprogram.hpp>
 #include <common/texture.hpp>
 #include <common/maths.hpp>
 #include <common/camera.hpp>
+#include <common/culling.hpp>
 
 // Function prototypes
 void keyboardInput(GLFWwindow *window);
@@ -202,8 +204,8 @@ int main( void )
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
     
     // Compile shader program
-    unsigned int shaderID;
-    shaderID = LoadShaders("vertexShader.glsl", "fragmentShader.glsl");
+    GLProgram shader = LoadShaders("vertexShader.glsl", "fragmentShader.glsl");
+    unsigned int shaderID = shader.get();
     
     // Load the textures
     unsigned int texture;
@@ -214,6 +216,10 @@ int main( void )
     unsigned int textureID;
     textureID = glGetUniformLocation(shaderID, "texture");
     glUniform1i(textureID, 0);
+    
+    // The MVP matrix is sent for every object, so resolve it once
+    ShaderProgram &shaderProgram = ShaderProgram::get(shaderID);
+    Uniform MVPUniform("MVP");
 
     // Cube positions
     glm::vec3 positions[] = {
@@ -255,6 +261,14 @@ int main( void )
 		object.angle    = Maths::radians(20.0f * i);
 		objects.push_back(object);
     }
+    
+    // Bounds of the cube for frustum culling
+    Bounds cubeBounds = computeBounds(reinterpret_cast<const glm::vec3 *>(vertices),
+                                      sizeof(vertices) / (3 * sizeof(float)));
+    CullingBatch culling;
+    CullingStats cullingTotal;
+    std::vector<glm::mat4> models(objects.size());
+    
     // Render loop
     while (!glfwWindowShouldClose(window))
     {
@@ -310,8 +324,10 @@ int main( void )
         //exercise 2
         //float currentTime = glfwGetTime();
 
-        // Loop through cubes and draw them
-        for (int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
+        // Calculate the model matrices and cull the cubes outside the view
+        // frustum before drawing
+        culling.clear();
+        for (unsigned int i = 0; i < objects.size(); i++)
         {
             // Calculate the model matrix
             glm::mat4 translate = Maths::translate(objects[i].position);
@@ -329,13 +345,23 @@ int main( void )
             //else
             //    rotate = Maths::rotate(objects[i].angle, objects[i].rotation);
 
-            glm::mat4 model     = translate * rotate * scale;
+            models[i] = translate * rotate * scale;
+            culling.add(transformSphere(cubeBounds, models[i]));
+        }
+        culling.cull(Frustum(camera.projection() * camera.view()));
+        cullingTotal.add(culling.stats);
+
+        // Loop through cubes and draw the visible ones
+        for (int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
+        {
+            if (!culling.visible[i])
+                continue;
 
             // Calculate the MVP matrix
-            glm::mat4 MVP = camera.projection * camera.view * model;
+            glm::mat4 MVP = camera.projection() * camera.view() * models[i];
 
             // Send the MVP matrix to the vertex shader
-            glUniformMatrix4fv(glGetUniformLocation(shaderID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
+            shaderProgram.set(MVPUniform, MVP);
 
             //Draw the triangles
             glBindTexture(GL_ELEMENT_ARRAY_BUFFER, EBO);
@@ -358,12 +384,16 @@ int main( void )
         glfwPollEvents();
     }
     
+    // Culling counters
+    printf("Frustum culling: %zu objects tested, %zu culled, %.3f ms\n",
+           cullingTotal.tested, cullingTotal.culled, cullingTotal.milliseconds);
+    
     // Cleanup
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
     glDeleteBuffers(1, &uvBuffer);
-    glDeleteProgram(shaderID);
+    shader.reset();
     
     // Close OpenGL window and terminate GLFW
     glfwTerminate();
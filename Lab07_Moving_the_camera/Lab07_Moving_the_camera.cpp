@@ -4,9 +4,11 @@
 #include <GLFW/glfw3.h>
 
 #include <common/shader.hpp>
+#include <common/shaderprogram.hpp>
 #include <common/texture.hpp>
 #include <common/maths.hpp>
 #include <common/camera.hpp>
+#include <common/culling.hpp>
 
 // Function prototypes
 void keyboardInput(GLFWwindow *window);
@@ -221,8 +223,8 @@ int main( void )
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
     
     // Compile shader program
-    unsigned int shaderID;
-    shaderID = LoadShaders("vertexShader.glsl", "fragmentShader.glsl");
+    GLProgram shader = LoadShaders("vertexShader.glsl", "fragmentShader.glsl");
+    unsigned int shaderID = shader.get();
     
     // Load the textures
     unsigned int texture;
@@ -234,6 +236,10 @@ int main( void )
     textureID = glGetUniformLocation(shaderID, "texture");
     glUniform1i(textureID, 0);
     
+    // The MVP matrix is sent for every object, so resolve it once
+    ShaderProgram &shaderProgram = ShaderProgram::get(shaderID);
+    Uniform MVPUniform("MVP");
+    
     // Cube positions
     glm::vec3 positions[] = {
         glm::vec3( 0.0f,  0.0f,  0.0f),
@@ -261,6 +267,13 @@ int main( void )
         objects.push_back(object);
     }
     
+    // Bounds of the cube for frustum culling
+    Bounds cubeBounds = computeBounds(reinterpret_cast<const glm::vec3 *>(vertices),
+                                      sizeof(vertices) / (3 * sizeof(float)));
+    CullingBatch culling;
+    CullingStats cullingTotal;
+    std::vector<glm::mat4> models(objects.size());
+    
     // Render loop
     while (!glfwWindowShouldClose(window))
     {
@@ -321,21 +334,31 @@ int main( void )
         // Calculate view and projection matrices
         camera.calculateMatrices();
         
-        // Loop through objects and draw each one
-        for (int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
+        // Calculate the model matrices and cull the objects outside the view
+        // frustum before drawing
+        culling.clear();
+        for (unsigned int i = 0; i < objects.size(); i++)
         {
-            // Calculate the model matrix
             glm::mat4 translate = Maths::translate(objects[i].position);
             glm::mat4 scale     = Maths::scale(objects[i].scale);
             glm::mat4 rotate    = Maths::rotate(objects[i].angle, objects[i].rotation);
-            glm::mat4 model     = translate * rotate * scale;
+            models[i] = translate * rotate * scale;
+            culling.add(transformSphere(cubeBounds, models[i]));
+        }
+        culling.cull(Frustum(camera.projection() * camera.view()));
+        cullingTotal.add(culling.stats);
+        
+        // Loop through objects and draw the visible ones
+        for (int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
+        {
+            if (!culling.visible[i])
+                continue;
 
             // Calculate the MVP matrix
-            glm::mat4 MVP = camera.projection * camera.view * model;
+            glm::mat4 MVP = camera.projection() * camera.view() * models[i];
 
             // Send MVP matrix to the vertex shader
-            unsigned int MVPID = glGetUniformLocation(shaderID, "MVP");
-            glUniformMatrix4fv(MVPID, 1, GL_FALSE, &MVP[0][0]);
+            shaderProgram.set(MVPUniform, MVP);
 
             // Draw the triangles
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
@@ -350,12 +373,16 @@ int main( void )
         glfwPollEvents();
     }
     
+    // Culling counters
+    printf("Frustum culling: %zu objects tested, %zu culled, %.3f ms\n",
+           cullingTotal.tested, cullingTotal.culled, cullingTotal.milliseconds);
+    
     // Cleanup
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
     glDeleteBuffers(1, &uvBuffer);
-    glDeleteProgram(shaderID);
+    shader.reset();
     
     // Close OpenGL window and terminate GLFW
     glfwTerminate();
@@ -9,6 +9,7 @@
 #include <common/maths.hpp>
 #include <common/camera.hpp>
 #include <common/model.hpp>
+#include <common/viewbuffer.hpp>
 
 // Function prototypes
 void keyboardInput(GLFWwindow *window);
@@ -105,17 +106,17 @@ int main( void )
     glfwPollEvents();
     glfwSetCursorPos(window, 1024 / 2, 768 / 2);
     
-    // Compile shader program
-    unsigned int shaderID, lightShaderID;
-    //shaderID      = LoadShaders("vertexShader.glsl", "fragmentShader.glsl");
-    shaderID = LoadShaders("vertexShader.glsl", "multipleLightsFragmentShader.glsl");
-    lightShaderID = LoadShaders("lightVertexShader.glsl", "lightFragmentShader.glsl");
+    // Start compiling the shader programs, which the driver can do while
+    // the models load
+    ShaderBatch shaderBatch;
+    //ProgramFuture shader      = shaderBatch.add("vertexShader.glsl", "fragmentShader.glsl");
+    ProgramFuture shader      = shaderBatch.add("vertexShader.glsl", "multipleLightsFragmentShader.glsl");
+    ProgramFuture lightShader = shaderBatch.add("lightVertexShader.glsl", "lightFragmentShader.glsl");
     
-    // Activate shader
-    glUseProgram(shaderID);
-    
-    // Load models
-    Model teapot("../assets/teapot.obj");
+    // Load models, with levels of detail for the teapots
+    ModelSettings teapotSettings;
+    teapotSettings.lodLevels = 4;
+    Model teapot("../assets/teapot.obj", teapotSettings);
     Model sphere("../assets/sphere.obj");
     
     // Load the textures
@@ -191,6 +192,37 @@ int main( void )
         objects.push_back(object);
     }
     
+    // Frustum culling of the teapots and light sources
+    CullingBatch culling;
+    CullingStats cullingTotal;
+    std::vector<glm::mat4> models;
+    
+    // Wait for the shader programs
+    GLProgram program      = shader.get();
+    GLProgram lightProgram = lightShader.get();
+    unsigned int shaderID      = program.get();
+    unsigned int lightShaderID = lightProgram.get();
+    
+    // Activate shader
+    glUseProgram(shaderID);
+    
+    // Uniforms sent every frame, resolved once
+    ShaderProgram &shaderProgram      = ShaderProgram::get(shaderID);
+    ShaderProgram &lightShaderProgram = ShaderProgram::get(lightShaderID);
+    Uniform MUniform("M"), lightColourUniform("lightColour");
+    Uniform kaUniform("ka"), kdUniform("kd"), ksUniform("ks"), NsUniform("Ns");
+    
+    // Camera matrices shared by both programs
+    ViewBuffer viewBuffer;
+    
+    // The fields of each light source, in the order they are sent
+    const char *lightFields[] = { "colour", "position", "constant", "linear",
+                                  "quadratic", "type", "direction", "cosPhi" };
+    std::vector<Uniform> lightUniforms;
+    for (unsigned int i = 0; i < static_cast<unsigned int>(lightSources.size()); i++)
+        for (unsigned int j = 0; j < 8; j++)
+            lightUniforms.push_back(Uniform("lightSources[" + std::to_string(i) + "]." + lightFields[j]));
+    
     // Render loop
     while (!glfwWindowShouldClose(window))
     {
@@ -249,29 +281,30 @@ int main( void )
         // Send multiple light source properties to the shader
         for (unsigned int i = 0; i < static_cast<unsigned int>(lightSources.size()); i++)
         {
-            glm::vec3 viewSpaceLightPosition = glm::vec3(camera.view * glm::vec4(lightSources[i].position, 1.0f));
-            std::string idx = std::to_string(i);
-            glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].colour").c_str()), 1, &lightSources[i].colour[0]);
-            glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].position").c_str()), 1, &viewSpaceLightPosition[0]);
-            glUniform1f(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].constant").c_str()), lightSources[i].constant);
-            glUniform1f(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].linear").c_str()), lightSources[i].linear);
-            glUniform1f(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].quadratic").c_str()), lightSources[i].quadratic);
-            glUniform1i(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].type").c_str()), lightSources[i].type);
-            glm::vec3 viewSpaceLightDirection = glm::vec3(camera.view * glm::vec4(lightSources[i].direction, 0.0f));
-            glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].direction").c_str()), 1, &viewSpaceLightDirection[0]);
-            glUniform1f(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].cosPhi").c_str()), lightSources[i].cosPhi);
+            glm::vec3 viewSpaceLightPosition = glm::vec3(camera.view() * glm::vec4(lightSources[i].position, 1.0f));
+            const Uniform *uniforms = &lightUniforms[8 * i];
+            shaderProgram.set(uniforms[0], lightSources[i].colour);
+            shaderProgram.set(uniforms[1], viewSpaceLightPosition);
+            shaderProgram.set(uniforms[2], lightSources[i].constant);
+            shaderProgram.set(uniforms[3], lightSources[i].linear);
+            shaderProgram.set(uniforms[4], lightSources[i].quadratic);
+            shaderProgram.set(uniforms[5], static_cast<int>(lightSources[i].type));
+            glm::vec3 viewSpaceLightDirection = glm::vec3(camera.view() * glm::vec4(lightSources[i].direction, 0.0f));
+            shaderProgram.set(uniforms[6], viewSpaceLightDirection);
+            shaderProgram.set(uniforms[7], lightSources[i].cosPhi);
 
         }
 
         // Send object lighting properties to the fragment shader
-        glUniform1f(glGetUniformLocation(shaderID, "ka"), teapot.ka);
-        glUniform1f(glGetUniformLocation(shaderID, "kd"), teapot.kd);
-        glUniform1f(glGetUniformLocation(shaderID, "ks"), teapot.ks);
-        glUniform1f(glGetUniformLocation(shaderID, "Ns"), teapot.Ns);
+        shaderProgram.set(kaUniform, teapot.ka);
+        shaderProgram.set(kdUniform, teapot.kd);
+        shaderProgram.set(ksUniform, teapot.ks);
+        shaderProgram.set(NsUniform, teapot.Ns);
         
         // Calculate view and projection matrices
         camera.target = camera.eye + camera.front;
         camera.calculateMatrices();
+        viewBuffer.update(camera);
 
         // Calculate the model matrix
         //glm::mat4 translate;
@@ -279,23 +312,41 @@ int main( void )
         //glm::mat4 rotate;
         //glm::mat4 model = translate * rotate * scale;
 
-        // Loop through objects
-        for (int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
+        // Calculate the model matrices of the teapots then the light sources
+        // and cull the ones outside the view frustum before drawing
+        culling.clear();
+        models.clear();
+        for (unsigned int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
         {
-            // Calculate model matrix
             glm::mat4 translate = Maths::translate(objects[i].position);
             glm::mat4 scale = Maths::scale(objects[i].scale);
             glm::mat4 rotate = Maths::rotate(objects[i].angle, objects[i].rotation);
-            glm::mat4 model = translate * rotate * scale;
+            models.push_back(translate * rotate * scale);
+            culling.add(transformSphere(teapot.bounds, models.back()));
+        }
+        for (unsigned int i = 0; i < static_cast<unsigned int>(lightSources.size()); i++)
+        {
+            glm::mat4 translate = Maths::translate(lightSources[i].position);
+            glm::mat4 scale = Maths::scale(glm::vec3(0.1f));
+            models.push_back(translate * scale);
+            culling.add(transformSphere(sphere.bounds, models.back()));
+        }
+        culling.cull(Frustum(viewBuffer.block.viewProjection));
+        cullingTotal.add(culling.stats);
 
-            // Send the MVP and MV matrices to the vertex shader
-            glm::mat4 MV = camera.view * model;
-            glm::mat4 MVP = camera.projection * MV;
-            glUniformMatrix4fv(glGetUniformLocation(shaderID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
-            glUniformMatrix4fv(glGetUniformLocation(shaderID, "MV"), 1, GL_FALSE, &MV[0][0]);
+        // Loop through objects
+        for (int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
+        {
+            if (!culling.visible[i])
+                continue;
+            const glm::mat4 &model = models[i];
+
+            // Send the model matrix to the vertex shader, the camera's are in
+            // the view buffer
+            shaderProgram.set(MUniform, model);
 
-            // Draw the model
-            teapot.draw(shaderID);
+            // Draw the model at the level of detail for its distance
+            teapot.draw(shaderID, teapot.selectLod(camera, model));
         }
 
         // ---------------------------------------------------------------------
@@ -320,17 +371,14 @@ int main( void )
         
         for (unsigned int i = 0; i < static_cast<unsigned int>(lightSources.size()); i++)
         {
-            // Calculate model matrix
-            glm::mat4 translate = Maths::translate(lightSources[i].position);
-            glm::mat4 scale = Maths::scale(glm::vec3(0.1f));
-            glm::mat4 model = translate * scale;
+            if (!culling.visible[objects.size() + i])
+                continue;
 
-            // Send the MVP and MV matrices to the vertex shader
-            glm::mat4 MVP = camera.projection * camera.view * model;
-            glUniformMatrix4fv(glGetUniformLocation(lightShaderID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
+            // Send the model matrix to the vertex shader
+            lightShaderProgram.set(MUniform, models[objects.size() + i]);
 
             // Send model, view, projection matrices and light colour to light shader
-            glUniform3fv(glGetUniformLocation(lightShaderID, "lightColour"), 1, &lightSources[i].colour[0]);
+            lightShaderProgram.set(lightColourUniform, lightSources[i].colour);
 
             // Draw light source
             sphere.draw(lightShaderID);
@@ -343,9 +391,18 @@ int main( void )
         glfwPollEvents();
     }
     
+    // Culling counters
+    printf("Frustum culling: %zu objects tested, %zu culled, %.3f ms\n",
+           cullingTotal.tested, cullingTotal.culled, cullingTotal.milliseconds);
+    
     // Cleanup
     teapot.deleteBuffers();
-    glDeleteProgram(shaderID);
+    viewBuffer.deleteBuffers();
+    program.reset();
+    lightProgram.reset();
+    
+    // GL objects still held, e.g. by the texture cache, go with the context
+    releaseGLContext();
     
     // Close OpenGL window and terminate GLFW
     glfwTerminate();
@@ -11,18 +11,29 @@ out vec2 UV;
 out vec3 Normal;
 
 // Uniforms
-uniform mat4 MVP;
-uniform mat4 MV;
+uniform mat4 M;
+
+// Camera matrices, shared by every program
+layout(std140) uniform View
+{
+    mat4 V;
+    mat4 P;
+    mat4 VP;
+    mat4 invV;
+    mat4 invP;
+    mat4 invVP;
+};
 
 void main()
 {
     // Output vertex position
-    gl_Position = MVP * vec4(position, 1.0);
+    vec4 worldPosition = M * vec4(position, 1.0);
+    gl_Position = VP * worldPosition;
     
     // Output vertex colour
     UV = uv;
 
     // Output view space fragment position and normal vector
-    fragmentPosition = vec3(MV * vec4(position, 1.0));
-    Normal           = mat3(transpose(inverse(MV))) * normal;
+    fragmentPosition = vec3(V * worldPosition);
+    Normal           = transpose(inverse(mat3(V) * mat3(M))) * normal;
 }
@@ -31,10 +31,15 @@ uniform float ka;
 uniform float kd;
 uniform float ks;
 uniform float Ns;
-uniform Light lightSources[maxLights];
 uniform sampler2D normalMap;
 uniform sampler2D specularMap;
 
+// Light sources, shared by every lit program
+layout(std140) uniform Lights
+{
+    Light lightSources[maxLights];
+};
+
 // Function prototypes
 vec3 pointLight(vec3 lightPosition, vec3 lightColour,
                 float constant, float linear, float quadratic);
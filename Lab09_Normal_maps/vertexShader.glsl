@@ -30,20 +30,36 @@ struct Light
 };
 
 // Uniforms
-uniform mat4 MVP;
-uniform mat4 MV;
-uniform Light lightSources[maxLights];
+uniform mat4 M;
+
+// Camera matrices, shared by every program
+layout(std140) uniform View
+{
+    mat4 V;
+    mat4 P;
+    mat4 VP;
+    mat4 invV;
+    mat4 invP;
+    mat4 invVP;
+};
+
+// Light sources, shared by every lit program
+layout(std140) uniform Lights
+{
+    Light lightSources[maxLights];
+};
 
 void main()
 {
     // Output vertex position
-    gl_Position = MVP * vec4(position, 1.0);
+    vec4 worldPosition = M * vec4(position, 1.0);
+    gl_Position = VP * worldPosition;
     
     // Output texture co-ordinates
     UV = uv;
     
     // Calculate the TBN matrix that transforms view space to tangent space
-    mat3 invMV = transpose(inverse(mat3(MV)));
+    mat3 invMV = transpose(inverse(mat3(V) * mat3(M)));
     vec3 t     = normalize(invMV * tangent);
     vec3 n     = normalize(invMV * normal);
     t          = normalize(t - dot(t, n) * n); // Gram-Schmidt orthogonalization)
@@ -51,7 +67,7 @@ void main()
     mat3 TBN   = transpose(mat3(t, b, n));
 
     // Output tangent space fragment position, light positions and directions
-    fragmentPosition = TBN * vec3(MV * vec4(position, 1.0));
+    fragmentPosition = TBN * vec3(V * worldPosition);
     for (int i = 0; i < maxLights; i++)
     {
         tangentSpaceLightPosition[i]  = TBN * lightSources[i].position;
@@ -10,6 +10,7 @@
 #include <common/camera.hpp>
 #include <common/model.hpp>
 #include <common/light.hpp>
+#include <common/viewbuffer.hpp>
 
 // Function prototypes
 void keyboardInput(GLFWwindow *window);
@@ -90,17 +91,18 @@ int main( void )
     glfwPollEvents();
     glfwSetCursorPos(window, 1024 / 2, 768 / 2);
     
-    // Compile shader program
-    unsigned int shaderID, lightShaderID;
-    shaderID      = LoadShaders("vertexShader.glsl", "fragmentShader.glsl");
-    lightShaderID = LoadShaders("lightVertexShader.glsl", "lightFragmentShader.glsl");
+    // Start compiling the shader programs, which the driver can do while
+    // the models load
+    ShaderBatch shaderBatch;
+    ProgramFuture shader      = shaderBatch.add("vertexShader.glsl", "fragmentShader.glsl");
+    ProgramFuture lightShader = shaderBatch.add("lightVertexShader.glsl", "lightFragmentShader.glsl");
     
-    // Activate shader
-    glUseProgram(shaderID);
-    
-    // Load models
-    Model cube("../assets/cube.obj");
-    Model sphere("../assets/sphere.obj");
+    // Load models using the compact vertex format decoded by vertexShader.glsl
+    ModelSettings settings;
+    settings.format = VertexFormat::Compact;
+    settings.optimize = true;
+    Model cube("../assets/cube.obj", settings);
+    Model sphere("../assets/sphere.obj", settings);
     
     // Load the textures
     cube.addTexture("../assets/crate.jpg", "diffuse");
@@ -143,6 +145,27 @@ int main( void )
         objects.push_back(object);
     }
     
+    // Frustum culling of the objects
+    CullingBatch culling;
+    CullingStats cullingTotal;
+    std::vector<glm::mat4> models(objects.size());
+    
+    // Wait for the shader programs
+    GLProgram program      = shader.get();
+    GLProgram lightProgram = lightShader.get();
+    unsigned int shaderID      = program.get();
+    unsigned int lightShaderID = lightProgram.get();
+    
+    // Activate shader
+    glUseProgram(shaderID);
+    
+    // Uniforms sent every frame, resolved once
+    ShaderProgram &shaderProgram = ShaderProgram::get(shaderID);
+    Uniform MUniform("M");
+    
+    // Camera matrices shared by both programs
+    ViewBuffer viewBuffer;
+    
     // Render loop
     while (!glfwWindowShouldClose(window))
     {
@@ -161,30 +184,38 @@ int main( void )
         
         // Calculate view and projection matrices
         camera.quaternionCamera();
+        viewBuffer.update(camera);
+        
+        // Calculate the model matrices and cull the objects outside the view
+        // frustum before drawing
+        culling.clear();
+        for (unsigned int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
+        {
+            glm::mat4 translate = Maths::translate(objects[i].position);
+            glm::mat4 scale     = Maths::scale(objects[i].scale);
+            glm::mat4 rotate    = Maths::rotate(objects[i].angle, objects[i].rotation);
+            models[i] = translate * rotate * scale;
+            culling.add(transformSphere(cube.bounds, models[i]));
+        }
+        culling.cull(Frustum(viewBuffer.block.viewProjection));
+        cullingTotal.add(culling.stats);
         
         // Activate shader
         glUseProgram(shaderID);
         
         // Send light source properties to the shader
-        lightSources.toShader(shaderID, camera.view);
-        
-        // Send view matrix to the shader
-        glUniformMatrix4fv(glGetUniformLocation(shaderID, "V"), 1, GL_FALSE, &camera.view[0][0]);
+        lightSources.toShader(shaderID, camera.view());
         
-        // Loop through objects
+        // Loop through the visible objects
         for (unsigned int i = 0; i < static_cast<unsigned int>(objects.size()); i++)
         {
-            // Calculate model matrix
-            glm::mat4 translate = Maths::translate(objects[i].position);
-            glm::mat4 scale     = Maths::scale(objects[i].scale);
-            glm::mat4 rotate    = Maths::rotate(objects[i].angle, objects[i].rotation);
-            glm::mat4 model     = translate * rotate * scale;
+            if (!culling.visible[i])
+                continue;
+            const glm::mat4 &model = models[i];
             
-            // Send the MVP and MV matrices to the vertex shader
-            glm::mat4 MV  = camera.view * model;
-            glm::mat4 MVP = camera.projection * MV;
-            glUniformMatrix4fv(glGetUniformLocation(shaderID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
-            glUniformMatrix4fv(glGetUniformLocation(shaderID, "MV"), 1, GL_FALSE, &MV[0][0]);
+            // Send the model matrix to the vertex shader, the camera's are in
+            // the view buffer
+            shaderProgram.set(MUniform, model);
             
             // Draw the model
             if (objects[i].name == "cube")
@@ -192,16 +223,26 @@ int main( void )
         }
         
         // Draw light sources
-        lightSources.draw(lightShaderID, camera.view, camera.projection, sphere);
+        lightSources.draw(lightShaderID, sphere);
         
         // Swap buffers
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
     
+    // Culling counters
+    printf("Frustum culling: %zu objects tested, %zu culled, %.3f ms\n",
+           cullingTotal.tested, cullingTotal.culled, cullingTotal.milliseconds);
+    
     // Cleanup
     cube.deleteBuffers();
-    glDeleteProgram(shaderID);
+    lightSources.deleteBuffers();
+    viewBuffer.deleteBuffers();
+    program.reset();
+    lightProgram.reset();
+    
+    // GL objects still held, e.g. by the texture cache, go with the context
+    releaseGLContext();
     
     // Close OpenGL window and terminate GLFW
     glfwTerminate();
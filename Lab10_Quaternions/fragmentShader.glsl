@@ -32,7 +32,12 @@ uniform float ka;
 uniform float kd;
 uniform float ks;
 uniform float Ns;
-uniform Light lightSources[maxLights];
+
+// Light sources, shared by every lit program
+layout(std140) uniform Lights
+{
+    Light lightSources[maxLights];
+};
 
 // Function prototypes
 vec3 pointLight(vec3 lightPosition, vec3 lightColour,
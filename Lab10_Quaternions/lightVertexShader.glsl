@@ -4,10 +4,21 @@
 layout(location = 0) in vec3 position;
 
 // Uniforms
-uniform mat4 MVP;
+uniform mat4 M;
+
+// Camera matrices, shared by every program
+layout(std140) uniform View
+{
+    mat4 V;
+    mat4 P;
+    mat4 VP;
+    mat4 invV;
+    mat4 invP;
+    mat4 invVP;
+};
 
 void main()
 {
     // Output vertex postion
-    gl_Position = MVP * vec4(position, 1.0);
+    gl_Position = VP * (M * vec4(position, 1.0));
 }
@@ -5,9 +5,8 @@
 // Inputs
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec2 uv;
-layout(location = 2) in vec3 normal;
-layout(location = 3) in vec3 tangent;
-layout(location = 4) in vec3 bitangent;
+layout(location = 2) in vec2 normal;   // octahedral encoded
+layout(location = 3) in vec4 tangent;  // octahedral encoded in xy, bitangent sign in z
 
 // Outputs
 out vec2 UV;
@@ -29,29 +28,53 @@ struct Light
 };
 
 // Uniforms
-uniform mat4 MVP;
-uniform mat4 MV;
-uniform Light lightSources[maxLights];
+uniform mat4 M;
+
+// Camera matrices, shared by every program
+layout(std140) uniform View
+{
+    mat4 V;
+    mat4 P;
+    mat4 VP;
+    mat4 invV;
+    mat4 invP;
+    mat4 invVP;
+};
+
+// Light sources, shared by every lit program
+layout(std140) uniform Lights
+{
+    Light lightSources[maxLights];
+};
+
+// Decode an octahedral encoded unit vector
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
 
 void main()
 {
     // Output vertex position
-    gl_Position = MVP * vec4(position, 1.0);
+    vec4 worldPosition = M * vec4(position, 1.0);
+    gl_Position = VP * worldPosition;
     
     // Output texture co-ordinates
     UV = uv;
     
     // Calculate the TBN matrix that transforms view space to tangent space
-    mat3 invMV = transpose(inverse(mat3(MV)));
-    vec3 t     = normalize(invMV * tangent);
-    //vec3 b     = normalize(invMV * bitangent);
-    vec3 n     = normalize(invMV * normal);
+    mat3 invMV = transpose(inverse(mat3(V) * mat3(M)));
+    vec3 t     = normalize(invMV * octDecode(tangent.xy));
+    vec3 n     = normalize(invMV * octDecode(normal));
     t = normalize(t - dot(t, n) * n);
-    vec3 b     = cross(n, t);
+    vec3 b     = sign(tangent.z) * cross(n, t);
     mat3 TBN   = transpose(mat3(t, b, n));
     
     // Output tangent space fragment position, light positions and directions
-    fragmentPosition = TBN * vec3(MV * vec4(position, 1.0));
+    fragmentPosition = TBN * vec3(V * worldPosition);
     
     for (int i = 0; i < maxLights; i++)
     {
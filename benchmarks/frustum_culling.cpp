@@ -0,0 +1,71 @@
+// Times frustum culling of a large scene of random bounding spheres, one
+// sphere at a time and with the SIMD batch
+//
+// Usage: Benchmark_frustum_culling [number of objects]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <common/camera.hpp>
+#include <common/culling.hpp>
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 100000;
+    const int repeats = 100;
+
+    // Spheres scattered through a cube 200 units across around the camera
+    srand(1);
+    std::vector<glm::vec4> spheres(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 centre(rand(), rand(), rand());
+        centre = centre / static_cast<float>(RAND_MAX) * 200.0f - 100.0f;
+        spheres[i] = glm::vec4(centre, 0.5f + 2.0f * rand() / static_cast<float>(RAND_MAX));
+    }
+
+    Camera camera(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+    camera.far = 150.0f;
+    camera.calculateMatrices();
+    Frustum frustum(camera.projection() * camera.view());
+
+    // One sphere at a time
+    size_t scalarVisible = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        scalarVisible = 0;
+        for (size_t i = 0; i < count; i++)
+            scalarVisible += frustum.containsSphere(glm::vec3(spheres[i]), spheres[i].w) ? 1 : 0;
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    double scalarMs = std::chrono::duration<double, std::milli>(stop - start).count() / repeats;
+
+    // Batch, filled once as the labs do every frame
+    CullingBatch batch;
+    for (size_t i = 0; i < count; i++)
+        batch.add(spheres[i]);
+    CullingStats total;
+    for (int r = 0; r < repeats; r++)
+    {
+        batch.cull(frustum);
+        total.add(batch.stats);
+    }
+    double batchMs = total.milliseconds / repeats;
+
+    // Both must agree
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i++)
+        if ((batch.visible[i] != 0) != frustum.containsSphere(glm::vec3(spheres[i]), spheres[i].w))
+            mismatches++;
+
+    printf("%zu objects, %zu visible, %zu culled, %zu mismatches\n", count, scalarVisible,
+           batch.stats.culled, mismatches);
+    printf("one at a time  %8.3f ms  %6.2f ns/object\n", scalarMs, scalarMs * 1e6 / count);
+    printf("batch          %8.3f ms  %6.2f ns/object\n", batchMs, batchMs * 1e6 / count);
+    return mismatches == 0 ? 0 : 1;
+}
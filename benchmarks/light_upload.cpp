@@ -0,0 +1,198 @@
+// Sends 10 light sources to two lit programs every frame, once as the
+// uniforms of each program's lightSources array (through ShaderProgram, so
+// unchanged values are already skipped) and once through the Lights uniform
+// buffer that Light::toShader uploads for every program at once. Runs with a
+// still scene, with one light moving and with the camera moving.
+//
+// Usage: Benchmark_light_upload [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Light pulls in the model loader, which needs stb_image
+#define STB_IMAGE_IMPLEMENTATION
+#include <common/stb_image.hpp>
+#include <common/shader.hpp>
+#include <common/shaderprogram.hpp>
+#include <common/light.hpp>
+
+static const int numPrograms = 2;
+
+// The uniforms of the lights as Lab08's shader declares them
+struct LightUniforms
+{
+    Uniform position, direction, colour, constant, linear, quadratic, cosPhi, type;
+};
+
+// Every field of every light to every program, as Light::toShader used to
+static void sendUniforms(ShaderProgram **programs, unsigned int *programIDs,
+                         const std::vector<LightUniforms> &uniforms, const Light &lights, const glm::mat4 &view)
+{
+    for (int p = 0; p < numPrograms; p++)
+    {
+        glUseProgram(programIDs[p]);
+        ShaderProgram &program = *programs[p];
+        for (size_t i = 0; i < lights.lightSources.size(); i++)
+        {
+            const LightSource &light = lights.lightSources[i];
+            program.set(uniforms[i].position,  glm::vec3(view * glm::vec4(light.position, 1.0f)));
+            program.set(uniforms[i].direction, glm::vec3(view * glm::vec4(light.direction, 0.0f)));
+            program.set(uniforms[i].colour,    light.colour);
+            program.set(uniforms[i].constant,  light.constant);
+            program.set(uniforms[i].linear,    light.linear);
+            program.set(uniforms[i].quadratic, light.quadratic);
+            program.set(uniforms[i].cosPhi,    light.cosPhi);
+            program.set(uniforms[i].type,      static_cast<int>(light.type));
+        }
+    }
+}
+
+// The frame's view and lights
+static glm::mat4 animate(Light &lights, int scene, int frame)
+{
+    float t = scene == 0 ? 0.0f : 0.01f * frame;
+    if (scene == 1)
+        lights.lightSources[0].position = glm::vec3(2.0f * cosf(t), 2.0f, 2.0f * sinf(t));
+    glm::vec3 eye = scene == 2 ? glm::vec3(5.0f * cosf(t), 2.0f, 5.0f * sinf(t)) : glm::vec3(0.0f, 2.0f, 5.0f);
+    return glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 2000;
+
+    // Hidden window for the GL context
+    if (!glfwInit())
+    {
+        printf("couldn't initialise GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("couldn't open a window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK)
+    {
+        printf("couldn't initialise GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+    glGetError();   // GLEW can leave an error from probing extensions
+
+    // Lab08's program declares the lights as plain uniforms, Lab09's and
+    // Lab10's read them from the Lights block
+    GLProgram uniformShaders[numPrograms], blockShaders[numPrograms];
+    unsigned int uniformIDs[numPrograms], blockIDs[numPrograms];
+    ShaderProgram *uniformPrograms[numPrograms];
+    for (int p = 0; p < numPrograms; p++)
+    {
+        uniformShaders[p] = LoadShaders("../Lab08_Lighting/vertexShader.glsl",
+                                        "../Lab08_Lighting/multipleLightsFragmentShader.glsl");
+        uniformIDs[p] = uniformShaders[p].get();
+        uniformPrograms[p] = &ShaderProgram::get(uniformIDs[p]);
+    }
+    blockShaders[0] = LoadShaders("../Lab09_Normal_maps/vertexShader.glsl", "../Lab09_Normal_maps/fragmentShader.glsl");
+    blockShaders[1] = LoadShaders("../Lab10_Quaternions/vertexShader.glsl", "../Lab10_Quaternions/fragmentShader.glsl");
+    for (int p = 0; p < numPrograms; p++)
+    {
+        blockIDs[p] = blockShaders[p].get();
+        ShaderProgram::get(blockIDs[p]);
+    }
+
+    // Ten lights of every type
+    Light lights;
+    for (int i = 0; i < 10; i++)
+    {
+        glm::vec3 position(float(i) - 5.0f, 2.0f, 0.0f), colour(1.0f, 1.0f, 1.0f);
+        if (i % 3 == 0)
+            lights.addPointLight(position, colour, 1.0f, 0.1f, 0.02f);
+        else if (i % 3 == 1)
+            lights.addSpotLight(position, glm::vec3(0.0f, -1.0f, 0.0f), colour, 1.0f, 0.1f, 0.02f, 0.9f);
+        else
+            lights.addDirectionalLight(glm::vec3(1.0f, -1.0f, 0.0f), colour);
+    }
+    std::vector<LightUniforms> uniforms;
+    for (size_t i = 0; i < lights.lightSources.size(); i++)
+    {
+        std::string light = "lightSources[" + std::to_string(i) + "].";
+        LightUniforms u;
+        u.position  = Uniform(light + "position");
+        u.direction = Uniform(light + "direction");
+        u.colour    = Uniform(light + "colour");
+        u.constant  = Uniform(light + "constant");
+        u.linear    = Uniform(light + "linear");
+        u.quadratic = Uniform(light + "quadratic");
+        u.cosPhi    = Uniform(light + "cosPhi");
+        u.type      = Uniform(light + "type");
+        uniforms.push_back(u);
+    }
+
+    const char *scenes[3] = { "still", "one light", "camera" };
+    printf("\n%-10s %12s %12s %12s %12s %12s\n", "", "uniforms ms", "gl calls", "block ms", "uploads", "lights");
+    for (int scene = 0; scene < 3; scene++)
+    {
+        // Every program's uniforms
+        ShaderProgram::stats() = UniformStats();
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++)
+        {
+            glm::mat4 view = animate(lights, scene, f);
+            sendUniforms(uniformPrograms, uniformIDs, uniforms, lights, view);
+        }
+        glFinish();
+        double uniformMs = elapsedMs(start);
+        double calls = double(ShaderProgram::stats().sent) / frames;
+
+        // One buffer for every program
+        lights.stats = LightUploadStats();
+        start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++)
+        {
+            glm::mat4 view = animate(lights, scene, f);
+            glUseProgram(blockIDs[0]);
+            lights.toShader(blockIDs[0], view);
+            for (int p = 1; p < numPrograms; p++)
+                glUseProgram(blockIDs[p]);
+        }
+        glFinish();
+        double blockMs = elapsedMs(start);
+
+        printf("%-10s %12.2f %12.1f %12.2f %12.2f %12.2f\n", scenes[scene], uniformMs, calls, blockMs,
+               double(lights.stats.uploads) / frames, double(lights.stats.lights) / frames);
+    }
+    if (glGetError() != GL_NO_ERROR)
+        printf("GL error\n");
+
+    lights.deleteBuffers();
+    for (int p = 0; p < numPrograms; p++)
+    {
+        uniformShaders[p].reset();
+        blockShaders[p].reset();
+    }
+    releaseGLContext();
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Counts the triangles submitted per frame for a field of 10,000 teapots with
+// and without levels of detail
+//
+// Usage: Benchmark_lod_selection [pixel error]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <common/camera.hpp>
+#include <common/objloader.hpp>
+#include <common/meshoptimizer.hpp>
+
+int main(int argc, char *argv[])
+{
+    float pixelError = argc > 1 ? static_cast<float>(atof(argv[1])) : 1.0f;
+    const unsigned int gridSize = 100;
+    const float spacing = 3.0f;
+
+    // Load the teapot and build its levels of detail as Model does
+    ObjData obj;
+    if (!parseObj("../assets/teapot.obj", obj))
+        return 1;
+    std::vector<glm::vec3> vertices, normals;
+    std::vector<glm::vec2> uvs;
+    std::vector<unsigned int> indices;
+    indexObj(obj, vertices, uvs, normals, indices);
+
+    glm::vec3 boundsMin = vertices[0], boundsMax = vertices[0];
+    for (unsigned int i = 1; i < vertices.size(); i++)
+    {
+        boundsMin = glm::min(boundsMin, vertices[i]);
+        boundsMax = glm::max(boundsMax, vertices[i]);
+    }
+    glm::vec3 centre = 0.5f * (boundsMin + boundsMax);
+    float radius = 0.0f;
+    for (unsigned int i = 0; i < vertices.size(); i++)
+        radius = glm::max(radius, glm::length(vertices[i] - centre));
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<MeshLod> lods = buildLods(indices, vertices.data(), normals.data(), vertices.size(),
+                                          8, 0.05f * 2.0f * radius, true);
+    auto stop = std::chrono::high_resolution_clock::now();
+    printf("built %zu levels in %.1f ms\n", lods.size(),
+           std::chrono::duration<double, std::milli>(stop - start).count());
+    for (unsigned int i = 0; i < lods.size(); i++)
+        printf("  level %u  %6u triangles  error %.4f\n", i, lods[i].count / 3, lods[i].error);
+
+    // Camera at the front edge of a grid of teapots, far plane moved back so
+    // the whole grid is in range
+    Camera camera(glm::vec3(0.0f, 4.0f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+    camera.yaw   = Maths::radians(-90.0f);
+    camera.pitch = Maths::radians(-10.0f);
+    camera.far   = gridSize * spacing * 1.5f;
+    camera.calculateMatrices();
+
+    std::vector<glm::mat4> models;
+    for (unsigned int z = 0; z < gridSize; z++)
+        for (unsigned int x = 0; x < gridSize; x++)
+        {
+            glm::vec3 position((x - 0.5f * gridSize) * spacing, 0.0f, -(z * spacing));
+            models.push_back(Maths::translate(position) * Maths::scale(glm::vec3(0.75f)));
+        }
+
+    // Select a level for every teapot, as a frame would
+    std::vector<unsigned int> histogram(lods.size(), 0);
+    size_t fullTriangles = 0, lodTriangles = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int i = 0; i < models.size(); i++)
+    {
+        float pixelScale = lodPixelScale(camera.projection(), camera.view() * models[i], centre, radius, 768.0f);
+        size_t lod = selectLod(lods, pixelScale, pixelError);
+        histogram[lod]++;
+        lodTriangles  += lods[lod].count / 3;
+        fullTriangles += lods[0].count / 3;
+    }
+    stop = std::chrono::high_resolution_clock::now();
+
+    printf("\n%zu teapots, %.1f pixel error\n", models.size(), pixelError);
+    printf("  triangles per frame without LOD %12zu\n", fullTriangles);
+    printf("  triangles per frame with LOD    %12zu (%.1f%%)\n", lodTriangles,
+           100.0 * lodTriangles / fullTriangles);
+    printf("  selection time                  %12.3f ms\n",
+           std::chrono::duration<double, std::milli>(stop - start).count());
+    for (unsigned int i = 0; i < histogram.size(); i++)
+        printf("  level %u drawn %u times\n", i, histogram[i]);
+
+    return 0;
+}
@@ -0,0 +1,294 @@
+// Lights a full screen quad of the bricks material and the diamond normal
+// map with 10 lights. It renders once as Lab09's fragment shader did,
+// sampling the diffuse and specular maps for every light from three
+// textures. It renders again with the specular map packed into the diffuse
+// map's alpha and the normal map kept to x and y, fetching each texel once a
+// fragment. Reports the texture fetches a fragment, the size of the
+// textures, the time a frame and how far apart the two images are.
+//
+// Usage: Benchmark_material_packing [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <common/stb_image.hpp>
+#include <common/image.hpp>
+#include <common/mipmap.hpp>
+#include <common/material.hpp>
+
+static const int lights = 10;
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// A quad facing the camera, so that view space is tangent space
+static const char *vertexShader = R"(
+#version 330 core
+out vec2 UV;
+out vec3 fragmentPosition;
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    UV = corner * 4.0;
+    fragmentPosition = vec3(corner * 4.0 - 2.0, -3.0);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// The lighting of Lab09's fragment shader, with the material fetched by
+// FETCH_DIFFUSE and FETCH_SPECULAR in every light
+static const char *fragmentShader = R"(
+#define maxLights 10
+in vec2 UV;
+in vec3 fragmentPosition;
+out vec4 fragmentColour;
+
+uniform sampler2D diffuseMap;
+uniform sampler2D normalMap;
+uniform sampler2D specularMap;
+uniform vec3  lightPosition[maxLights];
+uniform vec3  lightDirection[maxLights];
+uniform int   lightType[maxLights];
+uniform float cosPhi;
+
+vec2 normalXY = 2.0 * texture(normalMap, UV).rg - 1.0;
+vec3 Normal = normalize(vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));
+
+vec3 light(int i)
+{
+    vec3 objectColour = FETCH_DIFFUSE;
+    vec3 light = lightType[i] == 3 ? normalize(-lightDirection[i])
+                                   : normalize(lightPosition[i] - fragmentPosition);
+    float cosTheta  = max(dot(Normal, light), 0.0);
+    vec3 reflection = -light + 2.0 * dot(light, Normal) * Normal;
+    float cosAlpha  = max(dot(normalize(-fragmentPosition), reflection), 0.0);
+    vec3 colour = 0.2 * objectColour + 0.7 * objectColour * cosTheta + pow(cosAlpha, 20.0) * FETCH_SPECULAR;
+    if (lightType[i] == 3)
+        return colour;
+
+    float distance = length(lightPosition[i] - fragmentPosition);
+    colour /= 1.0 + 0.1 * distance + 0.02 * distance * distance;
+    if (lightType[i] == 2)
+        colour *= clamp((dot(-light, normalize(lightDirection[i])) - cosPhi) / radians(2.0), 0.0, 1.0);
+    return colour;
+}
+
+void main()
+{
+    MATERIAL
+    vec3 colour = vec3(0.0);
+    for (int i = 0; i < maxLights; i++)
+        colour += light(i);
+    fragmentColour = vec4(0.1 * colour, 1.0);
+}
+)";
+
+static const char *separateDefines =
+    "#version 330 core\n"
+    "#define MATERIAL\n"
+    "#define FETCH_DIFFUSE texture(diffuseMap, UV).rgb\n"
+    "#define FETCH_SPECULAR texture(specularMap, UV).rgb\n";
+
+static const char *packedDefines =
+    "#version 330 core\n"
+    "#define MATERIAL vec4 material = texture(diffuseMap, UV); objectColour = material.rgb; specularIntensity = material.a;\n"
+    "#define FETCH_DIFFUSE objectColour\n"
+    "#define FETCH_SPECULAR vec3(specularIntensity)\n"
+    "vec3 objectColour;\n"
+    "float specularIntensity;\n";
+
+static GLProgram compileProgram(const char *defines)
+{
+    GLProgram program = GLProgram::create();
+    GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    for (int i = 0; i < 2; i++)
+    {
+        const char *sources[2] = { defines, fragmentShader };
+        unsigned int shader = glCreateShader(types[i]);
+        if (i == 0)
+            glShaderSource(shader, 1, &vertexShader, NULL);
+        else
+            glShaderSource(shader, 2, sources, NULL);
+        glCompileShader(shader);
+        GLint status;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (!status)
+        {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+            printf("%s\n", log);
+        }
+        glAttachShader(program.get(), shader);
+        glDeleteShader(shader);
+    }
+    glLinkProgram(program.get());
+    return program;
+}
+
+// Bytes of every level of a chain
+static size_t chainBytes(const MipChain &chain)
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < chain.levels.size(); i++)
+        bytes += chain.levels[i].size();
+    return bytes;
+}
+
+// Draw frames with the textures bound in order to units 0, 1 and 2, returns
+// the milliseconds a frame
+static double render(unsigned int program, const std::vector<unsigned int> &textures, int frames)
+{
+    const char *names[3] = { "diffuseMap", "normalMap", "specularMap" };
+    glUseProgram(program);
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glUniform1i(glGetUniformLocation(program, names[i]), static_cast<GLint>(i));
+    }
+
+    // Point lights, spotlights and directional lights in turn
+    std::vector<float> positions, directions;
+    std::vector<int> types;
+    for (int i = 0; i < lights; i++)
+    {
+        float x = -2.0f + 4.0f * i / (lights - 1);
+        float position[3]  = { x, 1.5f - (i % 3), -1.0f };
+        float direction[3] = { -0.2f * x, 0.3f, -1.0f };
+        positions.insert(positions.end(), position, position + 3);
+        directions.insert(directions.end(), direction, direction + 3);
+        types.push_back(1 + i % 3);
+    }
+    glUniform3fv(glGetUniformLocation(program, "lightPosition"), lights, positions.data());
+    glUniform3fv(glGetUniformLocation(program, "lightDirection"), lights, directions.data());
+    glUniform1iv(glGetUniformLocation(program, "lightType"), lights, types.data());
+    glUniform1f(glGetUniformLocation(program, "cosPhi"), 0.9f);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glFinish();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glFinish();
+    return elapsedMs(start) / frames;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 50;
+
+    // Hidden window for the GL context
+    if (!glfwInit())
+    {
+        printf("couldn't initialise GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("couldn't open a window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK)
+    {
+        printf("couldn't initialise GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+
+    {
+        // The three maps on their own, and packed into two
+        const char *diffusePath  = "../assets/bricks_diffuse.png";
+        const char *normalPath   = "../assets/diamond_normal.png";
+        const char *specularPath = "../assets/bricks_specular.png";
+        MipChain diffuse, normal, specular, packed, normalXY;
+        if (!loadMipChain(diffusePath, MipSettings(), diffuse) ||
+            !loadMipChain(normalPath, mipSettingsForType("normal"), normal) ||
+            !loadMipChain(specularPath, MipSettings(), specular) ||
+            !loadPackedMaterial(diffusePath, specularPath, MipSettings(), packed))
+        {
+            printf("couldn't load the bricks material\n");
+            glfwTerminate();
+            return 1;
+        }
+        normalXY = normal;
+        keepNormalXY(normalXY);
+
+        GLTexture separateTextures[3] = { uploadTexture(diffuse), uploadTexture(normal), uploadTexture(specular) };
+        GLTexture packedTextures[2]   = { uploadTexture(packed), uploadTexture(normalXY) };
+        std::vector<unsigned int> separate, packedIds;
+        for (int i = 0; i < 3; i++)
+            separate.push_back(separateTextures[i].get());
+        for (int i = 0; i < 2; i++)
+            packedIds.push_back(packedTextures[i].get());
+
+        // Render to a texture, so the default framebuffer doesn't matter
+        const int size = 1024;
+        GLTexture colour = GLTexture::create();
+        glBindTexture(GL_TEXTURE_2D, colour.get());
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        unsigned int framebuffer, vertexArray;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colour.get(), 0);
+        glViewport(0, 0, size, size);
+        glGenVertexArrays(1, &vertexArray);
+        glBindVertexArray(vertexArray);
+
+        GLProgram separateProgram = compileProgram(separateDefines);
+        GLProgram packedProgram   = compileProgram(packedDefines);
+        std::vector<uint8_t> separateImage(static_cast<size_t>(size) * size * 4);
+        std::vector<uint8_t> packedImage(separateImage.size());
+
+        double separateMs = render(separateProgram.get(), separate, frames);
+        glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, separateImage.data());
+        double packedMs = render(packedProgram.get(), packedIds, frames);
+        glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, packedImage.data());
+
+        // Mean and largest difference of the two images
+        double total = 0.0;
+        int largest = 0;
+        for (size_t i = 0; i < separateImage.size(); i++)
+        {
+            int difference = abs(static_cast<int>(separateImage[i]) - static_cast<int>(packedImage[i]));
+            total += difference;
+            largest = difference > largest ? difference : largest;
+        }
+
+        // The normal map once, and the diffuse and specular maps once a light
+        // or once in all
+        size_t separateBytes = chainBytes(diffuse) + chainBytes(normal) + chainBytes(specular);
+        size_t packedBytes   = chainBytes(packed) + chainBytes(normalXY);
+        printf("%d lights, %d x %d fragments\n", lights, size, size);
+        printf("separate  3 textures  %2d fetches a fragment  %6.2f MB  frame %8.3f ms\n",
+               1 + 2 * lights, separateBytes / (1024.0 * 1024.0), separateMs);
+        printf("packed    2 textures  %2d fetches a fragment  %6.2f MB  frame %8.3f ms\n",
+               2, packedBytes / (1024.0 * 1024.0), packedMs);
+        printf("image difference  mean %.3f  largest %d of 255\n", total / separateImage.size(), largest);
+
+        separateProgram.reset();
+        packedProgram.reset();
+        glDeleteVertexArrays(1, &vertexArray);
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+
+    releaseGLContext();
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,48 @@
+// Reports how much vertex welding shrinks the geometry uploaded by Model
+//
+// Usage: Benchmark_mesh_indexing
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <common/objloader.hpp>
+
+// Model uploads position, uv, normal, tangent and bitangent per vertex
+static const size_t bytesPerVertex = 4 * sizeof(glm::vec3) + sizeof(glm::vec2);
+
+int main()
+{
+    const char *assets[] = { "cube.obj", "plane.obj", "sphere.obj", "suzanne.obj", "teapot.obj" };
+
+    printf("%-12s %10s %10s %8s %12s %12s %8s\n", "file", "corners", "unique", "ratio",
+           "array (KB)", "indexed (KB)", "saving");
+
+    for (unsigned int i = 0; i < sizeof(assets) / sizeof(assets[0]); i++)
+    {
+        std::string path = std::string("../assets/") + assets[i];
+        ObjData obj;
+        if (!parseObj(path.c_str(), obj))
+            continue;
+
+        std::vector<glm::vec3> vertices, normals;
+        std::vector<glm::vec2> uvs;
+        std::vector<unsigned int> indices;
+        indexObj(obj, vertices, uvs, normals, indices);
+
+        // Non-indexed upload has one vertex per triangle corner, indexed
+        // upload has one per unique vertex plus 16 or 32-bit indices
+        size_t corners      = indices.size();
+        size_t indexSize    = vertices.size() <= 0xFFFF ? 2 : 4;
+        size_t arrayBytes   = corners * bytesPerVertex;
+        size_t indexedBytes = vertices.size() * bytesPerVertex + corners * indexSize;
+
+        printf("%-12s %10zu %10zu %7.2fx %12.1f %12.1f %7.1f%%\n", assets[i], corners, vertices.size(),
+               static_cast<double>(corners) / vertices.size(), arrayBytes / 1024.0, indexedBytes / 1024.0,
+               100.0 * (1.0 - static_cast<double>(indexedBytes) / arrayBytes));
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Times building the mipmap chains of the textures in assets/ on the CPU
+// with a plain 8-bit box filter, the box filter and the Kaiser filter, then
+// times loading a chain back from its KTX2 cache against decoding the PNG
+// and building the mipmaps again
+//
+// Usage: Benchmark_mipmap_generation
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <chrono>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <common/stb_image.hpp>
+#include <common/mipmap.hpp>
+#include <common/ktx.hpp>
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Mipmaps averaging 2x2 bytes, as glGenerateMipmap does in software drivers
+static size_t byteBoxMips(const unsigned char *pixels, int width, int height, int channels)
+{
+    std::vector<unsigned char> level(pixels, pixels + static_cast<size_t>(width) * height * channels), half;
+    size_t bytes = 0;
+    while (width > 1 || height > 1)
+    {
+        int halfWidth  = width  > 1 ? width  / 2 : 1;
+        int halfHeight = height > 1 ? height / 2 : 1;
+        half.resize(static_cast<size_t>(halfWidth) * halfHeight * channels);
+        for (int y = 0; y < halfHeight; y++)
+        {
+            const unsigned char *row0 = &level[static_cast<size_t>(2 * y < height ? 2 * y : height - 1) * width * channels];
+            const unsigned char *row1 = &level[static_cast<size_t>(2 * y + 1 < height ? 2 * y + 1 : height - 1) * width * channels];
+            for (int x = 0; x < halfWidth; x++)
+            {
+                int x0 = (2 * x) * channels;
+                int x1 = (2 * x + 1 < width ? 2 * x + 1 : width - 1) * channels;
+                for (int c = 0; c < channels; c++)
+                    half[(static_cast<size_t>(y) * halfWidth + x) * channels + c] = static_cast<unsigned char>(
+                        (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+        level.swap(half);
+        width  = halfWidth;
+        height = halfHeight;
+        bytes += level.size();
+    }
+    return bytes;
+}
+
+int main()
+{
+    struct Source
+    {
+        const char *path;
+        const char *type;
+    };
+    const Source sources[] = {
+        { "../assets/bricks_diffuse.png",  "diffuse" },
+        { "../assets/bricks_specular.png", "specular" },
+        { "../assets/stones_diffuse.png",  "diffuse" },
+        { "../assets/stones_specular.png", "specular" },
+        { "../assets/diamond_normal.png",  "normal" },
+        { "../assets/kratos.png",          "diffuse" },
+    };
+    const size_t count = sizeof(sources) / sizeof(sources[0]);
+
+    double totalBytes = 0.0, totalBox = 0.0, totalKaiser = 0.0, totalBuild = 0.0, totalCached = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        int width, height, channels;
+        unsigned char *pixels = stbi_load(sources[i].path, &width, &height, &channels, 0);
+        double decodeMs = elapsedMs(start);
+        if (pixels == NULL)
+        {
+            printf("couldn't load %s\n", sources[i].path);
+            return 1;
+        }
+
+        start = std::chrono::high_resolution_clock::now();
+        byteBoxMips(pixels, width, height, channels);
+        double bytesMs = elapsedMs(start);
+
+        MipSettings settings = mipSettingsForType(sources[i].type);
+        settings.filter = MipFilter::Box;
+        start = std::chrono::high_resolution_clock::now();
+        generateMips(pixels, width, height, channels, settings);
+        double boxMs = elapsedMs(start);
+
+        settings.filter = MipFilter::Kaiser;
+        start = std::chrono::high_resolution_clock::now();
+        MipChain chain = generateMips(pixels, width, height, channels, settings);
+        double kaiserMs = elapsedMs(start);
+        stbi_image_free(pixels);
+
+        // Round trip through a KTX2 file
+        std::string ktxPath = std::string(sources[i].path) + ".benchmark.ktx2";
+        if (!writeKtx2(ktxPath.c_str(), chain))
+        {
+            printf("couldn't write %s\n", ktxPath.c_str());
+            return 1;
+        }
+        start = std::chrono::high_resolution_clock::now();
+        MipChain loaded;
+        bool read = readKtx2(ktxPath.c_str(), loaded);
+        double cachedMs = elapsedMs(start);
+        remove(ktxPath.c_str());
+        if (!read || loaded.levels != chain.levels)
+        {
+            printf("KTX2 round trip of %s failed\n", sources[i].path);
+            return 1;
+        }
+
+        printf("  %-32s %5d x %-5d x %d  %-20s  8-bit box %6.1f ms  box %6.1f ms  kaiser %6.1f ms  "
+               "PNG + kaiser %6.1f ms  KTX2 %5.2f ms\n",
+               sources[i].path, width, height, channels, mipSettingsName(settings).c_str(),
+               bytesMs, boxMs, kaiserMs, decodeMs + kaiserMs, cachedMs);
+        totalBytes  += bytesMs;
+        totalBox    += boxMs;
+        totalKaiser += kaiserMs;
+        totalBuild  += decodeMs + kaiserMs;
+        totalCached += cachedMs;
+    }
+
+    printf("build  8-bit box %7.1f ms  box %7.1f ms  kaiser %7.1f ms\n", totalBytes, totalBox, totalKaiser);
+    printf("load   PNG + kaiser %7.1f ms  KTX2 %6.2f ms, %.0fx\n", totalBuild, totalCached, totalBuild / totalCached);
+    return 0;
+}
@@ -0,0 +1,294 @@
+// Times the memory mapped .obj parser, serial and parallel, against the
+// original fscanf loader
+//
+// Usage: Benchmark_obj_loader [generated file size in MB] [threads]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <common/objloader.hpp>
+#include <common/threadpool.hpp>
+
+// Original fscanf based loader, kept here as the reference implementation
+static bool fscanfLoadObj(const char *path,
+                          std::vector<glm::vec3> &outVertices,
+                          std::vector<glm::vec2> &outUVs,
+                          std::vector<glm::vec3> &outNormals)
+{
+    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
+    std::vector<glm::vec3> tempVertices;
+    std::vector<glm::vec2> tempUVs;
+    std::vector<glm::vec3> tempNormals;
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return false;
+
+    while (true)
+    {
+        char lineHeader[128];
+        int res = fscanf(file, "%127s", lineHeader);
+        if (res == EOF)
+            break;
+
+        if (strcmp(lineHeader, "v") == 0)
+        {
+            glm::vec3 vertex;
+            fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
+            tempVertices.push_back(vertex);
+        }
+        else if (strcmp(lineHeader, "vt") == 0)
+        {
+            glm::vec2 uv;
+            fscanf(file, "%f %f\n", &uv.x, &uv.y);
+            tempUVs.push_back(uv);
+        }
+        else if (strcmp(lineHeader, "vn") == 0)
+        {
+            glm::vec3 normal;
+            fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
+            tempNormals.push_back(normal);
+        }
+        else if (strcmp(lineHeader, "f") == 0)
+        {
+            unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
+            int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n",
+                                 &vertexIndex[0], &uvIndex[0], &normalIndex[0],
+                                 &vertexIndex[1], &uvIndex[1], &normalIndex[1],
+                                 &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
+            if (matches != 9)
+            {
+                fclose(file);
+                return false;
+            }
+            for (int i = 0; i < 3; i++)
+            {
+                vertexIndices.push_back(vertexIndex[i]);
+                uvIndices.push_back(uvIndex[i]);
+                normalIndices.push_back(normalIndex[i]);
+            }
+        }
+        else
+        {
+            char commentBuffer[1000];
+            fgets(commentBuffer, 1000, file);
+        }
+    }
+
+    for (unsigned int i = 0; i < vertexIndices.size(); i++)
+    {
+        outVertices.push_back(tempVertices[vertexIndices[i] - 1]);
+        outUVs.push_back(tempUVs[uvIndices[i] - 1]);
+        outNormals.push_back(tempNormals[normalIndices[i] - 1]);
+    }
+
+    fclose(file);
+    return true;
+}
+
+// Number of threads used by the parallel loader
+static unsigned int numThreads = 0;
+
+// Memory mapped loader producing the same expanded arrays as Model::loadObj
+static bool expandObj(const ObjData &obj,
+                      std::vector<glm::vec3> &outVertices,
+                      std::vector<glm::vec2> &outUVs,
+                      std::vector<glm::vec3> &outNormals)
+{
+    size_t numCorners = obj.positionIndices.size();
+    outVertices.resize(numCorners);
+    outUVs.resize(numCorners);
+    outNormals.resize(numCorners);
+    for (size_t i = 0; i < numCorners; i++)
+    {
+        outVertices[i] = obj.positions[obj.positionIndices[i]];
+        outUVs[i]      = obj.uvs[obj.uvIndices[i]];
+        outNormals[i]  = obj.normals[obj.normalIndices[i]];
+    }
+    return true;
+}
+
+static bool mappedLoadObj(const char *path,
+                          std::vector<glm::vec3> &outVertices,
+                          std::vector<glm::vec2> &outUVs,
+                          std::vector<glm::vec3> &outNormals)
+{
+    ObjData obj;
+    return parseObj(path, obj, 1) && expandObj(obj, outVertices, outUVs, outNormals);
+}
+
+static bool parallelLoadObj(const char *path,
+                            std::vector<glm::vec3> &outVertices,
+                            std::vector<glm::vec2> &outUVs,
+                            std::vector<glm::vec3> &outNormals)
+{
+    ObjData obj;
+    return parseObj(path, obj, numThreads) && expandObj(obj, outVertices, outUVs, outNormals);
+}
+
+typedef bool (*LoadFunction)(const char *, std::vector<glm::vec3> &,
+                             std::vector<glm::vec2> &, std::vector<glm::vec3> &);
+
+// Output of a loader
+struct LoadedMesh
+{
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+
+    bool operator==(const LoadedMesh &other) const
+    {
+        return vertices.size() == other.vertices.size() &&
+               uvs.size() == other.uvs.size() &&
+               normals.size() == other.normals.size() &&
+               memcmp(vertices.data(), other.vertices.data(), vertices.size() * sizeof(glm::vec3)) == 0 &&
+               memcmp(uvs.data(), other.uvs.data(), uvs.size() * sizeof(glm::vec2)) == 0 &&
+               memcmp(normals.data(), other.normals.data(), normals.size() * sizeof(glm::vec3)) == 0;
+    }
+};
+
+// Returns the best of several runs in milliseconds
+static double timeLoader(LoadFunction load, const char *path, int runs, LoadedMesh &mesh)
+{
+    double best = 1e30;
+    for (int run = 0; run < runs; run++)
+    {
+        std::vector<glm::vec3> vertices, normals;
+        std::vector<glm::vec2> uvs;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!load(path, vertices, uvs, normals))
+            return -1.0;
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+        if (ms < best)
+            best = ms;
+        mesh.vertices.swap(vertices);
+        mesh.uvs.swap(uvs);
+        mesh.normals.swap(normals);
+    }
+    return best;
+}
+
+// Write a tessellated, wavy grid as an .obj file of roughly the requested size
+static bool generateObj(const char *path, size_t targetBytes)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return false;
+
+    // Each grid vertex costs about 110 bytes of v/vt/vn records and each quad
+    // about 60 bytes of face records
+    unsigned int n = 2;
+    while (static_cast<size_t>(n) * n * 170 < targetBytes)
+        n++;
+
+    fprintf(file, "# Generated benchmark mesh\no grid\n");
+    for (unsigned int j = 0; j < n; j++)
+        for (unsigned int i = 0; i < n; i++)
+        {
+            float x = static_cast<float>(i) / (n - 1), z = static_cast<float>(j) / (n - 1);
+            fprintf(file, "v %f %f %f\n", 2.0f * x - 1.0f, 0.1f * sinf(20.0f * x) * cosf(20.0f * z), 2.0f * z - 1.0f);
+        }
+    for (unsigned int j = 0; j < n; j++)
+        for (unsigned int i = 0; i < n; i++)
+            fprintf(file, "vt %f %f\n", static_cast<float>(i) / (n - 1), static_cast<float>(j) / (n - 1));
+    for (unsigned int j = 0; j < n; j++)
+        for (unsigned int i = 0; i < n; i++)
+            fprintf(file, "vn 0.000000 1.000000 0.000000\n");
+    for (unsigned int j = 0; j + 1 < n; j++)
+        for (unsigned int i = 0; i + 1 < n; i++)
+        {
+            unsigned int a = j * n + i + 1, b = a + 1, c = a + n, d = c + 1;
+            fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, c, c, c, b, b, b);
+            fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", b, b, b, c, c, c, d, d, d);
+        }
+
+    fclose(file);
+    return true;
+}
+
+static void benchmark(const char *name, const char *path, int runs)
+{
+    LoadedMesh fscanfMesh, mappedMesh, parallelMesh;
+    double fscanfTime   = timeLoader(fscanfLoadObj, path, runs, fscanfMesh);
+    double mappedTime   = timeLoader(mappedLoadObj, path, runs, mappedMesh);
+    double parallelTime = timeLoader(parallelLoadObj, path, runs, parallelMesh);
+
+    if (fscanfTime < 0.0 || mappedTime < 0.0 || parallelTime < 0.0)
+    {
+        printf("%-14s failed to load %s\n", name, path);
+        return;
+    }
+
+    printf("%-14s %10zu %12.2f %12.2f %12.2f %8.1fx\n", name, mappedMesh.vertices.size(),
+           fscanfTime, mappedTime, parallelTime, fscanfTime / parallelTime);
+    if (!(fscanfMesh == mappedMesh))
+        printf("  warning: mapped loader produced different vertex data\n");
+    if (!(mappedMesh == parallelMesh))
+        printf("  warning: parallel loader produced different vertex data\n");
+}
+
+// Parse time of the parallel loader for increasing thread counts
+static void scaling(const char *path)
+{
+    unsigned int maxThreads = ThreadPool::global().size() + 1;
+    ObjData serial;
+    parseObj(path, serial, 1);
+
+    printf("\n%8s %12s %9s\n", "threads", "parse (ms)", "speedup");
+    double serialTime = 0.0;
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        ObjData obj;
+        auto start = std::chrono::high_resolution_clock::now();
+        parseObj(path, obj, threads);
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+        if (threads == 1)
+            serialTime = ms;
+        printf("%8u %12.2f %8.1fx\n", threads, ms, serialTime / ms);
+
+        if (obj.positions != serial.positions || obj.uvs != serial.uvs || obj.normals != serial.normals ||
+            obj.positionIndices != serial.positionIndices || obj.uvIndices != serial.uvIndices ||
+            obj.normalIndices != serial.normalIndices)
+            printf("  warning: %u threads produced different data\n", threads);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t generatedMB = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 100;
+    const char *generatedPath = "generated_benchmark.obj";
+    if (argc > 2)
+        numThreads = static_cast<unsigned int>(atoi(argv[2]));
+
+    printf("%-14s %10s %12s %12s %12s %9s\n", "file", "vertices", "fscanf (ms)", "mapped (ms)",
+           "parallel (ms)", "speedup");
+    benchmark("teapot.obj",  "../assets/teapot.obj",  10);
+    benchmark("suzanne.obj", "../assets/suzanne.obj", 10);
+
+    if (generatedMB > 0)
+    {
+        if (generateObj(generatedPath, generatedMB * 1024 * 1024))
+        {
+            std::string name = "generated " + std::to_string(generatedMB) + "MB";
+            benchmark(name.c_str(), generatedPath, 1);
+            scaling(generatedPath);
+            remove(generatedPath);
+        }
+        else
+            printf("Couldn't write %s\n", generatedPath);
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Compiles the lit and light shader programs of Lab08 to Lab10 with no
+// program binary cache, once with LoadShaders one program after another and
+// once handing both to a ShaderBatch. Reports for each Lab how long the
+// thread is busy before it can go on loading models, and how long until
+// both programs are ready.
+//
+// Usage: Benchmark_shader_batch [runs]
+//
+// Run it with MESA_SHADER_CACHE_DISABLE=true on Mesa, whose own shader
+// cache otherwise makes every run after the first one warm.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <chrono>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <common/shader.hpp>
+#include <common/programcache.hpp>
+
+struct LabPrograms
+{
+    const char *name;
+    const char *fragmentShader;     // of the lit program
+};
+
+static const LabPrograms labPrograms[] = {
+    { "Lab08_Lighting",    "multipleLightsFragmentShader.glsl" },
+    { "Lab09_Normal_maps", "fragmentShader.glsl" },
+    { "Lab10_Quaternions", "fragmentShader.glsl" },
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 3;
+
+    // Hidden window for the GL context
+    if (!glfwInit())
+    {
+        printf("couldn't initialise GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("couldn't open a window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK)
+    {
+        printf("couldn't initialise GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+
+    const int numLabs = sizeof(labPrograms) / sizeof(labPrograms[0]);
+    double serialMs[numLabs], submitMs[numLabs], readyMs[numLabs];
+    bool parallel = false;
+    for (int i = 0; i < numLabs; i++)
+        serialMs[i] = submitMs[i] = readyMs[i] = 1e30;
+
+    // Best of a few runs
+    for (int run = 0; run < runs; run++)
+        for (int i = 0; i < numLabs; i++)
+        {
+            std::string directory = std::string("../") + labPrograms[i].name + "/";
+            std::string vertex = directory + "vertexShader.glsl";
+            std::string fragment = directory + labPrograms[i].fragmentShader;
+            std::string lightVertex = directory + "lightVertexShader.glsl";
+            std::string lightFragment = directory + "lightFragmentShader.glsl";
+            remove(ProgramCache::cachePath(vertex.c_str(), fragment.c_str()).c_str());
+            remove(ProgramCache::cachePath(lightVertex.c_str(), lightFragment.c_str()).c_str());
+
+            // One program after another, each checked as soon as it's linked
+            auto start = std::chrono::steady_clock::now();
+            GLProgram shader      = LoadShaders(vertex.c_str(), fragment.c_str());
+            GLProgram lightShader = LoadShaders(lightVertex.c_str(), lightFragment.c_str());
+            double serial = elapsedMs(start);
+            shader.reset();
+            lightShader.reset();
+            remove(ProgramCache::cachePath(vertex.c_str(), fragment.c_str()).c_str());
+            remove(ProgramCache::cachePath(lightVertex.c_str(), lightFragment.c_str()).c_str());
+
+            // Both handed over at once, then polled as a Lab loading its
+            // models in the meantime would
+            start = std::chrono::steady_clock::now();
+            ShaderBatch batch;
+            ProgramFuture shaderFuture      = batch.add(vertex.c_str(), fragment.c_str());
+            ProgramFuture lightShaderFuture = batch.add(lightVertex.c_str(), lightFragment.c_str());
+            double submit = elapsedMs(start);
+            while (!batch.ready())
+                ;
+            shaderFuture.get();         // deleted straight away
+            lightShaderFuture.get();
+            double ready = elapsedMs(start);
+            parallel = batch.parallel();
+
+            serialMs[i] = serial < serialMs[i] ? serial : serialMs[i];
+            submitMs[i] = submit < submitMs[i] ? submit : submitMs[i];
+            readyMs[i]  = ready < readyMs[i] ? ready : readyMs[i];
+        }
+
+    printf("\nparallel shader compile %s\n", parallel ? "supported" : "not supported");
+    printf("%-20s %12s %12s %12s\n", "", "serial ms", "submit ms", "ready ms");
+    for (int i = 0; i < numLabs; i++)
+        printf("%-20s %12.2f %12.2f %12.2f\n", labPrograms[i].name, serialMs[i], submitMs[i], readyMs[i]);
+
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Loads the shader programs of every Lab the way it does at startup, first
+// with no program binary cache so every program is compiled and cached,
+// then again from the cache. Reports the time of both for each Lab.
+//
+// Usage: Benchmark_shader_cache [runs]
+//
+// Drivers may keep a shader cache of their own (Mesa does unless
+// MESA_SHADER_CACHE_DISABLE=true), which makes the cold times faster than
+// on a first launch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <common/shader.hpp>
+#include <common/programcache.hpp>
+
+// The programs a Lab loads, vertex and fragment shader in turn
+struct LabShaders
+{
+    const char *name;
+    const char *shaders[4];
+};
+
+static const LabShaders labShaders[] = {
+    { "Lab02_Basic_shapes",      { "vertexShader.glsl", "fragmentShader.glsl" } },
+    { "Lab03_Textures",          { "vertexShader.glsl", "fragmentShader.glsl" } },
+    { "Lab05_Transformations",   { "vertexShader.glsl", "fragmentShader.glsl" } },
+    { "Lab06_3D_worlds",         { "vertexShader.glsl", "fragmentShader.glsl" } },
+    { "Lab07_Moving_the_camera", { "vertexShader.glsl", "fragmentShader.glsl" } },
+    { "Lab08_Lighting",          { "vertexShader.glsl", "multipleLightsFragmentShader.glsl",
+                                   "lightVertexShader.glsl", "lightFragmentShader.glsl" } },
+    { "Lab09_Normal_maps",       { "vertexShader.glsl", "fragmentShader.glsl",
+                                   "lightVertexShader.glsl", "lightFragmentShader.glsl" } },
+    { "Lab10_Quaternions",       { "vertexShader.glsl", "fragmentShader.glsl",
+                                   "lightVertexShader.glsl", "lightFragmentShader.glsl" } },
+};
+
+// Load a Lab's programs, returns the total milliseconds and counts those
+// that came from the cache
+static double loadLab(const LabShaders &lab, bool cold, int &cached, int &programs)
+{
+    double milliseconds = 0.0;
+    for (int i = 0; i < 4 && lab.shaders[i]; i += 2)
+    {
+        std::string vertex   = std::string("../") + lab.name + "/" + lab.shaders[i];
+        std::string fragment = std::string("../") + lab.name + "/" + lab.shaders[i + 1];
+        if (cold)
+            remove(ProgramCache::cachePath(vertex.c_str(), fragment.c_str()).c_str());
+
+        ProgramLoadStats stats;
+        LoadShaders(vertex.c_str(), fragment.c_str(), &stats);     // deleted straight away
+        milliseconds += stats.milliseconds;
+        cached += stats.cached ? 1 : 0;
+        programs++;
+    }
+    return milliseconds;
+}
+
+int main(int argc, char **argv)
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 3;
+
+    // Hidden window for the GL context
+    if (!glfwInit())
+    {
+        printf("couldn't initialise GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("couldn't open a window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK)
+    {
+        printf("couldn't initialise GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+    if (!ProgramCache::supported())
+        printf("the driver can't save program binaries, every load compiles\n");
+
+    // Best of a few runs, cold then warm
+    const int numLabs = sizeof(labShaders) / sizeof(labShaders[0]);
+    std::vector<double> coldMs(numLabs, 1e30), warmMs(numLabs, 1e30);
+    std::vector<int> warmCached(numLabs, 0), numPrograms(numLabs, 0);
+    for (int run = 0; run < runs; run++)
+        for (int i = 0; i < numLabs; i++)
+        {
+            int cached = 0, programs = 0;
+            double cold = loadLab(labShaders[i], true, cached, programs);
+            cached = programs = 0;
+            double warm = loadLab(labShaders[i], false, cached, programs);
+            coldMs[i] = cold < coldMs[i] ? cold : coldMs[i];
+            warmMs[i] = warm < warmMs[i] ? warm : warmMs[i];
+            warmCached[i]  = cached;
+            numPrograms[i] = programs;
+        }
+
+    printf("\n%-24s %8s %8s %10s %10s %8s\n", "", "programs", "cached", "cold ms", "warm ms", "speedup");
+    double coldTotal = 0.0, warmTotal = 0.0;
+    for (int i = 0; i < numLabs; i++)
+    {
+        printf("%-24s %8d %8d %10.2f %10.2f %7.1fx\n", labShaders[i].name, numPrograms[i], warmCached[i],
+               coldMs[i], warmMs[i], coldMs[i] / warmMs[i]);
+        coldTotal += coldMs[i];
+        warmTotal += warmMs[i];
+    }
+    printf("%-24s %17s %10.2f %10.2f %7.1fx\n", "all", "", coldTotal, warmTotal, coldTotal / warmTotal);
+
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,264 @@
+// Measures tangent frame generation throughput per triangle on 1, 2, 4...
+// threads, checks the output is the same on each, and compares it with a
+// direct transcription of MikkTSpace
+//
+// Usage: Benchmark_tangents [grid size]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <common/objloader.hpp>
+#include <common/threadpool.hpp>
+#include <common/tangents.hpp>
+
+struct Mesh
+{
+    std::string name;
+    std::vector<glm::vec3> vertices, normals;
+    std::vector<glm::vec2> uvs;
+    std::vector<unsigned int> indices;
+};
+
+// The previous per-vertex accumulation, kept for comparison
+static void accumulateTangents(const Mesh &mesh, std::vector<glm::vec3> &tangents,
+                               std::vector<glm::vec3> &bitangents)
+{
+    tangents.assign(mesh.vertices.size(), glm::vec3(0.0f));
+    bitangents.assign(mesh.vertices.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        unsigned int i0 = mesh.indices[i], i1 = mesh.indices[i + 1], i2 = mesh.indices[i + 2];
+        glm::vec3 E1 = mesh.vertices[i1] - mesh.vertices[i0];
+        glm::vec3 E2 = mesh.vertices[i2] - mesh.vertices[i1];
+        float deltaU1 = mesh.uvs[i1].x - mesh.uvs[i0].x;
+        float deltaV1 = mesh.uvs[i1].y - mesh.uvs[i0].y;
+        float deltaU2 = mesh.uvs[i2].x - mesh.uvs[i1].x;
+        float deltaV2 = mesh.uvs[i2].y - mesh.uvs[i1].y;
+        float det = deltaU1 * deltaV2 - deltaU2 * deltaV1;
+        if (det == 0.0f)
+            continue;
+        float denom = 1.0f / det;
+        glm::vec3 tangent = (deltaV2 * E1 - deltaV1 * E2) * denom;
+        glm::vec3 bitangent = (deltaU1 * E2 - deltaU2 * E1) * denom;
+        tangents[i0] += tangent;
+        tangents[i1] += tangent;
+        tangents[i2] += tangent;
+        bitangents[i0] += bitangent;
+        bitangents[i1] += bitangent;
+        bitangents[i2] += bitangent;
+    }
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+    {
+        if (glm::dot(tangents[i], tangents[i]) > 0.0f)
+            tangents[i] = glm::normalize(tangents[i]);
+        if (glm::dot(bitangents[i], bitangents[i]) > 0.0f)
+            bitangents[i] = glm::normalize(bitangents[i]);
+    }
+}
+
+// Unit length v - n * dot(n, v), or 0
+static glm::vec3 projectToPlane(const glm::vec3 &v, const glm::vec3 &n)
+{
+    glm::vec3 p = v - n * glm::dot(n, v);
+    float length = glm::length(p);
+    return length > 0.0f ? p / length : glm::vec3(0.0f);
+}
+
+// MikkTSpace as written: at each corner the triangle's tangent and edges are
+// projected onto the tangent plane of the vertex normal, the tangent is
+// weighted by the angle between the projected edges, and the sums are
+// normalised. Counts the vertices whose triangles disagree on handedness,
+// which MikkTSpace would split.
+static void referenceTangents(const Mesh &mesh, std::vector<glm::vec3> &tangents, size_t &mixed)
+{
+    size_t numVertices = mesh.vertices.size();
+    std::vector<glm::vec3> sums(numVertices, glm::vec3(0.0f));
+    std::vector<int> orientation(numVertices, 0);
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        const unsigned int *t = &mesh.indices[i];
+        glm::vec3 E1 = mesh.vertices[t[1]] - mesh.vertices[t[0]];
+        glm::vec3 E2 = mesh.vertices[t[2]] - mesh.vertices[t[0]];
+        glm::vec2 D1 = mesh.uvs[t[1]] - mesh.uvs[t[0]];
+        glm::vec2 D2 = mesh.uvs[t[2]] - mesh.uvs[t[0]];
+        float det = D1.x * D2.y - D2.x * D1.y;
+        if (fabsf(det) <= FLT_MIN)
+            continue;
+        float sign = det < 0.0f ? -1.0f : 1.0f;
+        glm::vec3 tangent = sign * (D2.y * E1 - D1.y * E2);
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = t[k];
+            glm::vec3 n = glm::normalize(mesh.normals[v]);
+            glm::vec3 p = mesh.vertices[v];
+            glm::vec3 a = projectToPlane(mesh.vertices[t[(k + 1) % 3]] - p, n);
+            glm::vec3 b = projectToPlane(mesh.vertices[t[(k + 2) % 3]] - p, n);
+            float c = glm::clamp(glm::dot(a, b), -1.0f, 1.0f);
+            sums[v] += acosf(c) * projectToPlane(tangent, n);
+            orientation[v] |= sign > 0.0f ? 1 : 2;
+        }
+    }
+    tangents.resize(numVertices);
+    mixed = 0;
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        float length = glm::length(sums[v]);
+        tangents[v] = length > 0.0f ? sums[v] / length : glm::vec3(0.0f);
+        mixed += orientation[v] == 3;
+    }
+}
+
+// UV sphere with a seam, n x n quads
+static Mesh gridSphere(unsigned int n)
+{
+    Mesh mesh;
+    mesh.name = "sphere " + std::to_string(n) + "x" + std::to_string(n);
+    for (unsigned int j = 0; j <= n; j++)
+        for (unsigned int i = 0; i <= n; i++)
+        {
+            float u = static_cast<float>(i) / n, v = static_cast<float>(j) / n;
+            float theta = u * 6.2831853f, phi = v * 3.1415927f;
+            glm::vec3 p(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+            mesh.vertices.push_back(p);
+            mesh.normals.push_back(p);
+            mesh.uvs.push_back(glm::vec2(u, v));
+        }
+    for (unsigned int j = 0; j < n; j++)
+        for (unsigned int i = 0; i < n; i++)
+        {
+            unsigned int a = j * (n + 1) + i, b = a + 1, c = a + n + 1, d = c + 1;
+            unsigned int quad[6] = { a, c, b, b, c, d };
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    return mesh;
+}
+
+template <typename F>
+static double bestTime(int runs, F function)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        function();
+        auto stop = std::chrono::high_resolution_clock::now();
+        double time = std::chrono::duration<double, std::milli>(stop - start).count();
+        best = time < best ? time : best;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int gridSize = argc > 1 ? static_cast<unsigned int>(atoi(argv[1])) : 1000;
+
+    std::vector<Mesh> meshes;
+    const char *assets[] = { "sphere.obj", "suzanne.obj", "teapot.obj" };
+    for (unsigned int i = 0; i < sizeof(assets) / sizeof(assets[0]); i++)
+    {
+        Mesh mesh;
+        mesh.name = assets[i];
+        ObjData obj;
+        std::string path = std::string("../assets/") + assets[i];
+        if (!parseObj(path.c_str(), obj))
+            continue;
+        indexObj(obj, mesh.vertices, mesh.uvs, mesh.normals, mesh.indices);
+        meshes.push_back(mesh);
+    }
+    meshes.push_back(gridSphere(gridSize));
+
+    // 1, 2, 4... threads and the whole pool
+    std::vector<unsigned int> threadCounts;
+    unsigned int maxThreads = ThreadPool::global().size() + 1;
+    for (unsigned int n = 1; n < maxThreads; n *= 2)
+        threadCounts.push_back(n);
+    threadCounts.push_back(maxThreads);
+
+    printf("%-18s %10s %10s", "mesh", "triangles", "old");
+    for (size_t i = 0; i < threadCounts.size(); i++)
+        printf(" %7u thr", threadCounts[i]);
+    printf("   (ns/tri)\n");
+
+    std::vector<std::string> checks;
+    for (unsigned int m = 0; m < meshes.size(); m++)
+    {
+        const Mesh &mesh = meshes[m];
+        size_t numTriangles = mesh.indices.size() / 3;
+        size_t numVertices = mesh.vertices.size();
+        std::vector<glm::vec3> tangents(numVertices), bitangents(numVertices);
+        int runs = numTriangles > 100000 ? 3 : 20;
+        double scale = 1e6 / numTriangles;
+
+        double old = bestTime(runs, [&]() { accumulateTangents(mesh, tangents, bitangents); });
+        printf("%-18s %10zu %10.1f", mesh.name.c_str(), numTriangles, old * scale);
+
+        // Time each thread count and compare its output with one thread's
+        std::vector<glm::vec3> firstTangents, firstBitangents;
+        bool identical = true;
+        for (size_t i = 0; i < threadCounts.size(); i++)
+        {
+            double time = bestTime(runs, [&]()
+            {
+                generateTangents(mesh.vertices.data(), mesh.uvs.data(), mesh.normals.data(),
+                                 numVertices, mesh.indices.data(), mesh.indices.size(),
+                                 tangents.data(), bitangents.data(), threadCounts[i]);
+            });
+            printf(" %11.1f", time * scale);
+            if (i == 0)
+            {
+                firstTangents = tangents;
+                firstBitangents = bitangents;
+            }
+            else if (memcmp(tangents.data(), firstTangents.data(), numVertices * sizeof(glm::vec3)) != 0 ||
+                     memcmp(bitangents.data(), firstBitangents.data(), numVertices * sizeof(glm::vec3)) != 0)
+                identical = false;
+        }
+        printf("\n");
+
+        // Check the frames are finite and orthogonal to the normals, and
+        // measure the angle to the reference tangents where it has one
+        std::vector<glm::vec3> reference;
+        size_t mixed;
+        referenceTangents(mesh, reference, mixed);
+        unsigned int nans = 0;
+        float maxDot = 0.0f, maxAngle = 0.0f;
+        double sumAngle = 0.0;
+        size_t compared = 0;
+        for (size_t v = 0; v < numVertices; v++)
+        {
+            if (tangents[v] != tangents[v] || bitangents[v] != bitangents[v])
+                nans++;
+            float dot = fabsf(glm::dot(tangents[v], glm::normalize(mesh.normals[v])));
+            maxDot = dot > maxDot ? dot : maxDot;
+            if (glm::dot(reference[v], reference[v]) == 0.0f)
+                continue;
+            float angle = acosf(glm::clamp(glm::dot(tangents[v], reference[v]), -1.0f, 1.0f)) * 57.29578f;
+            maxAngle = angle > maxAngle ? angle : maxAngle;
+            sumAngle += angle;
+            compared++;
+        }
+
+        char line[256];
+        snprintf(line, sizeof(line), "%-18s %9s %6u %8.1e %9.3f %9.3f %9zu", mesh.name.c_str(),
+                 identical ? "yes" : "NO", nans, maxDot, compared ? sumAngle / compared : 0.0,
+                 maxAngle, mixed);
+        checks.push_back(line);
+    }
+
+    printf("\n%-18s %9s %6s %8s %9s %9s %9s\n", "mesh", "same", "NaNs", "max |t.n|",
+           "mean deg", "max deg", "mixed");
+    for (size_t i = 0; i < checks.size(); i++)
+        printf("%s\n", checks[i].c_str());
+    printf("\nmean/max deg: angle to the MikkTSpace tangent. mixed: vertices whose\n"
+           "triangles disagree on handedness, which MikkTSpace splits and this doesn't.\n");
+
+    return 0;
+}
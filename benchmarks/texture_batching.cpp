@@ -0,0 +1,339 @@
+// Draws a grid of materials, each with its own texture, once binding a 2D
+// texture and drawing each material on its own and once with the textures
+// packed into texture arrays and atlases, drawing every material sharing an
+// array in one instanced call. Reports the draw calls, texture binds and time
+// a frame of each, and how far apart the two images are.
+//
+// Usage: Benchmark_texture_batching [materials] [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stddef.h>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <common/stb_image.hpp>
+#include <common/image.hpp>
+#include <common/mipmap.hpp>
+#include <common/texturearray.hpp>
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Both vertex shaders place a quad of the grid from gl_VertexID
+static const char *separateVertex = R"(
+#version 330 core
+uniform vec4 quad;
+out vec2 uv;
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    uv = corner * 2.0;
+    gl_Position = vec4(quad.xy + corner * quad.zw, 0.0, 1.0);
+}
+)";
+
+static const char *separateFragment = R"(
+#version 330 core
+uniform sampler2D diffuseMap;
+in vec2 uv;
+out vec4 colour;
+void main()
+{
+    colour = texture(diffuseMap, uv);
+}
+)";
+
+static const char *packedVertex = R"(
+#version 330 core
+layout(location = 0) in vec4 quad;
+layout(location = 1) in vec4 rect;
+layout(location = 2) in float layer;
+out vec2 uv;
+flat out vec4 diffuseRect;
+flat out float diffuseLayer;
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    uv = corner * 2.0;
+    diffuseRect  = rect;
+    diffuseLayer = layer;
+    gl_Position = vec4(quad.xy + corner * quad.zw, 0.0, 1.0);
+}
+)";
+
+static const char *packedFragment = R"(
+#version 330 core
+uniform sampler2DArray diffuseMap;
+in vec2 uv;
+flat in vec4 diffuseRect;
+flat in float diffuseLayer;
+out vec4 colour;
+void main()
+{
+    vec2 st = diffuseRect.xy + fract(uv) * diffuseRect.zw;
+    colour = textureGrad(diffuseMap, vec3(st, diffuseLayer), dFdx(uv) * diffuseRect.zw,
+                         dFdy(uv) * diffuseRect.zw);
+}
+)";
+
+static GLProgram compileProgram(const char *vertex, const char *fragment)
+{
+    GLProgram program = GLProgram::create();
+    const char *sources[2] = { vertex, fragment };
+    GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    for (int i = 0; i < 2; i++)
+    {
+        unsigned int shader = glCreateShader(types[i]);
+        glShaderSource(shader, 1, &sources[i], NULL);
+        glCompileShader(shader);
+        GLint status;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (!status)
+        {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+            printf("%s\n", log);
+        }
+        glAttachShader(program.get(), shader);
+        glDeleteShader(shader);
+    }
+    glLinkProgram(program.get());
+    return program;
+}
+
+// Checks of a colour and size of its own, so that misplaced texels show
+static MipChain materialTexture(int index, int size)
+{
+    std::vector<uint8_t> pixels(static_cast<size_t>(size) * size * 4);
+    int cell = size / 8 > 0 ? size / 8 : 1;
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+        {
+            uint8_t *texel = &pixels[(static_cast<size_t>(y) * size + x) * 4];
+            bool odd = ((x / cell) + (y / cell)) % 2 == 1;
+            texel[0] = static_cast<uint8_t>(odd ? 40 * index : 255 - 40 * index);
+            texel[1] = static_cast<uint8_t>(odd ? 255 - 10 * index : 10 * index);
+            texel[2] = static_cast<uint8_t>(x * 255 / size);
+            texel[3] = 255;
+        }
+    return generateMips(pixels.data(), size, size, 4);
+}
+
+int main(int argc, char **argv)
+{
+    int materials = argc > 1 ? atoi(argv[1]) : 256;
+    int frames    = argc > 2 ? atoi(argv[2]) : 100;
+
+    // Hidden window for the GL context
+    if (!glfwInit())
+    {
+        printf("couldn't initialise GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("couldn't open a window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK)
+    {
+        printf("couldn't initialise GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+
+    {
+        // Half the materials 512x512, the rest small enough for the atlas
+        const int smallSizes[] = { 16, 32, 64, 100, 128, 200, 256 };
+        std::vector<std::shared_ptr<const MipChain>> chains;
+        for (int i = 0; i < materials; i++)
+        {
+            int size = i % 2 == 0 ? 512 : smallSizes[(i / 2) % 7];
+            chains.push_back(std::make_shared<MipChain>(materialTexture(i % 7, size)));
+        }
+
+        // Separate textures, and the same textures packed
+        std::vector<GLTexture> textures;
+        for (int i = 0; i < materials; i++)
+            textures.push_back(uploadTexture(*chains[i]));
+        TexturePacker packer;
+        for (int i = 0; i < materials; i++)
+            packer.add(chains[i]);
+        packer.pack();
+        const TexturePackStats &packStats = packer.stats();
+        printf("%d materials packed into %zu arrays and %zu atlases, %zu layers, %.1f MB, atlas %.0f%% used, %.1f ms\n",
+               materials, packStats.arrays, packStats.atlases, packStats.layers,
+               packStats.bytes / (1024.0 * 1024.0), 100.0 * packStats.atlasUse, packStats.milliseconds);
+
+        // A square grid of quads filling the framebuffer
+        int columns = static_cast<int>(ceil(sqrt(static_cast<double>(materials))));
+        float cell = 2.0f / columns;
+        std::vector<glm::vec4> quads(materials);
+        for (int i = 0; i < materials; i++)
+            quads[i] = glm::vec4(-1.0f + cell * (i % columns), -1.0f + cell * (i / columns), cell, cell);
+
+        // Render to a texture, so the default framebuffer doesn't matter
+        const int size = 1024;
+        GLTexture colour = GLTexture::create();
+        glBindTexture(GL_TEXTURE_2D, colour.get());
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        unsigned int framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colour.get(), 0);
+        glViewport(0, 0, size, size);
+
+        // The packed materials sorted by array, with their instance data
+        struct Instance
+        {
+            glm::vec4 quad;
+            glm::vec4 rect;
+            float     layer;
+        };
+        struct Batch
+        {
+            unsigned int array;
+            int first, count;
+        };
+        std::vector<Instance> instances;
+        std::vector<Batch> batches;
+        std::vector<int> order(materials);
+        for (int i = 0; i < materials; i++)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&packer](int a, int b)
+        {
+            return packer.get(a).array->texture.get() < packer.get(b).array->texture.get();
+        });
+        for (int i = 0; i < materials; i++)
+        {
+            const PackedTexture &packed = packer.get(order[i]);
+            Instance instance = { quads[order[i]], packed.rect, static_cast<float>(packed.layer) };
+            instances.push_back(instance);
+            if (batches.empty() || batches.back().array != packed.array->texture.get())
+            {
+                Batch batch = { packed.array->texture.get(), i, 0 };
+                batches.push_back(batch);
+            }
+            batches.back().count++;
+        }
+
+        unsigned int vertexArray, instanceBuffer;
+        glGenVertexArrays(1, &vertexArray);
+        glBindVertexArray(vertexArray);
+        glGenBuffers(1, &instanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), instances.data(), GL_STATIC_DRAW);
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            glEnableVertexAttribArray(i);
+            glVertexAttribDivisor(i, 1);
+        }
+
+        // GL 3.3 has no base instance, so each batch points the attributes
+        // at its first instance
+        auto pointAt = [](int first)
+        {
+            GLsizei stride = sizeof(Instance);
+            size_t offset = static_cast<size_t>(first) * stride;
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(Instance, quad)));
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(Instance, rect)));
+            glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(Instance, layer)));
+        };
+        pointAt(0);
+
+        GLProgram separateProgram = compileProgram(separateVertex, separateFragment);
+        GLProgram packedProgram   = compileProgram(packedVertex, packedFragment);
+        GLint quadLocation = glGetUniformLocation(separateProgram.get(), "quad");
+        std::vector<uint8_t> separateImage(static_cast<size_t>(size) * size * 4);
+        std::vector<uint8_t> packedImage(separateImage.size());
+
+        // One draw and bind per material
+        double separateCpuMs = 0.0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            auto frameStart = std::chrono::high_resolution_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT);
+            glUseProgram(separateProgram.get());
+            glActiveTexture(GL_TEXTURE0);
+            glUniform1i(glGetUniformLocation(separateProgram.get(), "diffuseMap"), 0);
+            for (int i = 0; i < materials; i++)
+            {
+                glBindTexture(GL_TEXTURE_2D, textures[i].get());
+                glUniform4fv(quadLocation, 1, &quads[i][0]);
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            }
+            separateCpuMs += elapsedMs(frameStart);
+            glFinish();
+        }
+        double separateMs = elapsedMs(start);
+        glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, separateImage.data());
+
+        // One instanced draw and bind per array
+        double packedCpuMs = 0.0;
+        start = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            auto frameStart = std::chrono::high_resolution_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT);
+            glUseProgram(packedProgram.get());
+            glActiveTexture(GL_TEXTURE0);
+            glUniform1i(glGetUniformLocation(packedProgram.get(), "diffuseMap"), 0);
+            for (size_t i = 0; i < batches.size(); i++)
+            {
+                glBindTexture(GL_TEXTURE_2D_ARRAY, batches[i].array);
+                pointAt(batches[i].first);
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, batches[i].count);
+            }
+            packedCpuMs += elapsedMs(frameStart);
+            glFinish();
+        }
+        double packedMs = elapsedMs(start);
+        glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, packedImage.data());
+
+        // Mean and largest difference of the two images
+        double total = 0.0;
+        int largest = 0;
+        for (size_t i = 0; i < separateImage.size(); i++)
+        {
+            int difference = abs(static_cast<int>(separateImage[i]) - static_cast<int>(packedImage[i]));
+            total += difference;
+            largest = difference > largest ? difference : largest;
+        }
+
+        printf("separate  %4d draws %4d binds a frame  cpu %7.3f ms  frame %7.3f ms\n", materials, materials,
+               separateCpuMs / frames, separateMs / frames);
+        printf("packed    %4zu draws %4zu binds a frame  cpu %7.3f ms  frame %7.3f ms\n", batches.size(),
+               batches.size(), packedCpuMs / frames, packedMs / frames);
+        printf("image difference  mean %.3f  largest %d of 255\n", total / separateImage.size(), largest);
+
+        separateProgram.reset();
+        packedProgram.reset();
+        glDeleteBuffers(1, &instanceBuffer);
+        glDeleteVertexArrays(1, &vertexArray);
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+
+    releaseGLContext();
+    glfwTerminate();
+    return 0;
+}
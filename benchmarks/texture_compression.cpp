@@ -0,0 +1,115 @@
+// Compresses the textures in assets/ to the block format their type uses,
+// reporting the encode time, the PSNR of the channels the format stores and
+// the size against RGBA8, then times loading the PNG against the KTX2
+//
+// Usage: Benchmark_texture_compression
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <chrono>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <common/stb_image.hpp>
+#include <common/blockcompress.hpp>
+#include <common/ktx.hpp>
+
+// Peak signal to noise ratio over the first channels of two RGBA images
+static double psnr(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b, int channels)
+{
+    double error = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < a.size(); i += 4)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            double difference = static_cast<double>(a[i + c]) - static_cast<double>(b[i + c]);
+            error += difference * difference;
+            count++;
+        }
+    }
+    if (error == 0.0)
+        return INFINITY;
+    return 10.0 * log10(255.0 * 255.0 * count / error);
+}
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main()
+{
+    struct Source
+    {
+        const char *path;
+        TextureCompression format;
+        int channels;
+    };
+    const Source sources[] = {
+        { "../assets/bricks_diffuse.png",  TextureCompression::BC1, 3 },
+        { "../assets/bricks_specular.png", TextureCompression::BC4, 1 },
+        { "../assets/stones_diffuse.png",  TextureCompression::BC1, 3 },
+        { "../assets/stones_specular.png", TextureCompression::BC4, 1 },
+        { "../assets/diamond_normal.png",  TextureCompression::BC5, 2 },
+        { "../assets/kratos.png",          TextureCompression::BC1, 3 },
+    };
+    const size_t count = sizeof(sources) / sizeof(sources[0]);
+
+    double totalPng = 0.0, totalKtx = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        // Decode as RGBA, as compressTexture expands images before encoding
+        int width, height, channels;
+        auto start = std::chrono::high_resolution_clock::now();
+        unsigned char *pixels = stbi_load(sources[i].path, &width, &height, &channels, 4);
+        double pngMs = elapsedMs(start);
+        if (pixels == NULL)
+        {
+            printf("couldn't load %s\n", sources[i].path);
+            return 1;
+        }
+        std::vector<uint8_t> rgba(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+
+        // Encode level 0 and decode it again to measure the error
+        TextureCompression format = sources[i].format;
+        start = std::chrono::high_resolution_clock::now();
+        CompressedTexture texture;
+        texture.format = format;
+        texture.width  = width;
+        texture.height = height;
+        texture.levels.push_back(compressImage(format, rgba.data(), width, height));
+        double encodeMs = elapsedMs(start);
+        std::vector<uint8_t> decoded = decompressImage(format, texture.levels[0].data(), width, height);
+
+        // Round trip through a KTX2 file
+        std::string ktxPath = std::string(sources[i].path) + ".benchmark.ktx2";
+        if (!writeKtx2(ktxPath.c_str(), texture))
+        {
+            printf("couldn't write %s\n", ktxPath.c_str());
+            return 1;
+        }
+        start = std::chrono::high_resolution_clock::now();
+        CompressedTexture loaded;
+        bool read = readKtx2(ktxPath.c_str(), loaded);
+        double ktxMs = elapsedMs(start);
+        remove(ktxPath.c_str());
+        if (!read || loaded.levels[0] != texture.levels[0])
+        {
+            printf("KTX2 round trip of %s failed\n", sources[i].path);
+            return 1;
+        }
+
+        printf("  %-32s %5d x %-5d %s  encode %7.1f ms  PSNR %5.1f dB  %4.1f:1  load PNG %6.1f ms  KTX2 %5.2f ms\n",
+               sources[i].path, width, height, compressionName(format), encodeMs,
+               psnr(rgba, decoded, sources[i].channels), rgba.size() / static_cast<double>(texture.bytes()),
+               pngMs, ktxMs);
+        totalPng += pngMs;
+        totalKtx += ktxMs;
+    }
+
+    printf("load  PNG %7.1f ms  KTX2 %6.2f ms, %.0fx\n", totalPng, totalKtx, totalPng / totalKtx);
+    return 0;
+}
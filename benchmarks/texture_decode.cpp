@@ -0,0 +1,73 @@
+// Times decoding the large textures in assets/ one after another on one
+// thread and all at once on a thread pool, as TextureBatch does
+//
+// Usage: Benchmark_texture_decode [threads]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <future>
+#include <chrono>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <common/stb_image.hpp>
+#include <common/threadpool.hpp>
+
+// Decode an image and free it, returns false if it couldn't be read
+static bool decode(const char *path, int &width, int &height, int &channels)
+{
+    unsigned char *pixels = stbi_load(path, &width, &height, &channels, 0);
+    stbi_image_free(pixels);
+    return pixels != NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int numThreads = argc > 1 ? static_cast<unsigned int>(atoi(argv[1])) : 0;
+    const char *paths[] = {
+        "../assets/bricks_diffuse.png",
+        "../assets/bricks_specular.png",
+        "../assets/stones_diffuse.png",
+        "../assets/stones_specular.png",
+        "../assets/diamond_normal.png",
+        "../assets/kratos.png",
+    };
+    const size_t count = sizeof(paths) / sizeof(paths[0]);
+
+    // One after another
+    double serialMs = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        int width, height, channels;
+        if (!decode(paths[i], width, height, channels))
+        {
+            printf("couldn't load %s\n", paths[i]);
+            return 1;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        printf("  %-32s %5d x %-5d x %d  %7.1f ms\n", paths[i], width, height, channels, ms);
+        serialMs += ms;
+    }
+
+    // All at once
+    ThreadPool pool(numThreads);
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::future<bool>> decoded;
+    for (size_t i = 0; i < count; i++)
+    {
+        const char *path = paths[i];
+        decoded.push_back(pool.submit([path]()
+        {
+            int width, height, channels;
+            return decode(path, width, height, channels);
+        }));
+    }
+    for (size_t i = 0; i < count; i++)
+        decoded[i].get();
+    double parallelMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    printf("serial    %7.1f ms\n", serialMs);
+    printf("parallel  %7.1f ms on %u threads, %.2fx\n", parallelMs, pool.size(), serialMs / parallelMs);
+    return 0;
+}
@@ -0,0 +1,185 @@
+// Flies a camera down a corridor of materials, each with the diffuse,
+// specular and normal maps of the assets, streaming their mipmap levels on
+// demand within a video memory budget. Reports how long the scene takes to
+// become drawable against uploading every level at once, and the memory,
+// copies and evictions of the flight.
+//
+// Usage: Benchmark_texture_streaming [materials] [budget in MB]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <common/stb_image.hpp>
+#include <common/image.hpp>
+#include <common/compressedtexture.hpp>
+#include <common/texturecache.hpp>
+#include <common/textureuploader.hpp>
+#include <common/meshoptimizer.hpp>
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    int materials = argc > 1 ? atoi(argv[1]) : 64;
+    size_t budget = static_cast<size_t>((argc > 2 ? atof(argv[2]) : 64.0) * 1024.0 * 1024.0);
+
+    // Hidden window for the GL context
+    if (!glfwInit())
+    {
+        printf("couldn't initialise GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("couldn't open a window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK)
+    {
+        printf("couldn't initialise GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+
+    {
+        // Materials alternate between the uncompressed and block compressed
+        // maps of two sets of assets
+        const char *paths[3][2] = {
+            { "../assets/bricks_diffuse.png",  "../assets/stones_diffuse.png" },
+            { "../assets/bricks_specular.png", "../assets/stones_specular.png" },
+            { "../assets/diamond_normal.png",  "../assets/suzanne_normal.png" },
+        };
+        const char *types[3] = { "diffuse", "specular", "normal" };
+        std::vector<std::shared_ptr<const MipChain>> chains;
+        std::vector<std::shared_ptr<const CompressedTexture>> compressed;
+        for (int set = 0; set < 2; set++)
+            for (int type = 0; type < 3; type++)
+            {
+                std::shared_ptr<MipChain> chain = std::make_shared<MipChain>();
+                std::shared_ptr<CompressedTexture> blocks = std::make_shared<CompressedTexture>();
+                if (!loadMipChain(paths[type][set], mipSettingsForType(types[type]), *chain) ||
+                    !loadCompressedTexture(paths[type][set], compressionForType(types[type]), *blocks))
+                {
+                    printf("couldn't load %s\n", paths[type][set]);
+                    return 1;
+                }
+                chains.push_back(chain);
+                compressed.push_back(blocks);
+            }
+
+        // Every level uploaded at once
+        size_t fullBytes = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        {
+            std::vector<GLTexture> textures;
+            for (int i = 0; i < materials; i++)
+                for (int type = 0; type < 3; type++)
+                {
+                    size_t source = (i / 2 % 2) * 3 + type;
+                    if (i % 2 == 0)
+                    {
+                        textures.push_back(uploadTexture(*chains[source]));
+                        fullBytes += textureBytes(*chains[source]);
+                    }
+                    else
+                    {
+                        textures.push_back(uploadCompressedTexture(*compressed[source]));
+                        fullBytes += compressed[source]->bytes();
+                    }
+                }
+            glFinish();
+        }
+        double eagerMs = elapsedMs(start);
+
+        // Mip tails only
+        TextureUploader uploader;
+        TextureResidency residency;
+        residency.onDemand    = true;
+        residency.budgetBytes = budget;
+        uploader.setResidency(residency);
+        std::vector<std::shared_ptr<SharedTexture>> textures;
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < materials; i++)
+            for (int type = 0; type < 3; type++)
+            {
+                size_t source = (i / 2 % 2) * 3 + type;
+                textures.push_back(std::make_shared<SharedTexture>());
+                if (i % 2 == 0)
+                    uploader.upload(textures.back(), chains[source]);
+                else
+                    uploader.upload(textures.back(), compressed[source]);
+            }
+        glFinish();
+        double tailMs = elapsedMs(start);
+        size_t tailBytes = uploader.stats().resident;
+
+        printf("%d materials, %zu textures, %.1f MB with every level\n", materials, textures.size(),
+               fullBytes / (1024.0 * 1024.0));
+        printf("drawable after  every level %8.1f ms  mip tails %6.2f ms, %.2f MB\n", eagerMs, tailMs,
+               tailBytes / (1024.0 * 1024.0));
+
+        // One material every 2 units down the corridor, 2 units across and
+        // mapped once, the camera flying past at 0.25 units a frame
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1024.0f / 768.0f, 0.2f, 100.0f);
+        size_t frames = static_cast<size_t>(materials) * 8 + 40;
+        size_t peakResident = 0, pendingFrames = 0;
+        double longestMs = 0.0;
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t frame = 0; frame < frames; frame++)
+        {
+            auto frameStart = std::chrono::high_resolution_clock::now();
+            float z = -0.25f * frame;
+            glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, z), glm::vec3(0.0f, 0.0f, z - 1.0f),
+                                         glm::vec3(0.0f, 1.0f, 0.0f));
+            for (int i = 0; i < materials; i++)
+            {
+                // In front of the camera and within 40 units
+                float distance = z - (-2.0f * i - 2.0f);
+                if (distance < 0.0f || distance > 40.0f)
+                    continue;
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(1.5f, 0.0f, -2.0f * i - 2.0f));
+                float pixelScale = lodPixelScale(projection, view * model, glm::vec3(0.0f), 1.0f, 768.0f);
+                for (int type = 0; type < 3; type++)
+                    uploader.request(textures[3 * i + type], pixelScale * 2.0f);
+            }
+            uploader.update();
+            double frameMs = elapsedMs(frameStart);
+            longestMs = frameMs > longestMs ? frameMs : longestMs;
+            peakResident = uploader.stats().resident > peakResident ? uploader.stats().resident : peakResident;
+            if (uploader.pending() > 0)
+                pendingFrames++;
+        }
+        glFinish();
+        double flightMs = elapsedMs(start);
+
+        const TextureUploadStats &stats = uploader.stats();
+        printf("flight  %zu frames %8.1f ms  longest frame %6.2f ms  %.1f MB copied, %zu levels dropped\n",
+               frames, flightMs, longestMs, stats.bytes / (1024.0 * 1024.0), stats.dropped);
+        printf("memory  peak %.1f MB of a %.1f MB budget  frames still refining %zu\n",
+               peakResident / (1024.0 * 1024.0), budget / (1024.0 * 1024.0), pendingFrames);
+    }
+
+    releaseGLContext();
+    glfwTerminate();
+    return 0;
+}
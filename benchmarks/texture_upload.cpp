@@ -0,0 +1,143 @@
+// Uploads the textures in assets/, with their mipmaps and block compressed,
+// once with a glTexImage2D per level and once streamed through the texture
+// uploader a few megabytes a frame, reporting the longest time the CPU is
+// held up in a frame and the total time until the GPU has every level
+//
+// Usage: Benchmark_texture_upload [budget in MB a frame]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <common/stb_image.hpp>
+#include <common/image.hpp>
+#include <common/compressedtexture.hpp>
+#include <common/texturecache.hpp>
+#include <common/textureuploader.hpp>
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    size_t budget = static_cast<size_t>((argc > 1 ? atof(argv[1]) : 4.0) * 1024.0 * 1024.0);
+
+    // Hidden window for the GL context
+    if (!glfwInit())
+    {
+        printf("couldn't initialise GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("couldn't open a window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK)
+    {
+        printf("couldn't initialise GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+
+    {
+        struct Source
+        {
+            const char *path;
+            const char *type;
+        };
+        const Source sources[] = {
+            { "../assets/bricks_diffuse.png",  "diffuse" },
+            { "../assets/bricks_specular.png", "specular" },
+            { "../assets/stones_diffuse.png",  "diffuse" },
+            { "../assets/stones_specular.png", "specular" },
+            { "../assets/diamond_normal.png",  "normal" },
+            { "../assets/kratos.png",          "diffuse" },
+        };
+        const size_t count = sizeof(sources) / sizeof(sources[0]);
+
+        // Load everything from the KTX2 caches first, so only uploads are timed
+        std::vector<MipChain> chains(count);
+        std::vector<CompressedTexture> compressed(count);
+        size_t bytes = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!loadMipChain(sources[i].path, mipSettingsForType(sources[i].type), chains[i]) ||
+                !loadCompressedTexture(sources[i].path, compressionForType(sources[i].type), compressed[i]))
+            {
+                printf("couldn't load %s\n", sources[i].path);
+                return 1;
+            }
+            bytes += chains[i].bytes() + compressed[i].bytes();
+        }
+        printf("%zu textures, %.1f MB with mipmaps, uncompressed and compressed\n", 2 * count,
+               bytes / (1024.0 * 1024.0));
+
+        // One synchronous upload per texture, a frame each at best
+        std::vector<GLTexture> textures;
+        double longestMs = 0.0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < count; i++)
+        {
+            auto frameStart = std::chrono::high_resolution_clock::now();
+            textures.push_back(uploadTexture(chains[i]));
+            textures.push_back(uploadCompressedTexture(compressed[i]));
+            double frameMs = elapsedMs(frameStart);
+            longestMs = frameMs > longestMs ? frameMs : longestMs;
+        }
+        glFinish();
+        double totalMs = elapsedMs(start);
+        printf("glTexImage2D  longest frame %7.2f ms  total %7.1f ms\n", longestMs, totalMs);
+        textures.clear();
+
+        // Streamed, the same textures created a frame apart, drawable at once
+        // and refined over the frames that follow
+        TextureUploader uploader;
+        std::vector<std::shared_ptr<SharedTexture>> shared;
+        longestMs = 0.0;
+        start = std::chrono::high_resolution_clock::now();
+        size_t frames = 0;
+        while (frames < count || uploader.pending() > 0)
+        {
+            auto frameStart = std::chrono::high_resolution_clock::now();
+            if (frames < count)
+            {
+                shared.push_back(std::make_shared<SharedTexture>());
+                uploader.upload(shared.back(), chains[frames]);
+                shared.push_back(std::make_shared<SharedTexture>());
+                uploader.upload(shared.back(), compressed[frames]);
+            }
+            uploader.update(budget);
+            double frameMs = elapsedMs(frameStart);
+            longestMs = frameMs > longestMs ? frameMs : longestMs;
+            frames++;
+        }
+        glFinish();
+        totalMs = elapsedMs(start);
+        const TextureUploadStats &stats = uploader.stats();
+        printf("streamed      longest frame %7.2f ms  total %7.1f ms  %.1f MB a frame over %zu frames, "
+               "%zu copies, %zu stalls\n",
+               longestMs, totalMs, budget / (1024.0 * 1024.0), frames, stats.copies, stats.stalls);
+    }
+
+    releaseGLContext();
+    glfwTerminate();
+    return 0;
+}
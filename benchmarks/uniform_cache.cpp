@@ -0,0 +1,194 @@
+// Sends the uniforms of a Lab08 frame (10 light sources, the material and
+// the model matrices of 10 teapots) to its lit program, once looking each one up
+// with glGetUniformLocation from a string built every frame as the Lab did,
+// and once through ShaderProgram. Runs both with a still scene, where
+// nothing changes between frames, and with lights and teapots that move.
+//
+// Usage: Benchmark_uniform_cache [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <common/shader.hpp>
+#include <common/shaderprogram.hpp>
+
+static const int numLights  = 10;
+static const int numObjects = 10;
+
+// The values of one frame
+struct Frame
+{
+    glm::vec3 colour[numLights], position[numLights], direction[numLights];
+    float constant, linear, quadratic, cosPhi;
+    int type[numLights];
+    float ka, kd, ks, Ns;
+    glm::mat4 M[numObjects];
+};
+
+static void makeFrame(Frame &frame, int time)
+{
+    for (int i = 0; i < numLights; i++)
+    {
+        frame.colour[i]    = glm::vec3(1.0f, 1.0f, 1.0f);
+        frame.position[i]  = glm::vec3(float(i), 2.0f, 0.01f * time);
+        frame.direction[i] = glm::vec3(0.0f, -1.0f, 0.0f);
+        frame.type[i]      = i % 3 + 1;
+    }
+    frame.constant = 1.0f, frame.linear = 0.1f, frame.quadratic = 0.02f, frame.cosPhi = 0.9f;
+    frame.ka = 0.2f, frame.kd = 0.7f, frame.ks = 1.0f, frame.Ns = 20.0f;
+    for (int j = 0; j < numObjects; j++)
+    {
+        frame.M[j] = glm::mat4(1.0f);
+        frame.M[j][3] = glm::vec4(float(j), 0.0f, -0.01f * time, 1.0f);
+    }
+}
+
+// One frame with a lookup of every uniform, as the Lab's render loop did
+static void sendByName(unsigned int shaderID, const Frame &frame)
+{
+    for (int i = 0; i < numLights; i++)
+    {
+        std::string idx = std::to_string(i);
+        glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].colour").c_str()), 1, &frame.colour[i][0]);
+        glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].position").c_str()), 1, &frame.position[i][0]);
+        glUniform1f(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].constant").c_str()), frame.constant);
+        glUniform1f(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].linear").c_str()), frame.linear);
+        glUniform1f(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].quadratic").c_str()), frame.quadratic);
+        glUniform1i(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].type").c_str()), frame.type[i]);
+        glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].direction").c_str()), 1, &frame.direction[i][0]);
+        glUniform1f(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].cosPhi").c_str()), frame.cosPhi);
+    }
+    glUniform1f(glGetUniformLocation(shaderID, "ka"), frame.ka);
+    glUniform1f(glGetUniformLocation(shaderID, "kd"), frame.kd);
+    glUniform1f(glGetUniformLocation(shaderID, "ks"), frame.ks);
+    glUniform1f(glGetUniformLocation(shaderID, "Ns"), frame.Ns);
+    for (int j = 0; j < numObjects; j++)
+        glUniformMatrix4fv(glGetUniformLocation(shaderID, "M"), 1, GL_FALSE, &frame.M[j][0][0]);
+}
+
+// The same frame through ShaderProgram with Uniforms made once
+struct FrameUniforms
+{
+    std::vector<Uniform> lights;    // 8 per light
+    Uniform ka, kd, ks, Ns, M;
+
+    FrameUniforms() : ka("ka"), kd("kd"), ks("ks"), Ns("Ns"), M("M")
+    {
+        const char *fields[] = { "colour", "position", "constant", "linear",
+                                 "quadratic", "type", "direction", "cosPhi" };
+        for (int i = 0; i < numLights; i++)
+            for (int j = 0; j < 8; j++)
+                lights.push_back(Uniform("lightSources[" + std::to_string(i) + "]." + fields[j]));
+    }
+};
+
+static void sendByUniform(ShaderProgram &program, const FrameUniforms &uniforms, const Frame &frame)
+{
+    for (int i = 0; i < numLights; i++)
+    {
+        const Uniform *light = &uniforms.lights[8 * i];
+        program.set(light[0], frame.colour[i]);
+        program.set(light[1], frame.position[i]);
+        program.set(light[2], frame.constant);
+        program.set(light[3], frame.linear);
+        program.set(light[4], frame.quadratic);
+        program.set(light[5], frame.type[i]);
+        program.set(light[6], frame.direction[i]);
+        program.set(light[7], frame.cosPhi);
+    }
+    program.set(uniforms.ka, frame.ka);
+    program.set(uniforms.kd, frame.kd);
+    program.set(uniforms.ks, frame.ks);
+    program.set(uniforms.Ns, frame.Ns);
+    for (int j = 0; j < numObjects; j++)
+        program.set(uniforms.M, frame.M[j]);
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 2000;
+
+    // Hidden window for the GL context
+    if (!glfwInit())
+    {
+        printf("couldn't initialise GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("couldn't open a window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK)
+    {
+        printf("couldn't initialise GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+    glGetError();   // GLEW can leave an error from probing extensions
+
+    GLProgram shader = LoadShaders("../Lab08_Lighting/vertexShader.glsl",
+                                   "../Lab08_Lighting/multipleLightsFragmentShader.glsl");
+    if (!shader)
+        return 1;
+    unsigned int shaderID = shader.get();
+    glUseProgram(shaderID);
+
+    std::vector<Frame> moving(frames);
+    for (int f = 0; f < frames; f++)
+        makeFrame(moving[f], f);
+
+    const char *scenes[2] = { "still", "moving" };
+    printf("\n%-8s %12s %12s %12s %12s\n", "", "by name ms", "cached ms", "gl calls", "skipped");
+    for (int scene = 0; scene < 2; scene++)
+    {
+        // Looked up every frame
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++)
+            sendByName(shaderID, moving[scene == 0 ? 0 : f]);
+        glFinish();
+        double byName = elapsedMs(start);
+
+        // Resolved once, unchanged values skipped
+        ShaderProgram::release(shaderID);
+        ShaderProgram &program = ShaderProgram::get(shaderID);
+        FrameUniforms uniforms;
+        ShaderProgram::stats() = UniformStats();
+        start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++)
+            sendByUniform(program, uniforms, moving[scene == 0 ? 0 : f]);
+        glFinish();
+        double cached = elapsedMs(start);
+
+        printf("%-8s %12.2f %12.2f %12.1f %12.1f\n", scenes[scene], byName, cached,
+               double(ShaderProgram::stats().sent) / frames, double(ShaderProgram::stats().skipped) / frames);
+    }
+    printf("by name looks up and sends all %d uniforms every frame\n", numLights * 8 + 4 + numObjects);
+    if (glGetError() != GL_NO_ERROR)
+        printf("GL error\n");
+
+    shader.reset();
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Sends the camera and 100 objects to Lab09's lit program every frame, once
+// as the render loop used to, making the projection every frame and an MV
+// and MVP matrix for every object, and once through ViewBuffer, which
+// uploads the camera's matrices when it changes so that objects only send
+// their model matrix. Runs with a still camera and with one that turns.
+//
+// The program no longer has MVP and MV uniforms, so the old loop sends its
+// two matrices to M, which costs the driver the same.
+//
+// Usage: Benchmark_view_buffer [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <common/shader.hpp>
+#include <common/shaderprogram.hpp>
+#include <common/camera.hpp>
+#include <common/viewbuffer.hpp>
+
+static const int numObjects = 100;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 2000;
+
+    // Hidden window for the GL context
+    if (!glfwInit())
+    {
+        printf("couldn't initialise GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("couldn't open a window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK)
+    {
+        printf("couldn't initialise GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+    glGetError();   // GLEW can leave an error from probing extensions
+
+    GLProgram shader = LoadShaders("../Lab09_Normal_maps/vertexShader.glsl",
+                                   "../Lab09_Normal_maps/fragmentShader.glsl");
+    if (!shader)
+        return 1;
+    unsigned int shaderID = shader.get();
+    glUseProgram(shaderID);
+    ShaderProgram &program = ShaderProgram::get(shaderID);
+    GLint location = glGetUniformLocation(shaderID, "M");
+    Uniform MUniform("M");
+
+    // Objects in a grid
+    std::vector<glm::mat4> models(numObjects);
+    for (int i = 0; i < numObjects; i++)
+        models[i] = glm::translate(glm::mat4(1.0f), glm::vec3(float(i % 10), 0.0f, float(i / 10)));
+
+    const char *scenes[2] = { "still", "turning" };
+    printf("\n%-8s %12s %12s %12s %12s\n", "", "old ms", "buffer ms", "matrices", "uploads");
+    for (int scene = 0; scene < 2; scene++)
+    {
+        // The projection every frame, two products and two matrices an object
+        Camera oldCamera(glm::vec3(0.0f, 2.0f, -5.0f), glm::vec3(0.0f));
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++)
+        {
+            oldCamera.yaw = scene == 0 ? 0.0f : 0.001f * f;
+            oldCamera.calculateCameraVectors();
+            glm::mat4 view = glm::lookAt(oldCamera.eye, oldCamera.eye + oldCamera.front, oldCamera.worldUp);
+            glm::mat4 projection = glm::perspective(oldCamera.fov, oldCamera.aspect, oldCamera.near, oldCamera.far);
+            for (int i = 0; i < numObjects; i++)
+            {
+                glm::mat4 MV  = view * models[i];
+                glm::mat4 MVP = projection * MV;
+                glUniformMatrix4fv(location, 1, GL_FALSE, &MVP[0][0]);
+                glUniformMatrix4fv(location, 1, GL_FALSE, &MV[0][0]);
+            }
+        }
+        glFinish();
+        double oldMs = elapsedMs(start);
+
+        // The camera's matrices when they change, one matrix an object
+        Camera camera(glm::vec3(0.0f, 2.0f, -5.0f), glm::vec3(0.0f));
+        ViewBuffer viewBuffer;
+        ShaderProgram::stats() = UniformStats();
+        start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++)
+        {
+            camera.yaw = scene == 0 ? 0.0f : 0.001f * f;
+            camera.calculateMatrices();
+            viewBuffer.update(camera);
+            for (int i = 0; i < numObjects; i++)
+                program.set(MUniform, models[i]);
+        }
+        glFinish();
+        double bufferMs = elapsedMs(start);
+
+        printf("%-8s %12.2f %12.2f %12.1f %12.2f\n", scenes[scene], oldMs, bufferMs,
+               double(ShaderProgram::stats().sent) / frames, double(viewBuffer.uploads) / frames);
+        viewBuffer.deleteBuffers();
+    }
+    printf("the old loop sends %d matrices a frame\n", 2 * numObjects);
+    if (glGetError() != GL_NO_ERROR)
+        printf("GL error\n");
+
+    shader.reset();
+    glfwTerminate();
+    return 0;
+}
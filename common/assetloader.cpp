@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <utility>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include "assetloader.hpp"
+#include "compressedtexture.hpp"
+
+// Create a 1x1 texture of a single colour
+static GLTexture solidTexture(unsigned char r, unsigned char g, unsigned char b, unsigned char a = 255)
+{
+    Image image;
+    image.width    = 1;
+    image.height   = 1;
+    image.channels = 4;
+    unsigned char pixel[4] = { r, g, b, a };
+    image.pixels   = pixel;
+    GLTexture texture = uploadTexture(image);
+    image.pixels   = NULL;
+    return texture;
+}
+
+AssetLoader::AssetLoader(ThreadPool &pool) : pool(pool)
+{
+    // Mid grey diffuse, flat tangent space normal and no specular
+    diffusePlaceholder  = solidTexture(128, 128, 128);
+    normalPlaceholder   = solidTexture(128, 128, 255);
+    specularPlaceholder = solidTexture(0, 0, 0);
+    materialPlaceholder = solidTexture(128, 128, 128, 0);
+}
+
+AssetLoader::~AssetLoader()
+{
+    // Wait for the workers, as they write into models shared with the caller
+    for (size_t i = 0; i < models.size(); i++)
+        models[i].loaded.wait();
+    for (size_t i = 0; i < textures.size(); i++)
+        textures[i].decoded.wait();
+}
+
+std::shared_ptr<Model> AssetLoader::loadModel(const char *path, const ModelSettings &settings,
+                                              Model *placeholder)
+{
+    std::shared_ptr<Model> model = std::make_shared<Model>(settings);
+    model->placeholder = placeholder;
+
+    PendingModel pending;
+    pending.model  = model;
+    std::string file(path);
+    pending.loaded = pool.submit([model, file]() { return model->loadMesh(file.c_str()); });
+    models.push_back(std::move(pending));
+    return model;
+}
+
+void AssetLoader::addTexture(const std::shared_ptr<Model> &model, const char *path,
+                             const std::string type)
+{
+    // Bind a placeholder in the texture's slot for now
+    unsigned int placeholder = diffusePlaceholder.get();
+    if (type == "normal")
+        placeholder = normalPlaceholder.get();
+    else if (type == "specular")
+        placeholder = specularPlaceholder.get();
+
+    MaterialTexture texture;
+    texture.path = path;
+    queue(model, texture, type, model->textureCompression(type), placeholder);
+}
+
+void AssetLoader::addMaterial(const std::shared_ptr<Model> &model, const char *diffusePath,
+                              const char *specularPath, const char *normalPath)
+{
+    MaterialTexture diffuse;
+    diffuse.path = diffusePath;
+    diffuse.specularPath = specularPath;
+    queue(model, diffuse, "diffuse", model->materialCompression("diffuse"), materialPlaceholder.get());
+
+    MaterialTexture normal;
+    normal.path = normalPath;
+    normal.normalMap = true;
+    queue(model, normal, "normal", model->materialCompression("normal"), normalPlaceholder.get());
+}
+
+void AssetLoader::queue(const std::shared_ptr<Model> &model, const MaterialTexture &texture,
+                        const std::string &type, TextureCompression compression, unsigned int placeholder)
+{
+    // Share a texture that is already loaded
+    size_t slot = model->addTexture(placeholder, type);
+    MipSettings mips = model->mipSettings(type);
+    std::string name = texture.name();
+    TextureHandle cached = TextureCache::global().find(name.c_str(), compression, TextureSampling(), mips);
+    if (cached)
+    {
+        model->setTexture(slot, cached);
+        return;
+    }
+
+    PendingTexture pending;
+    pending.model = model;
+    pending.slot  = slot;
+    pending.name  = name;
+    pending.compression = compression;
+    pending.decoded = pool.submit([texture, compression, mips]()
+    {
+        DecodedTexture decoded;
+        loadMaterialTexture(texture, compression, mips, decoded.compressed, decoded.mips);
+        decoded.mips.settings = mips;
+        return decoded;
+    });
+    textures.push_back(std::move(pending));
+}
+
+bool AssetLoader::uploadNext(bool wait)
+{
+    // Models first so that geometry appears before its textures
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        PendingModel &pending = models[i];
+        if (!wait && pending.loaded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+        if (pending.loaded.get())
+            pending.model->upload();
+        models.erase(models.begin() + i);
+        return true;
+    }
+
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        PendingTexture &pending = textures[i];
+        if (!wait && pending.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+        DecodedTexture decoded = pending.decoded.get();
+        if (!decoded.compressed.levels.empty())
+            pending.model->setTexture(pending.slot, TextureCache::global().insert(
+                pending.name.c_str(), pending.compression, std::move(decoded.compressed)));
+        else if (!decoded.mips.levels.empty())
+            pending.model->setTexture(pending.slot, TextureCache::global().insert(pending.name.c_str(), std::move(decoded.mips)));
+        else
+            printf("Texture %s failed to load.\n", pending.name.c_str());
+        textures.erase(textures.begin() + i);
+        return true;
+    }
+
+    return false;
+}
+
+void AssetLoader::update(float budgetMs)
+{
+    // Delete GL objects the workers let go of
+    deletePendingGLObjects();
+    
+    auto start = std::chrono::steady_clock::now();
+    while (uploadNext(false))
+    {
+        float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= budgetMs)
+            break;
+    }
+}
+
+void AssetLoader::finish()
+{
+    while (uploadNext(true))
+    {
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <future>
+
+#include "model.hpp"
+#include "image.hpp"
+#include "threadpool.hpp"
+
+// Loads models and textures in the background. File reading, parsing and
+// image decoding run on a thread pool; update() then finishes the GL uploads
+// on the context thread within a time budget per frame.
+class AssetLoader
+{
+public:
+    // Constructor, creates the placeholder textures so needs a GL context
+    AssetLoader(ThreadPool &pool = ThreadPool::global());
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader &) = delete;
+    AssetLoader &operator=(const AssetLoader &) = delete;
+
+    // Start loading a model. The model is returned straight away and draws
+    // the placeholder model, if any, until it is ready.
+    std::shared_ptr<Model> loadModel(const char *path,
+                                     const ModelSettings &settings = ModelSettings(),
+                                     Model *placeholder = NULL);
+
+    // Start loading a texture for a model. A 1x1 placeholder suited to the
+    // texture type is bound until it is ready. A texture already in the
+    // global texture cache is bound straight away.
+    void addTexture(const std::shared_ptr<Model> &model, const char *path,
+                    const std::string type);
+
+    // Start loading the textures of a packed material for a model, as
+    // Model::addMaterial() does
+    void addMaterial(const std::shared_ptr<Model> &model, const char *diffusePath,
+                     const char *specularPath, const char *normalPath);
+
+    // Upload finished assets until budgetMs milliseconds have been spent.
+    // Call once per frame on the GL context thread.
+    void update(float budgetMs = 2.0f);
+
+    // Block until everything queued is loaded and uploaded
+    void finish();
+
+    // Number of assets not yet uploaded
+    size_t pending() const { return models.size() + textures.size(); }
+
+private:
+    struct PendingModel
+    {
+        std::shared_ptr<Model> model;
+        std::future<bool>      loaded;
+    };
+
+    // Mipmaps loaded by a worker, or the compressed levels if it has any
+    struct DecodedTexture
+    {
+        MipChain          mips;
+        CompressedTexture compressed;
+    };
+
+    struct PendingTexture
+    {
+        std::shared_ptr<Model>      model;
+        size_t                      slot;
+        std::string                 name;   // shared under in the texture cache
+        TextureCompression          compression;
+        std::future<DecodedTexture> decoded;
+    };
+
+    ThreadPool                 &pool;
+    std::deque<PendingModel>   models;
+    std::deque<PendingTexture> textures;
+
+    // Placeholder textures
+    GLTexture diffusePlaceholder;
+    GLTexture normalPlaceholder;
+    GLTexture specularPlaceholder;
+    GLTexture materialPlaceholder;  // diffuse with no specular in its alpha
+
+    // Bind a placeholder in a new slot of a model and start loading a texture
+    void queue(const std::shared_ptr<Model> &model, const MaterialTexture &texture, const std::string &type,
+               TextureCompression compression, unsigned int placeholder);
+
+    // Upload the next finished asset, returns false if none are finished
+    bool uploadNext(bool wait);
+};
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <string>
+#include <atomic>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "atomicfile.hpp"
+
+bool writeFileAtomically(const char *path, const std::function<bool(FILE *)> &write)
+{
+    // Unique to the process and the call, so that two workers or two
+    // instances writing the same file don't write into each other's
+    static std::atomic<unsigned int> counter(0);
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%d-%u.tmp", static_cast<int>(getpid()), counter++);
+    std::string temporaryPath = std::string(path) + suffix;
+    FILE *file = fopen(temporaryPath.c_str(), "wb");
+    if (file == NULL)
+        return false;
+
+    bool ok = write(file);
+    ok = fclose(file) == 0 && ok;
+
+    // rename replaces path in one step on POSIX, Windows needs it removed
+    if (ok)
+    {
+#ifdef _WIN32
+        remove(path);
+#endif
+        ok = rename(temporaryPath.c_str(), path) == 0;
+    }
+    if (!ok)
+        remove(temporaryPath.c_str());
+    return ok;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdio.h>
+#include <functional>
+
+// Write a file through a temporary file named after the process and a
+// counter, renamed to path once write has returned true, so that a crash or
+// a concurrent writer never leaves a half written file at path
+bool writeFileAtomically(const char *path, const std::function<bool(FILE *)> &write);
@@ -0,0 +1,509 @@
+#include <string.h>
+#include <float.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOCKCOMPRESS_SSE2 1
+#endif
+
+#include "blockcompress.hpp"
+#include "threadpool.hpp"
+
+const char *compressionName(TextureCompression format)
+{
+    switch (format)
+    {
+        case TextureCompression::BC1: return "BC1";
+        case TextureCompression::BC3: return "BC3";
+        case TextureCompression::BC4: return "BC4";
+        case TextureCompression::BC5: return "BC5";
+        default:                      return "none";
+    }
+}
+
+size_t blockBytes(TextureCompression format)
+{
+    switch (format)
+    {
+        case TextureCompression::BC1:
+        case TextureCompression::BC4:
+            return 8;
+        case TextureCompression::BC3:
+        case TextureCompression::BC5:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+size_t compressedSize(TextureCompression format, int width, int height)
+{
+    size_t blocksX = static_cast<size_t>((width + 3) / 4);
+    size_t blocksY = static_cast<size_t>((height + 3) / 4);
+    return blocksX * blocksY * blockBytes(format);
+}
+
+// -----------------------------------------------------------------------------
+// Colour blocks (BC1, and the colour half of BC3)
+
+// Round a colour to 5:6:5
+static uint16_t pack565(const float colour[3])
+{
+    int r = static_cast<int>(colour[0] * (31.0f / 255.0f) + 0.5f);
+    int g = static_cast<int>(colour[1] * (63.0f / 255.0f) + 0.5f);
+    int b = static_cast<int>(colour[2] * (31.0f / 255.0f) + 0.5f);
+    r = r < 0 ? 0 : (r > 31 ? 31 : r);
+    g = g < 0 ? 0 : (g > 63 ? 63 : g);
+    b = b < 0 ? 0 : (b > 31 ? 31 : b);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+// Expand a 5:6:5 colour to 8 bits a channel
+static void unpack565(uint16_t packed, int colour[3])
+{
+    int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+    colour[0] = (r << 3) | (r >> 2);
+    colour[1] = (g << 2) | (g >> 4);
+    colour[2] = (b << 3) | (b >> 2);
+}
+
+// The four colours of a block in four colour mode, in index order
+static void colourPalette(uint16_t c0, uint16_t c1, float palette[4][3])
+{
+    int a[3], b[3];
+    unpack565(c0, a);
+    unpack565(c1, b);
+    for (int k = 0; k < 3; k++)
+    {
+        palette[0][k] = static_cast<float>(a[k]);
+        palette[1][k] = static_cast<float>(b[k]);
+        palette[2][k] = static_cast<float>((2 * a[k] + b[k]) / 3);
+        palette[3][k] = static_cast<float>((a[k] + 2 * b[k]) / 3);
+    }
+}
+
+// Give each pixel the index of its nearest palette colour, returns the
+// total squared error
+static float assignColourIndices(const float *r, const float *g, const float *b,
+                                 const float palette[4][3], uint8_t indices[16])
+{
+    float error = 0.0f;
+
+#if defined(BLOCKCOMPRESS_SSE2)
+    // Four pixels at a time
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128 pr = _mm_loadu_ps(r + i);
+        __m128 pg = _mm_loadu_ps(g + i);
+        __m128 pb = _mm_loadu_ps(b + i);
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (int j = 0; j < 4; j++)
+        {
+            __m128 dr = _mm_sub_ps(pr, _mm_set1_ps(palette[j][0]));
+            __m128 dg = _mm_sub_ps(pg, _mm_set1_ps(palette[j][1]));
+            __m128 db = _mm_sub_ps(pb, _mm_set1_ps(palette[j][2]));
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+            best = _mm_min_ps(distance, best);
+            bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(j)), _mm_andnot_si128(closer, bestIndex));
+        }
+
+        float distances[4];
+        int32_t chosen[4];
+        _mm_storeu_ps(distances, best);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(chosen), bestIndex);
+        for (int k = 0; k < 4; k++)
+        {
+            indices[i + k] = static_cast<uint8_t>(chosen[k]);
+            error += distances[k];
+        }
+    }
+#else
+    for (int i = 0; i < 16; i++)
+    {
+        float best = FLT_MAX;
+        for (int j = 0; j < 4; j++)
+        {
+            float dr = r[i] - palette[j][0], dg = g[i] - palette[j][1], db = b[i] - palette[j][2];
+            float distance = dr * dr + dg * dg + db * db;
+            if (distance < best)
+            {
+                best = distance;
+                indices[i] = static_cast<uint8_t>(j);
+            }
+        }
+        error += best;
+    }
+#endif
+
+    return error;
+}
+
+// Endpoints minimising the squared error for a fixed set of indices
+static bool fitEndpoints(const float *r, const float *g, const float *b, const uint8_t indices[16],
+                         float end0[3], float end1[3])
+{
+    // Weight of the second endpoint for each index
+    static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+    {
+        float w1 = weights[indices[i]], w0 = 1.0f - w1;
+        aa += w0 * w0;
+        ab += w0 * w1;
+        bb += w1 * w1;
+        ax[0] += w0 * r[i]; ax[1] += w0 * g[i]; ax[2] += w0 * b[i];
+        bx[0] += w1 * r[i]; bx[1] += w1 * g[i]; bx[2] += w1 * b[i];
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (determinant < 1e-6f)
+        return false;
+    for (int k = 0; k < 3; k++)
+    {
+        end0[k] = (bb * ax[k] - ab * bx[k]) / determinant;
+        end1[k] = (aa * bx[k] - ab * ax[k]) / determinant;
+    }
+    return true;
+}
+
+// Encode the colour of 16 pixels into an 8 byte block, always in four
+// colour mode. Endpoints start from the ends of the principal axis of the
+// colours and are then refined by least squares.
+static void encodeColourBlock(const uint8_t rgba[64], uint8_t block[8])
+{
+    float r[16], g[16], b[16];
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+    {
+        r[i] = rgba[4 * i + 0];
+        g[i] = rgba[4 * i + 1];
+        b[i] = rgba[4 * i + 2];
+        mean[0] += r[i]; mean[1] += g[i]; mean[2] += b[i];
+    }
+    for (int k = 0; k < 3; k++)
+        mean[k] /= 16.0f;
+
+    // Covariance of the colours
+    float xx = 0.0f, xy = 0.0f, xz = 0.0f, yy = 0.0f, yz = 0.0f, zz = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float x = r[i] - mean[0], y = g[i] - mean[1], z = b[i] - mean[2];
+        xx += x * x; xy += x * y; xz += x * z;
+        yy += y * y; yz += y * z; zz += z * z;
+    }
+
+    // Principal axis by power iteration
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float x = xx * axis[0] + xy * axis[1] + xz * axis[2];
+        float y = xy * axis[0] + yy * axis[1] + yz * axis[2];
+        float z = xz * axis[0] + yz * axis[1] + zz * axis[2];
+        float largest = x * x > y * y ? x : y;
+        largest = largest * largest > z * z ? largest : z;
+        if (largest == 0.0f)
+            break;
+        axis[0] = x / largest; axis[1] = y / largest; axis[2] = z / largest;
+    }
+    float length2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+    // Ends of the colours along the axis
+    float minT = 0.0f, maxT = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = ((r[i] - mean[0]) * axis[0] + (g[i] - mean[1]) * axis[1] + (b[i] - mean[2]) * axis[2]) / length2;
+        minT = t < minT ? t : minT;
+        maxT = t > maxT ? t : maxT;
+    }
+    float end0[3], end1[3];
+    for (int k = 0; k < 3; k++)
+    {
+        end0[k] = mean[k] + axis[k] * maxT;
+        end1[k] = mean[k] + axis[k] * minT;
+    }
+
+    // Quantise, assign and refine, keeping the best
+    uint16_t bestC0 = 0, bestC1 = 0;
+    uint8_t bestIndices[16] = { 0 };
+    float bestError = FLT_MAX;
+    for (int iteration = 0; iteration < 3; iteration++)
+    {
+        uint16_t c0 = pack565(end0), c1 = pack565(end1);
+        float palette[4][3];
+        colourPalette(c0, c1, palette);
+        uint8_t indices[16];
+        float error = assignColourIndices(r, g, b, palette, indices);
+        if (error < bestError)
+        {
+            bestError = error;
+            bestC0 = c0;
+            bestC1 = c1;
+            memcpy(bestIndices, indices, 16);
+        }
+        if (error == 0.0f || !fitEndpoints(r, g, b, indices, end0, end1))
+            break;
+    }
+
+    // Four colour mode needs c0 > c1, swapping the endpoints swaps the
+    // indices 0 and 1, and 2 and 3
+    if (bestC0 < bestC1)
+    {
+        uint16_t swap = bestC0;
+        bestC0 = bestC1;
+        bestC1 = swap;
+        for (int i = 0; i < 16; i++)
+            bestIndices[i] ^= 1;
+    }
+    else if (bestC0 == bestC1)
+        memset(bestIndices, 0, 16);
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++)
+        bits |= static_cast<uint32_t>(bestIndices[i]) << (2 * i);
+    block[0] = static_cast<uint8_t>(bestC0);
+    block[1] = static_cast<uint8_t>(bestC0 >> 8);
+    block[2] = static_cast<uint8_t>(bestC1);
+    block[3] = static_cast<uint8_t>(bestC1 >> 8);
+    block[4] = static_cast<uint8_t>(bits);
+    block[5] = static_cast<uint8_t>(bits >> 8);
+    block[6] = static_cast<uint8_t>(bits >> 16);
+    block[7] = static_cast<uint8_t>(bits >> 24);
+}
+
+static void decodeColourBlock(const uint8_t block[8], uint8_t rgba[64], bool fourColour)
+{
+    uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    int a[3], b[3];
+    unpack565(c0, a);
+    unpack565(c1, b);
+
+    uint8_t palette[4][4];
+    for (int k = 0; k < 3; k++)
+    {
+        palette[0][k] = static_cast<uint8_t>(a[k]);
+        palette[1][k] = static_cast<uint8_t>(b[k]);
+        if (fourColour || c0 > c1)
+        {
+            palette[2][k] = static_cast<uint8_t>((2 * a[k] + b[k]) / 3);
+            palette[3][k] = static_cast<uint8_t>((a[k] + 2 * b[k]) / 3);
+        }
+        else
+        {
+            palette[2][k] = static_cast<uint8_t>((a[k] + b[k]) / 2);
+            palette[3][k] = 0;
+        }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = (fourColour || c0 > c1) ? 255 : 0;
+
+    uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    for (int i = 0; i < 16; i++)
+        memcpy(rgba + 4 * i, palette[(bits >> (2 * i)) & 3], 4);
+}
+
+// -----------------------------------------------------------------------------
+// Single channel blocks (BC4, both halves of BC5 and the alpha of BC3)
+
+// Encode 16 values into an 8 byte block in eight value mode, with the
+// values' minimum and maximum as endpoints
+static void encodeChannelBlock(const uint8_t values[16], uint8_t block[8])
+{
+    int high = values[0], low = values[0];
+    for (int i = 1; i < 16; i++)
+    {
+        high = values[i] > high ? values[i] : high;
+        low  = values[i] < low  ? values[i] : low;
+    }
+
+    // Position of each value between the endpoints, 0 at high and 7 at low
+    int steps[16];
+    if (high == low)
+        memset(steps, 0, sizeof(steps));
+    else
+    {
+        float scale = 7.0f / static_cast<float>(high - low);
+#if defined(BLOCKCOMPRESS_SSE2)
+        for (int i = 0; i < 16; i += 4)
+        {
+            __m128i v = _mm_setr_epi32(values[i], values[i + 1], values[i + 2], values[i + 3]);
+            __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_set1_epi32(high), v)), _mm_set1_ps(scale));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(steps + i), _mm_cvtps_epi32(t));
+        }
+#else
+        for (int i = 0; i < 16; i++)
+            steps[i] = static_cast<int>((high - values[i]) * scale + 0.5f);
+#endif
+    }
+
+    // Indices 0 and 1 are the endpoints, 2 to 7 the steps between them
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int step = steps[i];
+        int index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+        bits |= static_cast<uint64_t>(index) << (3 * i);
+    }
+    block[0] = static_cast<uint8_t>(high);
+    block[1] = static_cast<uint8_t>(low);
+    for (int i = 0; i < 6; i++)
+        block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+}
+
+static void decodeChannelBlock(const uint8_t block[8], uint8_t values[16])
+{
+    int v0 = block[0], v1 = block[1];
+    uint8_t palette[8];
+    palette[0] = static_cast<uint8_t>(v0);
+    palette[1] = static_cast<uint8_t>(v1);
+    if (v0 > v1)
+    {
+        for (int i = 2; i < 8; i++)
+            palette[i] = static_cast<uint8_t>(((8 - i) * v0 + (i - 1) * v1 + 3) / 7);
+    }
+    else
+    {
+        for (int i = 2; i < 6; i++)
+            palette[i] = static_cast<uint8_t>(((6 - i) * v0 + (i - 1) * v1 + 2) / 5);
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+        bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; i++)
+        values[i] = palette[(bits >> (3 * i)) & 7];
+}
+
+// -----------------------------------------------------------------------------
+
+void encodeBlock(TextureCompression format, const uint8_t rgba[64], uint8_t *block)
+{
+    uint8_t channel[16];
+    switch (format)
+    {
+        case TextureCompression::BC1:
+            encodeColourBlock(rgba, block);
+            break;
+
+        case TextureCompression::BC3:
+            for (int i = 0; i < 16; i++)
+                channel[i] = rgba[4 * i + 3];
+            encodeChannelBlock(channel, block);
+            encodeColourBlock(rgba, block + 8);
+            break;
+
+        case TextureCompression::BC4:
+        case TextureCompression::BC5:
+            for (int i = 0; i < 16; i++)
+                channel[i] = rgba[4 * i];
+            encodeChannelBlock(channel, block);
+            if (format == TextureCompression::BC4)
+                break;
+            for (int i = 0; i < 16; i++)
+                channel[i] = rgba[4 * i + 1];
+            encodeChannelBlock(channel, block + 8);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void decodeBlock(TextureCompression format, const uint8_t *block, uint8_t rgba[64])
+{
+    uint8_t channel[16];
+    switch (format)
+    {
+        case TextureCompression::BC1:
+            decodeColourBlock(block, rgba, false);
+            break;
+
+        case TextureCompression::BC3:
+            decodeColourBlock(block + 8, rgba, true);
+            decodeChannelBlock(block, channel);
+            for (int i = 0; i < 16; i++)
+                rgba[4 * i + 3] = channel[i];
+            break;
+
+        case TextureCompression::BC4:
+        case TextureCompression::BC5:
+            memset(rgba, 0, 64);
+            decodeChannelBlock(block, channel);
+            for (int i = 0; i < 16; i++)
+            {
+                rgba[4 * i]     = channel[i];
+                rgba[4 * i + 3] = 255;
+            }
+            if (format == TextureCompression::BC4)
+                break;
+            decodeChannelBlock(block + 8, channel);
+            for (int i = 0; i < 16; i++)
+                rgba[4 * i + 1] = channel[i];
+            break;
+
+        default:
+            memset(rgba, 0, 64);
+            break;
+    }
+}
+
+std::vector<uint8_t> compressImage(TextureCompression format, const uint8_t *rgba,
+                                   int width, int height)
+{
+    size_t bytes = blockBytes(format);
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    std::vector<uint8_t> blocks(compressedSize(format, width, height));
+    if (blocks.empty())
+        return blocks;
+
+    // One row of blocks per task
+    uint8_t *output = blocks.data();
+    ThreadPool::global().parallelFor(static_cast<size_t>(blocksY), [=](size_t by)
+    {
+        uint8_t pixels[64];
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            for (int y = 0; y < 4; y++)
+            {
+                int row = static_cast<int>(by) * 4 + y;
+                row = row < height ? row : height - 1;
+                for (int x = 0; x < 4; x++)
+                {
+                    int column = bx * 4 + x;
+                    column = column < width ? column : width - 1;
+                    memcpy(pixels + 4 * (4 * y + x), rgba + 4 * (static_cast<size_t>(row) * width + column), 4);
+                }
+            }
+            encodeBlock(format, pixels, output + (by * blocksX + bx) * bytes);
+        }
+    });
+    return blocks;
+}
+
+std::vector<uint8_t> decompressImage(TextureCompression format, const uint8_t *blocks,
+                                     int width, int height)
+{
+    size_t bytes = blockBytes(format);
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+
+    uint8_t pixels[64];
+    for (int by = 0; by < blocksY; by++)
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            decodeBlock(format, blocks + (static_cast<size_t>(by) * blocksX + bx) * bytes, pixels);
+            for (int y = 0; y < 4 && by * 4 + y < height; y++)
+                for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+                    memcpy(&rgba[4 * ((static_cast<size_t>(by) * 4 + y) * width + bx * 4 + x)],
+                           pixels + 4 * (4 * y + x), 4);
+        }
+    return rgba;
+}
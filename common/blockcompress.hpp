@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+// Block compressed texture formats, all made of 4x4 texel blocks
+enum class TextureCompression
+{
+    None,
+    BC1,    // RGB, 8 bytes a block, for colour maps
+    BC3,    // RGBA, 16 bytes a block, for colour maps with alpha
+    BC4,    // one channel, 8 bytes a block, for specular and other masks
+    BC5     // two channels, 16 bytes a block, for the x and y of normal maps
+};
+
+// Name of a format, e.g. "BC1"
+const char *compressionName(TextureCompression format);
+
+// Size in bytes of one block
+size_t blockBytes(TextureCompression format);
+
+// Size in bytes of an image once compressed
+size_t compressedSize(TextureCompression format, int width, int height);
+
+// Encode one block from 16 RGBA pixels, row by row. BC1 ignores alpha, BC4
+// encodes red and BC5 red and green.
+void encodeBlock(TextureCompression format, const uint8_t rgba[64], uint8_t *block);
+
+// Decode one block into 16 RGBA pixels. Channels a format doesn't store
+// decode as 0, and alpha as 255.
+void decodeBlock(TextureCompression format, const uint8_t *block, uint8_t rgba[64]);
+
+// Compress an RGBA image, encoding rows of blocks in parallel on the global
+// thread pool. Blocks hanging over the right and bottom edges repeat the
+// last column and row.
+std::vector<uint8_t> compressImage(TextureCompression format, const uint8_t *rgba,
+                                   int width, int height);
+
+// Decompress an image back to RGBA
+std::vector<uint8_t> decompressImage(TextureCompression format, const uint8_t *blocks,
+                                     int width, int height);
@@ -12,10 +12,33 @@ void Camera::calculateMatrices()
 	calculateCameraVectors();
 
 	// Calculate the view matrix
-	view = glm::lookAt(eye, eye + front, worldUp);
+	setView(glm::lookAt(eye, eye + front, worldUp));
 
 	// Calculate the projection matrix
-	projection = glm::perspective(fov, aspect, near, far);
+	calculateProjection();
+}
+
+void Camera::calculateProjection()
+{
+	// Only remake the projection when its parameters change
+	if (fov == projectionFov && aspect == projectionAspect && near == projectionNear && far == projectionFar)
+		return;
+
+	projectionMatrix = glm::perspective(fov, aspect, near, far);
+	projectionFov    = fov;
+	projectionAspect = aspect;
+	projectionNear   = near;
+	projectionFar    = far;
+	revision++;
+}
+
+void Camera::setView(const glm::mat4 &newView)
+{
+	if (newView == viewMatrix)
+		return;
+
+	viewMatrix = newView;
+	revision++;
 }
 
 void Camera::calculateCameraVectors()
@@ -34,13 +57,13 @@ void Camera::quaternionCamera()
 	orientation = Maths::SLERP(orientation, newOrientation, 0.2f);
 
     // Calculate the view matrix
-    view = orientation.matrix() * Maths::translate(-eye);
+    setView(orientation.matrix() * Maths::translate(-eye));
 
     // Calculate the projection matrix
-    projection = glm::perspective(fov, aspect, near, far);
+    calculateProjection();
 
     // Calculate camera vectors from view matrix
-    right = glm::vec3(view[0][0], view[1][0], view[2][0]);
-    up = glm::vec3(view[0][1], view[1][1], view[2][1]);
-    front = -glm::vec3(view[0][2], view[1][2], view[2][2]);
+    right = glm::vec3(viewMatrix[0][0], viewMatrix[1][0], viewMatrix[2][0]);
+    up = glm::vec3(viewMatrix[0][1], viewMatrix[1][1], viewMatrix[2][1]);
+    front = -glm::vec3(viewMatrix[0][2], viewMatrix[1][2], viewMatrix[2][2]);
 }
\ No newline at end of file
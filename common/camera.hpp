@@ -20,9 +20,14 @@ public:
 	glm::vec3 target;
 	glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
-	// Transformation matrices
-	glm::mat4 view;
-	glm::mat4 projection;
+	// Transformation matrices, made by calculateMatrices() or
+	// quaternionCamera()
+	const glm::mat4 &view() const { return viewMatrix; }
+	const glm::mat4 &projection() const { return projectionMatrix; }
+
+	// Incremented whenever view or projection change, so that what is made
+	// from them can tell when it is stale
+	unsigned int revision = 0;
 
 	glm::vec3 right = glm::vec3(1.0f, 0.0f, 0.0f);
 	glm::vec3 up    = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -43,5 +48,21 @@ public:
 	void calculateMatrices();
 	void calculateCameraVectors();
 	void quaternionCamera();
+	void calculateProjection();
+
+private:
+	// Only changed through the methods above, so that revision counts every
+	// change
+	glm::mat4 viewMatrix;
+	glm::mat4 projectionMatrix;
+
+	// Parameters the projection matrix was last made from
+	float projectionFov    = 0.0f;
+	float projectionAspect = 0.0f;
+	float projectionNear   = 0.0f;
+	float projectionFar    = 0.0f;
+
+	// Replace the view matrix, counting a change
+	void setView(const glm::mat4 &newView);
 };
 
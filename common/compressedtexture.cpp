@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "compressedtexture.hpp"
+#include "sourcefile.hpp"
+#include "glextensions.hpp"
+
+// Change whenever the encoder's output or the files written change
+static const char *encoderVersion = "bc 3";
+
+// Key of the source file description in the cached KTX2 files
+static const char *sourceKey = "CGLabs.source";
+
+TextureCompression compressionForType(const std::string &type)
+{
+    if (type == "normal")
+        return TextureCompression::BC5;
+    if (type == "specular")
+        return TextureCompression::BC4;
+    return TextureCompression::BC1;
+}
+
+// Expand an image to 4 channels
+static std::vector<uint8_t> toRGBA(const Image &image)
+{
+    size_t count = static_cast<size_t>(image.width) * image.height;
+    std::vector<uint8_t> rgba(count * 4);
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t *pixel = image.pixels + i * image.channels;
+        uint8_t *out = &rgba[4 * i];
+        if (image.channels <= 2)
+        {
+            // Grey, and grey with alpha
+            out[0] = out[1] = out[2] = pixel[0];
+            out[3] = image.channels == 2 ? pixel[1] : 255;
+        }
+        else
+        {
+            out[0] = pixel[0];
+            out[1] = pixel[1];
+            out[2] = pixel[2];
+            out[3] = image.channels == 4 ? pixel[3] : 255;
+        }
+    }
+    return rgba;
+}
+
+CompressedTexture compressTexture(const Image &image, TextureCompression format, MipFilter filter)
+{
+    if (!image.pixels || format == TextureCompression::None)
+        return CompressedTexture();
+
+    std::vector<uint8_t> rgba = toRGBA(image);
+    if (format == TextureCompression::BC1)
+        for (size_t i = 3; i < rgba.size(); i += 4)
+            if (rgba[i] != 255)
+            {
+                format = TextureCompression::BC3;
+                break;
+            }
+    return compressTexture(rgba.data(), image.width, image.height, format, filter);
+}
+
+CompressedTexture compressTexture(const uint8_t *rgba, int width, int height, TextureCompression format,
+                                  MipFilter filter)
+{
+    CompressedTexture texture;
+    if (format == TextureCompression::None)
+        return texture;
+    texture.format = format;
+    texture.width  = width;
+    texture.height = height;
+
+    // Build the mipmaps as for an uncompressed texture of the same type,
+    // then encode each level
+    MipSettings settings;
+    settings.filter       = filter;
+    settings.gammaCorrect = format == TextureCompression::BC1 || format == TextureCompression::BC3;
+    settings.normalMap    = format == TextureCompression::BC5;
+    MipChain chain = generateMips(rgba, width, height, 4, settings);
+    for (size_t i = 0; i < chain.levels.size(); i++)
+    {
+        texture.levels.push_back(compressImage(format, chain.levels[i].data(),
+                                               chain.levelWidth(i), chain.levelHeight(i)));
+        chain.levels[i].clear();
+    }
+    return texture;
+}
+
+const char *compressorVersion()
+{
+    return encoderVersion;
+}
+
+std::string compressedCachePath(const char *path, TextureCompression format)
+{
+    const char *suffix = ".bc1.ktx2";
+    if (format == TextureCompression::BC3)
+        suffix = ".bc3.ktx2";
+    else if (format == TextureCompression::BC4)
+        suffix = ".bc4.ktx2";
+    else if (format == TextureCompression::BC5)
+        suffix = ".bc5.ktx2";
+    return std::string(path) + suffix;
+}
+
+bool loadCompressedTexture(const char *path, TextureCompression format, CompressedTexture &texture)
+{
+    // Use the cache if it was written by this encoder from the same file
+    std::string cachePath = compressedCachePath(path, format);
+    std::string source;
+    if (readKtx2(cachePath.c_str(), texture, sourceKey, &source) &&
+        sourceUnchanged(path, encoderVersion, source))
+        return true;
+
+    // Compress the image and cache it for next time
+    Image image;
+    if (!image.load(path) || !describeSource(path, encoderVersion, source))
+        return false;
+    texture = compressTexture(image, format);
+    if (!writeKtx2(cachePath.c_str(), texture, sourceKey, source))
+        printf("Couldn't write compressed texture cache %s\n", cachePath.c_str());
+    return true;
+}
+
+bool compressionSupported(TextureCompression format)
+{
+    // RGTC (BC4 and BC5) is core since OpenGL 3.0, S3TC is an extension
+    if (format == TextureCompression::BC1 || format == TextureCompression::BC3)
+    {
+        static const bool s3tc = GLEW_EXT_texture_compression_s3tc ||
+                                 hasExtension("GL_EXT_texture_compression_s3tc");
+        return s3tc;
+    }
+    return format != TextureCompression::None;
+}
+
+GLenum compressedInternalFormat(TextureCompression format)
+{
+    switch (format)
+    {
+        case TextureCompression::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case TextureCompression::BC4: return GL_COMPRESSED_RED_RGTC1;
+        case TextureCompression::BC5: return GL_COMPRESSED_RG_RGTC2;
+        default:                      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+}
+
+GLTexture uploadCompressedTexture(const CompressedTexture &texture, const TextureSampling &sampling)
+{
+    GLTexture result = GLTexture::create();
+    if (texture.levels.empty())
+        return result;
+
+    GLenum format = compressedInternalFormat(texture.format);
+
+    // The mipmaps are uploaded rather than generated
+    glBindTexture(GL_TEXTURE_2D, result.get());
+    for (size_t i = 0; i < texture.levels.size(); i++)
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), format,
+                               texture.levelWidth(i), texture.levelHeight(i), 0,
+                               static_cast<GLsizei>(texture.levels[i].size()), texture.levels[i].data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels.size() - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampling.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampling.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampling.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampling.magFilter);
+
+    // Specular maps are read as a colour, so repeat the one channel in
+    // green and blue
+    if (texture.format == TextureCompression::BC4)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+    return result;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include "image.hpp"
+#include "ktx.hpp"
+#include "mipmap.hpp"
+#include "glhandle.hpp"
+
+// Format a texture type is compressed to: BC1 for diffuse maps, BC4 for
+// specular maps and BC5 for normal maps
+TextureCompression compressionForType(const std::string &type);
+
+// Compress an image and its full mipmap chain. A BC1 image with transparent
+// pixels is stored as BC3 instead. The mipmaps of BC1 and BC3 colour maps are
+// filtered gamma correct, and those of BC5 normal maps renormalised.
+CompressedTexture compressTexture(const Image &image, TextureCompression format,
+                                  MipFilter filter = MipFilter::Kaiser);
+
+// Compress an RGBA image and its full mipmap chain to a format as it is
+CompressedTexture compressTexture(const uint8_t *rgba, int width, int height, TextureCompression format,
+                                  MipFilter filter = MipFilter::Kaiser);
+
+// Version of the encoder, stored with the compressed textures cached so that
+// they are rebuilt when the encoder's output changes
+const char *compressorVersion();
+
+// Path of the compressed texture cached next to an image file
+std::string compressedCachePath(const char *path, TextureCompression format);
+
+// Read the compressed texture cached next to an image file, or compress the
+// image and write the cache if there is none or the image has changed since.
+// Touches no GL state, so it can run on a worker thread.
+bool loadCompressedTexture(const char *path, TextureCompression format, CompressedTexture &texture);
+
+// Whether the GL context can sample a format
+bool compressionSupported(TextureCompression format);
+
+// GL internal format of a compressed format
+GLenum compressedInternalFormat(TextureCompression format);
+
+// Create a GL texture from the levels of a compressed texture. Must be
+// called on the thread owning the GL context.
+GLTexture uploadCompressedTexture(const CompressedTexture &texture,
+                                  const TextureSampling &sampling = TextureSampling());
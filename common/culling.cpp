@@ -0,0 +1,157 @@
+#include <math.h>
+#include <chrono>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULLING_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_SSE2 1
+#endif
+
+#include "culling.hpp"
+
+Bounds computeBounds(const glm::vec3 *positions, size_t count)
+{
+    Bounds bounds;
+    if (count == 0)
+        return bounds;
+
+    bounds.min = bounds.max = positions[0];
+    for (size_t i = 1; i < count; i++)
+    {
+        bounds.min = glm::min(bounds.min, positions[i]);
+        bounds.max = glm::max(bounds.max, positions[i]);
+    }
+    bounds.centre = 0.5f * (bounds.min + bounds.max);
+
+    float radius2 = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 offset = positions[i] - bounds.centre;
+        radius2 = glm::max(radius2, glm::dot(offset, offset));
+    }
+    bounds.radius = sqrtf(radius2);
+    return bounds;
+}
+
+glm::vec4 transformSphere(const Bounds &bounds, const glm::mat4 &model)
+{
+    // The radius grows with the largest scale of the matrix
+    float scale = glm::max(glm::length(glm::vec3(model[0])),
+                  glm::max(glm::length(glm::vec3(model[1])),
+                           glm::length(glm::vec3(model[2]))));
+    glm::vec3 centre = glm::vec3(model * glm::vec4(bounds.centre, 1.0f));
+    return glm::vec4(centre, bounds.radius * scale);
+}
+
+Frustum::Frustum(const glm::mat4 &m)
+{
+    // Gribb and Hartmann: the planes are sums and differences of the rows
+    // of the matrix
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+
+    for (int i = 0; i < 6; i++)
+    {
+        float length = glm::length(glm::vec3(planes[i]));
+        if (length > 0.0f)
+            planes[i] /= length;
+    }
+}
+
+bool Frustum::containsSphere(const glm::vec3 &centre, float radius) const
+{
+    for (int i = 0; i < 6; i++)
+        if (glm::dot(glm::vec3(planes[i]), centre) + planes[i].w < -radius)
+            return false;
+    return true;
+}
+
+void CullingBatch::clear()
+{
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+}
+
+size_t CullingBatch::add(const glm::vec4 &sphere)
+{
+    x.push_back(sphere.x);
+    y.push_back(sphere.y);
+    z.push_back(sphere.z);
+    radius.push_back(sphere.w);
+    return x.size() - 1;
+}
+
+void CullingBatch::cull(const Frustum &frustum)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    size_t count = x.size();
+    visible.resize(count);
+    size_t i = 0;
+
+#if defined(CULLING_AVX)
+    // Eight spheres at a time, a sphere is outside if it's behind any plane
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(&x[i]);
+        __m256 cy = _mm256_loadu_ps(&y[i]);
+        __m256 cz = _mm256_loadu_ps(&z[i]);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&radius[i]));
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < 6; p++)
+        {
+            const glm::vec4 &plane = frustum.planes[p];
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_mul_ps(cy, _mm256_set1_ps(plane.y))),
+                _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negativeRadius, _CMP_LT_OQ));
+        }
+        int mask = _mm256_movemask_ps(outside);
+        for (int k = 0; k < 8; k++)
+            visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+    }
+#elif defined(CULLING_SSE2)
+    // Four spheres at a time, a sphere is outside if it's behind any plane
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&x[i]);
+        __m128 cy = _mm_loadu_ps(&y[i]);
+        __m128 cz = _mm_loadu_ps(&z[i]);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[i]));
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; p++)
+        {
+            const glm::vec4 &plane = frustum.planes[p];
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+        }
+        int mask = _mm_movemask_ps(outside);
+        for (int k = 0; k < 4; k++)
+            visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+    }
+#endif
+
+    // The rest one at a time
+    for (; i < count; i++)
+        visible[i] = frustum.containsSphere(glm::vec3(x[i], y[i], z[i]), radius[i]) ? 1 : 0;
+
+    stats.tested = count;
+    stats.culled = 0;
+    for (i = 0; i < count; i++)
+        stats.culled += visible[i] ? 0 : 1;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// Axis aligned bounding box and bounding sphere of a set of points
+struct Bounds
+{
+    glm::vec3 min    = glm::vec3(0.0f);
+    glm::vec3 max    = glm::vec3(0.0f);
+    glm::vec3 centre = glm::vec3(0.0f);
+    float     radius = 0.0f;
+};
+
+// Bounds of an array of positions. The sphere is centred on the box and
+// reaches the furthest point.
+Bounds computeBounds(const glm::vec3 *positions, size_t count);
+
+// World space bounding sphere of bounds transformed by a model matrix, as
+// (centre, radius)
+glm::vec4 transformSphere(const Bounds &bounds, const glm::mat4 &model);
+
+// The six planes of a view frustum, normalised, with the normals facing in
+class Frustum
+{
+public:
+    glm::vec4 planes[6];    // left, right, bottom, top, near, far
+
+    // Extract the planes of projection * view
+    Frustum(const glm::mat4 &viewProjection);
+
+    // Whether any part of a sphere is inside
+    bool containsSphere(const glm::vec3 &centre, float radius) const;
+};
+
+// Counters of a culling pass
+struct CullingStats
+{
+    size_t tested = 0;
+    size_t culled = 0;
+    double milliseconds = 0.0;
+
+    void add(const CullingStats &other)
+    {
+        tested += other.tested;
+        culled += other.culled;
+        milliseconds += other.milliseconds;
+    }
+};
+
+// Bounding spheres of the objects in a scene, stored as separate arrays so
+// that they can be tested against a frustum four (SSE2) or eight (AVX) at a
+// time before any draw call
+class CullingBatch
+{
+public:
+    // Results of the last cull, one per sphere in the order they were added
+    std::vector<unsigned char> visible;
+
+    // Counters of the last cull
+    CullingStats stats;
+
+    // Remove every sphere
+    void clear();
+
+    // Add a sphere, returns its index
+    size_t add(const glm::vec4 &sphere);
+
+    // Number of spheres
+    size_t size() const { return x.size(); }
+
+    // Test every sphere, filling visible and stats
+    void cull(const Frustum &frustum);
+
+private:
+    std::vector<float> x, y, z, radius;
+};
@@ -0,0 +1,19 @@
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "glextensions.hpp"
+
+bool hasExtension(const char *name)
+{
+    // Look through the names one at a time, as core profiles require
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
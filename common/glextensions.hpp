@@ -0,0 +1,9 @@
+#pragma once
+
+// Whether the current context lists an extension, e.g.
+// "GL_ARB_texture_storage". GLEW's flags can't answer this: GLEW 1.13 reads
+// the list with glGetString(GL_EXTENSIONS), which fails in core profiles,
+// and with glewExperimental it sets a flag whenever the extension's
+// functions resolve, which on GLX they always do. Must be called on the
+// thread owning the GL context.
+bool hasExtension(const char *name);
@@ -0,0 +1,73 @@
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "glhandle.hpp"
+
+// Object deleted by the context thread
+struct PendingDelete
+{
+    void (*destroy)(unsigned int);
+    unsigned int id;
+};
+
+static std::atomic<std::thread::id> contextThread((std::thread::id()));
+static std::atomic<bool> released(false);
+
+static std::mutex pendingMutex;
+static std::vector<PendingDelete> pending;
+static std::atomic<bool> hasPending(false);
+
+bool onGLContextThread()
+{
+    return !released && contextThread.load() == std::this_thread::get_id();
+}
+
+void claimGLContext()
+{
+    std::thread::id none;
+    contextThread.compare_exchange_strong(none, std::this_thread::get_id());
+    deletePendingGLObjects();
+}
+
+void destroyGLObject(void (*destroy)(unsigned int), unsigned int id)
+{
+    if (onGLContextThread())
+    {
+        destroy(id);
+        deletePendingGLObjects();
+        return;
+    }
+
+    // The context has taken its objects with it
+    if (released)
+        return;
+
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    PendingDelete object = { destroy, id };
+    pending.push_back(object);
+    hasPending = true;
+}
+
+void deletePendingGLObjects()
+{
+    if (!hasPending || !onGLContextThread())
+        return;
+    std::vector<PendingDelete> objects;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        objects.swap(pending);
+        hasPending = false;
+    }
+    for (size_t i = 0; i < objects.size(); i++)
+        objects[i].destroy(objects[i].id);
+}
+
+void releaseGLContext()
+{
+    released = true;
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pending.clear();
+    hasPending = false;
+}
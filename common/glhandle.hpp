@@ -0,0 +1,109 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// GL objects can only be deleted on the thread owning the GL context, which
+// is taken to be the thread that created the first object. An object
+// released on another thread, e.g. by a worker dropping the last reference
+// to a texture, is queued and deleted by the context thread the next time
+// it creates or deletes an object or calls deletePendingGLObjects().
+void deletePendingGLObjects();
+
+// Call just before the GL context is destroyed, e.g. before glfwTerminate().
+// Objects released after it aren't deleted, as the context has taken them
+// with it.
+void releaseGLContext();
+
+// Whether the calling thread owns the GL context and it hasn't been released
+bool onGLContextThread();
+
+// Note the calling thread as the GL context's if it is the first to create
+// an object, and delete any queued objects
+void claimGLContext();
+
+// Delete a GL object now on the context thread, otherwise queue it
+void destroyGLObject(void (*destroy)(unsigned int), unsigned int id);
+
+// Move-only owner of a GL object name. The object is deleted when the handle
+// is reset or destroyed, on the thread owning the GL context.
+template <typename Traits>
+class GLHandle
+{
+public:
+    GLHandle() {}
+    explicit GLHandle(unsigned int id) : id(id) { claimGLContext(); }
+    ~GLHandle() { reset(); }
+
+    GLHandle(GLHandle &&other) : id(other.id) { other.id = 0; }
+    GLHandle &operator=(GLHandle &&other)
+    {
+        if (this != &other)
+        {
+            reset();
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+    GLHandle(const GLHandle &) = delete;
+    GLHandle &operator=(const GLHandle &) = delete;
+
+    // Create a new GL object
+    static GLHandle create() { return GLHandle(Traits::create()); }
+
+    // GL name of the object, 0 if there is none
+    unsigned int get() const { return id; }
+    explicit operator bool() const { return id != 0; }
+
+    // Delete the object and optionally take ownership of another
+    void reset(unsigned int newId = 0)
+    {
+        if (id != 0)
+            destroyGLObject(Traits::destroy, id);
+        if (newId != 0)
+            claimGLContext();
+        id = newId;
+    }
+
+    // Give up ownership without deleting the object
+    unsigned int release()
+    {
+        unsigned int old = id;
+        id = 0;
+        return old;
+    }
+
+private:
+    unsigned int id = 0;
+};
+
+struct GLBufferTraits
+{
+    static unsigned int create() { unsigned int id; glGenBuffers(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteBuffers(1, &id); }
+};
+
+struct GLVertexArrayTraits
+{
+    static unsigned int create() { unsigned int id; glGenVertexArrays(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteVertexArrays(1, &id); }
+};
+
+struct GLTextureTraits
+{
+    static unsigned int create() { unsigned int id; glGenTextures(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteTextures(1, &id); }
+};
+
+// Deleting a program also forgets its ShaderProgram reflection, as GL may
+// reuse the id. Defined in shaderprogram.cpp.
+struct GLProgramTraits
+{
+    static unsigned int create() { return glCreateProgram(); }
+    static void destroy(unsigned int id);
+};
+
+typedef GLHandle<GLBufferTraits>      GLBuffer;
+typedef GLHandle<GLVertexArrayTraits> GLVertexArray;
+typedef GLHandle<GLTextureTraits>     GLTexture;
+typedef GLHandle<GLProgramTraits>     GLProgram;
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Fast 64-bit hash of a block of memory
+inline uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0)
+{
+    // Multiply-rotate hash over 8 byte words, finished with a 64-bit mixer
+    const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+
+    uint64_t hash = seed ^ (size * prime1);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash ^= word * prime2;
+        hash  = ((hash << 31) | (hash >> 33)) * prime1;
+    }
+    for (; i < size; i++)
+    {
+        hash ^= bytes[i] * prime1;
+        hash  = ((hash << 11) | (hash >> 53)) * prime2;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    return hash;
+}
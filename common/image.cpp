@@ -0,0 +1,156 @@
+#include <stdio.h>
+
+#include <GL/glew.h>
+
+#include "image.hpp"
+#include "ktx.hpp"
+#include "sourcefile.hpp"
+#include "stb_image.hpp"
+
+// Change whenever the mipmaps built change
+static const char *mipmapVersion = "mips 2";
+
+// Key of the source file description in the cached KTX2 files
+static const char *sourceKey = "CGLabs.source";
+
+Image::~Image()
+{
+    release();
+}
+
+Image::Image(Image &&other)
+{
+    *this = static_cast<Image &&>(other);
+}
+
+Image &Image::operator=(Image &&other)
+{
+    if (this != &other)
+    {
+        release();
+        width    = other.width;
+        height   = other.height;
+        channels = other.channels;
+        pixels   = other.pixels;
+        other.pixels = NULL;
+    }
+    return *this;
+}
+
+bool Image::load(const char *path)
+{
+    release();
+    pixels = stbi_load(path, &width, &height, &channels, 0);
+    return pixels != NULL;
+}
+
+void Image::release()
+{
+    if (pixels)
+        stbi_image_free(pixels);
+    pixels = NULL;
+}
+
+bool usesMipmaps(const TextureSampling &sampling)
+{
+    return sampling.minFilter != GL_NEAREST && sampling.minFilter != GL_LINEAR;
+}
+
+size_t textureBytes(const Image &image)
+{
+    // Drivers pad 3 channel textures to 4, and the mipmaps add a third
+    int channels = image.channels == 3 ? 4 : image.channels;
+    size_t bytes = static_cast<size_t>(image.width) * image.height * channels;
+    return bytes + bytes / 3;
+}
+
+size_t textureBytes(const MipChain &chain)
+{
+    size_t bytes = chain.bytes();
+    return chain.channels == 3 ? bytes / 3 * 4 : bytes;
+}
+
+std::string mipCachePath(const char *path, const MipSettings &settings)
+{
+    // Each set of settings gets its own file, so that textures loaded with
+    // different settings don't keep rewriting each other's cache
+    std::string name = mipSettingsName(settings);
+    for (size_t i = 0; i < name.size(); i++)
+        if (name[i] == ' ')
+            name[i] = '-';
+    return std::string(path) + "." + name + ".mips.ktx2";
+}
+
+bool loadMipChain(const char *path, const MipSettings &settings, MipChain &chain)
+{
+    // Use the cache if it was built with the same settings from the same file
+    std::string version = std::string(mipmapVersion) + " " + mipSettingsName(settings);
+    std::string cachePath = mipCachePath(path, settings);
+    std::string source;
+    if (readKtx2(cachePath.c_str(), chain, sourceKey, &source) &&
+        sourceUnchanged(path, version, source))
+    {
+        chain.settings = settings;
+        return true;
+    }
+
+    // Build the mipmaps and cache them for next time
+    Image image;
+    if (!image.load(path) || !describeSource(path, version, source))
+        return false;
+    chain = generateMips(image.pixels, image.width, image.height, image.channels, settings);
+    if (!writeKtx2(cachePath.c_str(), chain, sourceKey, source))
+        printf("Couldn't write mipmap cache %s\n", cachePath.c_str());
+    return true;
+}
+
+GLTexture uploadTexture(const Image &image, const TextureSampling &sampling)
+{
+    MipChain chain;
+    if (image.pixels && usesMipmaps(sampling))
+    {
+        MipSettings settings;
+        settings.repeat = sampling.wrap == GL_REPEAT || sampling.wrap == GL_MIRRORED_REPEAT;
+        chain = generateMips(image.pixels, image.width, image.height, image.channels, settings);
+    }
+    else if (image.pixels)
+    {
+        chain.width    = image.width;
+        chain.height   = image.height;
+        chain.channels = image.channels;
+        chain.levels.push_back(std::vector<uint8_t>(image.pixels, image.pixels +
+            static_cast<size_t>(image.width) * image.height * image.channels));
+    }
+    return uploadTexture(chain, sampling);
+}
+
+GLTexture uploadTexture(const MipChain &chain, const TextureSampling &sampling)
+{
+    GLTexture texture = GLTexture::create();
+    if (chain.levels.empty())
+        return texture;
+
+    GLenum format = GL_RGB;
+    if (chain.channels == 1)
+        format = GL_RED;
+    else if (chain.channels == 2)
+        format = GL_RG;
+    else if (chain.channels == 4)
+        format = GL_RGBA;
+
+    // Rows of 1 and 3 channel images aren't always 4 byte aligned
+    size_t levels = usesMipmaps(sampling) ? chain.levels.size() : 1;
+    glBindTexture(GL_TEXTURE_2D, texture.get());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i < levels; i++)
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), format, chain.levelWidth(i), chain.levelHeight(i), 0,
+                     format, GL_UNSIGNED_BYTE, chain.levels[i].data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampling.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampling.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampling.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampling.magFilter);
+
+    return texture;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+#include "glhandle.hpp"
+#include "mipmap.hpp"
+
+// Decoded 8-bit image held in memory. Decoding touches no GL state, so it
+// can run on any thread.
+class Image
+{
+public:
+    int width    = 0;
+    int height   = 0;
+    int channels = 0;
+    unsigned char *pixels = NULL;
+
+    Image() {}
+    ~Image();
+
+    Image(Image &&other);
+    Image &operator=(Image &&other);
+    Image(const Image &) = delete;
+    Image &operator=(const Image &) = delete;
+
+    // Decode an image file, returns false if it couldn't be read
+    bool load(const char *path);
+
+    // Free the pixels
+    void release();
+};
+
+// How a texture is sampled
+struct TextureSampling
+{
+    GLenum wrap      = GL_REPEAT;
+    GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;    // mipmaps are built for the mipmap filters
+    GLenum magFilter = GL_LINEAR;
+
+    bool operator==(const TextureSampling &other) const
+    {
+        return wrap == other.wrap && minFilter == other.minFilter && magFilter == other.magFilter;
+    }
+};
+
+// Whether sampling reads the mipmaps
+bool usesMipmaps(const TextureSampling &sampling);
+
+// Video memory used by an image uploaded with a full mipmap chain
+size_t textureBytes(const Image &image);
+size_t textureBytes(const MipChain &chain);
+
+// Path of the mipmap chain built with settings cached next to an image file,
+// e.g. "bricks_diffuse.png.box-srgb-repeat.mips.ktx2"
+std::string mipCachePath(const char *path, const MipSettings &settings);
+
+// Read the mipmap chain cached next to an image file, or decode the image,
+// build its mipmaps and write the cache if there is none, it was built with
+// other settings or the image has changed since. Touches no GL state, so it
+// can run on a worker thread.
+bool loadMipChain(const char *path, const MipSettings &settings, MipChain &chain);
+
+// Create a GL texture from an image, by default repeating and mipmapped.
+// The mipmaps are built on the CPU with the default settings. Must be called
+// on the thread owning the GL context.
+GLTexture uploadTexture(const Image &image, const TextureSampling &sampling = TextureSampling());
+
+// Create a GL texture from a mipmap chain, uploading every level rather
+// than generating them, or only level 0 if sampling doesn't use mipmaps.
+// Must be called on the thread owning the GL context.
+GLTexture uploadTexture(const MipChain &chain, const TextureSampling &sampling = TextureSampling());
@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "ktx.hpp"
+#include "objloader.hpp"
+#include "atomicfile.hpp"
+
+static const uint8_t ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// Header following the identifier. The spec puts the 64-bit fields at 52,
+// with no padding before them, so the struct is packed to 4 bytes.
+#pragma pack(push, 4)
+struct Ktx2Header
+{
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+#pragma pack(pop)
+static_assert(sizeof(Ktx2Header) == 68, "Ktx2Header must match the KTX2 header layout");
+
+struct Ktx2Level
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Vulkan format numbers of the UNORM BC formats
+static uint32_t vkFormat(TextureCompression format)
+{
+    switch (format)
+    {
+        case TextureCompression::BC1: return 131;   // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+        case TextureCompression::BC3: return 137;   // VK_FORMAT_BC3_UNORM_BLOCK
+        case TextureCompression::BC4: return 139;   // VK_FORMAT_BC4_UNORM_BLOCK
+        case TextureCompression::BC5: return 141;   // VK_FORMAT_BC5_UNORM_BLOCK
+        default:                      return 0;
+    }
+}
+
+// Vulkan format numbers of 8-bit UNORM images by channel count
+static uint32_t vkFormat(int channels)
+{
+    switch (channels)
+    {
+        case 1:  return 9;      // VK_FORMAT_R8_UNORM
+        case 2:  return 16;     // VK_FORMAT_R8G8_UNORM
+        case 3:  return 23;     // VK_FORMAT_R8G8B8_UNORM
+        case 4:  return 37;     // VK_FORMAT_R8G8B8A8_UNORM
+        default: return 0;
+    }
+}
+
+static int channelsFromVkFormat(uint32_t format)
+{
+    switch (format)
+    {
+        case 9:  return 1;
+        case 16: return 2;
+        case 23: return 3;
+        case 37: return 4;
+        default: return 0;
+    }
+}
+
+static TextureCompression fromVkFormat(uint32_t format)
+{
+    switch (format)
+    {
+        case 131: return TextureCompression::BC1;
+        case 137: return TextureCompression::BC3;
+        case 139: return TextureCompression::BC4;
+        case 141: return TextureCompression::BC5;
+        default:  return TextureCompression::None;
+    }
+}
+
+int CompressedTexture::levelWidth(size_t level) const
+{
+    int size = width >> level;
+    return size > 0 ? size : 1;
+}
+
+int CompressedTexture::levelHeight(size_t level) const
+{
+    int size = height >> level;
+    return size > 0 ? size : 1;
+}
+
+size_t CompressedTexture::bytes() const
+{
+    size_t total = 0;
+    for (size_t i = 0; i < levels.size(); i++)
+        total += levels[i].size();
+    return total;
+}
+
+// Basic data format descriptor of a BC format: one sample per 64-bit half
+// of the block
+static std::vector<uint32_t> dataFormatDescriptor(TextureCompression format)
+{
+    uint32_t colourModel, samples, channels[2];
+    switch (format)
+    {
+        case TextureCompression::BC1: colourModel = 128; samples = 1; channels[0] = 0;  break;
+        case TextureCompression::BC3: colourModel = 130; samples = 2; channels[0] = 15; channels[1] = 0; break;
+        case TextureCompression::BC4: colourModel = 131; samples = 1; channels[0] = 0;  break;
+        default:                      colourModel = 132; samples = 2; channels[0] = 0;  channels[1] = 1; break;
+    }
+
+    uint32_t blockSize = 24 + 16 * samples;
+    std::vector<uint32_t> words;
+    words.push_back(4 + blockSize);                         // total size
+    words.push_back(0);                                     // vendor and descriptor type
+    words.push_back(2 | (blockSize << 16));                 // version 2 and block size
+    words.push_back(colourModel | (1 << 8) | (1 << 16));    // BT.709 primaries, linear
+    words.push_back(3 | (3 << 8));                          // 4x4 texel blocks
+    words.push_back(static_cast<uint32_t>(blockBytes(format)));
+    words.push_back(0);
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        words.push_back((64 * i) | (63 << 16) | (channels[i] << 24));
+        words.push_back(0);
+        words.push_back(0);
+        words.push_back(0xFFFFFFFFu);
+    }
+    return words;
+}
+
+// Basic data format descriptor of an 8-bit UNORM image: one sample per
+// channel, the last of four being alpha
+static std::vector<uint32_t> dataFormatDescriptor(int channels)
+{
+    uint32_t blockSize = 24 + 16 * channels;
+    std::vector<uint32_t> words;
+    words.push_back(4 + blockSize);                         // total size
+    words.push_back(0);                                     // vendor and descriptor type
+    words.push_back(2 | (blockSize << 16));                 // version 2 and block size
+    words.push_back(1 | (1 << 8) | (1 << 16));              // RGBSDA, BT.709 primaries, linear
+    words.push_back(0);                                     // 1x1 texel blocks
+    words.push_back(static_cast<uint32_t>(channels));
+    words.push_back(0);
+    for (int i = 0; i < channels; i++)
+    {
+        uint32_t channel = channels == 4 && i == 3 ? 15 : static_cast<uint32_t>(i);
+        words.push_back((8 * i) | (7 << 16) | (channel << 24));
+        words.push_back(0);
+        words.push_back(0);
+        words.push_back(255);
+    }
+    return words;
+}
+
+// Write a KTX2 file of one image and its mipmap levels, level 0 first, each
+// level aligned to alignment bytes
+static bool writeKtx2(const char *path, uint32_t format, int width, int height,
+                      const std::vector<uint32_t> &dfd, size_t alignment,
+                      const std::vector<std::vector<uint8_t>> &levels,
+                      const char *key, const std::string &value)
+{
+    // Key/value data, each entry padded to 4 bytes
+    std::vector<uint8_t> kvd;
+    if (key)
+    {
+        uint32_t length = static_cast<uint32_t>(strlen(key) + 1 + value.size());
+        kvd.resize(4);
+        memcpy(kvd.data(), &length, 4);
+        kvd.insert(kvd.end(), key, key + strlen(key) + 1);
+        kvd.insert(kvd.end(), value.begin(), value.end());
+        kvd.resize((kvd.size() + 3) & ~static_cast<size_t>(3), 0);
+    }
+
+    // Layout: header, level index, descriptor, key/values, then the levels
+    // from the smallest to level 0
+    size_t levelCount = levels.size();
+    Ktx2Header header;
+    memset(&header, 0, sizeof(header));
+    header.vkFormat      = format;
+    header.typeSize      = 1;
+    header.pixelWidth    = static_cast<uint32_t>(width);
+    header.pixelHeight   = static_cast<uint32_t>(height);
+    header.faceCount     = 1;
+    header.levelCount    = static_cast<uint32_t>(levelCount);
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(ktx2Identifier) + sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level));
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size() * 4);
+    header.kvdByteOffset = kvd.empty() ? 0 : header.dfdByteOffset + header.dfdByteLength;
+    header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+    std::vector<Ktx2Level> index(levelCount);
+    size_t offset = header.dfdByteOffset + header.dfdByteLength + kvd.size();
+    for (size_t i = levelCount; i-- > 0;)
+    {
+        offset = (offset + alignment - 1) / alignment * alignment;
+        index[i].byteOffset = offset;
+        index[i].byteLength = levels[i].size();
+        index[i].uncompressedByteLength = levels[i].size();
+        offset += levels[i].size();
+    }
+
+    return writeFileAtomically(path, [&](FILE *file)
+    {
+        bool ok = fwrite(ktx2Identifier, sizeof(ktx2Identifier), 1, file) == 1 &&
+                  fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(index.data(), sizeof(Ktx2Level), levelCount, file) == levelCount &&
+                  fwrite(dfd.data(), 4, dfd.size(), file) == dfd.size() &&
+                  fwrite(kvd.data(), 1, kvd.size(), file) == kvd.size();
+        size_t written = header.dfdByteOffset + header.dfdByteLength + kvd.size();
+        for (size_t i = levelCount; ok && i-- > 0;)
+        {
+            static const uint8_t zeros[16] = { 0 };
+            size_t padding = static_cast<size_t>(index[i].byteOffset) - written;
+            ok = fwrite(zeros, 1, padding, file) == padding &&
+                 fwrite(levels[i].data(), 1, levels[i].size(), file) == levels[i].size();
+            written += padding + levels[i].size();
+        }
+        return ok;
+    });
+}
+
+// Read the header of a KTX2 file of a single 2D image, not supercompressed
+static bool readKtx2Header(const MappedFile &file, Ktx2Header &header)
+{
+    size_t headerEnd = sizeof(ktx2Identifier) + sizeof(Ktx2Header);
+    if (file.size < headerEnd || memcmp(file.data, ktx2Identifier, sizeof(ktx2Identifier)) != 0)
+        return false;
+    memcpy(&header, file.data + sizeof(ktx2Identifier), sizeof(header));
+    return header.pixelDepth == 0 && header.layerCount <= 1 && header.faceCount == 1 &&
+           header.levelCount != 0 && header.levelCount <= 32 && header.supercompressionScheme == 0 &&
+           file.size >= headerEnd + header.levelCount * sizeof(Ktx2Level);
+}
+
+// Read the levels of a KTX2 file, checking each has the size levelBytes
+// gives for its width and height
+template <typename LevelBytes>
+static bool readKtx2Levels(const MappedFile &file, const Ktx2Header &header,
+                           std::vector<std::vector<uint8_t>> &levels, LevelBytes levelBytes)
+{
+    size_t headerEnd = sizeof(ktx2Identifier) + sizeof(Ktx2Header);
+    levels.assign(header.levelCount, std::vector<uint8_t>());
+    for (uint32_t i = 0; i < header.levelCount; i++)
+    {
+        Ktx2Level level;
+        memcpy(&level, file.data + headerEnd + i * sizeof(Ktx2Level), sizeof(level));
+        int width  = header.pixelWidth  >> i > 0 ? static_cast<int>(header.pixelWidth  >> i) : 1;
+        int height = header.pixelHeight >> i > 0 ? static_cast<int>(header.pixelHeight >> i) : 1;
+        if (level.byteOffset > file.size || level.byteLength > file.size - level.byteOffset ||
+            level.byteLength != levelBytes(width, height))
+            return false;
+        const uint8_t *data = reinterpret_cast<const uint8_t *>(file.data + level.byteOffset);
+        levels[i].assign(data, data + level.byteLength);
+    }
+    return true;
+}
+
+// Look for a key among the key/value pairs
+static bool readKtx2Value(const MappedFile &file, const Ktx2Header &header, const char *key,
+                          std::string &value)
+{
+    value.clear();
+    size_t position = header.kvdByteOffset;
+    size_t end = position + header.kvdByteLength;
+    if (end > file.size)
+        return false;
+    while (position + 4 <= end)
+    {
+        uint32_t length;
+        memcpy(&length, file.data + position, 4);
+        const char *entry = file.data + position + 4;
+        if (length > end - position - 4)
+            break;
+        size_t keyLength = strnlen(entry, length);
+        if (keyLength < length && strcmp(entry, key) == 0)
+        {
+            value.assign(entry + keyLength + 1, length - keyLength - 1);
+            break;
+        }
+        position += (4 + length + 3) & ~static_cast<size_t>(3);
+    }
+    return true;
+}
+
+bool writeKtx2(const char *path, const CompressedTexture &texture, const char *key, const std::string &value)
+{
+    uint32_t format = vkFormat(texture.format);
+    if (format == 0 || texture.levels.empty())
+        return false;
+
+    // Levels are aligned to the block size
+    return writeKtx2(path, format, texture.width, texture.height, dataFormatDescriptor(texture.format),
+                     blockBytes(texture.format), texture.levels, key, value);
+}
+
+bool writeKtx2(const char *path, const MipChain &chain, const char *key, const std::string &value)
+{
+    uint32_t format = vkFormat(chain.channels);
+    if (format == 0 || chain.levels.empty())
+        return false;
+
+    // Levels are aligned to the least common multiple of the texel size and 4
+    size_t alignment = chain.channels == 3 ? 12 : 4;
+    return writeKtx2(path, format, chain.width, chain.height, dataFormatDescriptor(chain.channels),
+                     alignment, chain.levels, key, value);
+}
+
+bool readKtx2(const char *path, CompressedTexture &texture, const char *key, std::string *value)
+{
+    MappedFile file;
+    Ktx2Header header;
+    if (!file.open(path) || !readKtx2Header(file, header))
+        return false;
+
+    // Only the BC formats written above
+    TextureCompression format = fromVkFormat(header.vkFormat);
+    if (format == TextureCompression::None)
+        return false;
+
+    texture.format = format;
+    texture.width  = static_cast<int>(header.pixelWidth);
+    texture.height = static_cast<int>(header.pixelHeight);
+    if (!readKtx2Levels(file, header, texture.levels, [format](int width, int height)
+        {
+            return compressedSize(format, width, height);
+        }))
+        return false;
+    return !key || !value || readKtx2Value(file, header, key, *value);
+}
+
+bool readKtx2(const char *path, MipChain &chain, const char *key, std::string *value)
+{
+    MappedFile file;
+    Ktx2Header header;
+    if (!file.open(path) || !readKtx2Header(file, header))
+        return false;
+
+    // Only the 8-bit UNORM formats written above
+    int channels = channelsFromVkFormat(header.vkFormat);
+    if (channels == 0)
+        return false;
+
+    chain.width    = static_cast<int>(header.pixelWidth);
+    chain.height   = static_cast<int>(header.pixelHeight);
+    chain.channels = channels;
+    if (!readKtx2Levels(file, header, chain.levels, [channels](int width, int height)
+        {
+            return static_cast<size_t>(width) * height * channels;
+        }))
+        return false;
+    return !key || !value || readKtx2Value(file, header, key, *value);
+}
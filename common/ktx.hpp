@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "blockcompress.hpp"
+#include "mipmap.hpp"
+
+// Block compressed texture with its mipmap chain, level 0 first
+struct CompressedTexture
+{
+    TextureCompression format = TextureCompression::None;
+    int width  = 0;
+    int height = 0;
+    std::vector<std::vector<uint8_t>> levels;
+
+    // Width and height of a mipmap level
+    int levelWidth(size_t level) const;
+    int levelHeight(size_t level) const;
+
+    // Total size of the levels in bytes
+    size_t bytes() const;
+};
+
+// Read a KTX2 file holding one of the BC formats, uncompressed by any
+// supercompression scheme. value is set to the value stored under key, if
+// both are given.
+bool readKtx2(const char *path, CompressedTexture &texture,
+              const char *key = NULL, std::string *value = NULL);
+
+// Read a KTX2 file holding an 8-bit UNORM image with 1 to 4 channels. The
+// mipmap settings aren't stored in the file.
+bool readKtx2(const char *path, MipChain &chain,
+              const char *key = NULL, std::string *value = NULL);
+
+// Write a KTX2 file, with an optional key/value pair
+bool writeKtx2(const char *path, const CompressedTexture &texture,
+               const char *key = NULL, const std::string &value = std::string());
+bool writeKtx2(const char *path, const MipChain &chain,
+               const char *key = NULL, const std::string &value = std::string());
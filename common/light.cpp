@@ -1,4 +1,11 @@
 #include <common/light.hpp>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGHT_SSE2 1
+#endif
 
 void Light::addPointLight(const glm::vec3 position,  const glm::vec3 colour,
                           const float constant,      const float linear,
@@ -40,30 +47,114 @@ void Light::addDirectionalLight(const glm::vec3 direction, const glm::vec3 colou
     lightSources.push_back(light);
 }
 
+static_assert(sizeof(LightBlock) == 64, "LightBlock must match the std140 layout of Light");
+
+// Transform the positions and directions of every light to view space, a
+// light at a time as a sum of the columns of the view matrix
+static void transformLights(const glm::mat4 &view, const LightSource *lights, size_t count,
+                            LightBlock *blocks)
+{
+    size_t i = 0;
+
+#if defined(LIGHT_SSE2)
+    __m128 column0 = _mm_loadu_ps(&view[0][0]);
+    __m128 column1 = _mm_loadu_ps(&view[1][0]);
+    __m128 column2 = _mm_loadu_ps(&view[2][0]);
+    __m128 column3 = _mm_loadu_ps(&view[3][0]);
+    for (; i < count; i++)
+    {
+        const glm::vec3 &p = lights[i].position;
+        const glm::vec3 &d = lights[i].direction;
+        __m128 position = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(p.x)), _mm_mul_ps(column1, _mm_set1_ps(p.y))),
+            _mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(p.z)), column3));
+        __m128 direction = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(d.x)), _mm_mul_ps(column1, _mm_set1_ps(d.y))),
+            _mm_mul_ps(column2, _mm_set1_ps(d.z)));
+        
+        // The direction's w would land on constant, so it goes through a copy
+        float directionW[4];
+        _mm_storeu_ps(blocks[i].position, position);
+        _mm_storeu_ps(directionW, direction);
+        memcpy(blocks[i].direction, directionW, sizeof(blocks[i].direction));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        glm::vec4 position  = view * glm::vec4(lights[i].position, 1.0f);
+        glm::vec4 direction = view * glm::vec4(lights[i].direction, 0.0f);
+        memcpy(blocks[i].position, &position[0], sizeof(blocks[i].position));
+        memcpy(blocks[i].direction, &direction[0], sizeof(blocks[i].direction));
+    }
+}
+
 void Light::toShader(unsigned int shaderID, glm::mat4 view)
 {
+    // Every lit program reads the lights from the same binding point
+    static bool blockBound = false;
+    if (!blockBound)
+    {
+        ShaderProgram::bindBlock("Lights", binding);
+        blockBound = true;
+    }
+    static const Uniform numLightsUniform("numLights");
+    ShaderProgram &program = ShaderProgram::get(shaderID);
     unsigned int numLights = static_cast<unsigned int>(lightSources.size());
-    glUniform1i(glGetUniformLocation(shaderID, "numLights"), numLights);
+    if (numLights > maxLights)
+        numLights = maxLights;
+    program.set(numLightsUniform, static_cast<int>(numLights));
+    
+    // Make the buffer the first time, lights that aren't used have type 0
+    if (!buffer)
+    {
+        uploaded.assign(maxLights, LightBlock());
+        buffer = GLBuffer::create();
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+        glBufferData(GL_UNIFORM_BUFFER, maxLights * sizeof(LightBlock), uploaded.data(), GL_DYNAMIC_DRAW);
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer.get());
     
+    // Build the blocks of every light in view space
+    blocks.assign(maxLights, LightBlock());
+    transformLights(view, lightSources.data(), numLights, blocks.data());
     for (unsigned int i = 0; i < numLights; i++)
     {
-        std::string idx = std::to_string(i);
-        glm::vec3 VSLightPosition  = glm::vec3(view * glm::vec4(lightSources[i].position, 1.0f));
-        glm::vec3 VSLightDirection = glm::vec3(view * glm::vec4(lightSources[i].direction, 0.0f));
-        glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].position").c_str()), 1, &VSLightPosition[0]);
-        glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].direction").c_str()), 1, &VSLightDirection[0]);
-        glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].colour").c_str()), 1, &lightSources[i].colour[0]);
-        glUniform1f(glGetUniformLocation (shaderID, ("lightSources[" + idx + "].constant").c_str()), lightSources[i].constant);
-        glUniform1f(glGetUniformLocation (shaderID, ("lightSources[" + idx + "].linear").c_str()), lightSources[i].linear);
-        glUniform1f(glGetUniformLocation (shaderID, ("lightSources[" + idx + "].quadratic").c_str()), lightSources[i].quadratic);
-        glUniform1f (glGetUniformLocation(shaderID, ("lightSources[" + idx + "].cosPhi").c_str()), lightSources[i].cosPhi);
-        glUniform1i(glGetUniformLocation (shaderID, ("lightSources[" + idx + "].type").c_str()), lightSources[i].type);
+        memcpy(blocks[i].colour, &lightSources[i].colour[0], 3 * sizeof(float));
+        blocks[i].constant  = lightSources[i].constant;
+        blocks[i].linear    = lightSources[i].linear;
+        blocks[i].quadratic = lightSources[i].quadratic;
+        blocks[i].cosPhi    = lightSources[i].cosPhi;
+        blocks[i].type      = static_cast<int>(lightSources[i].type);
     }
+    
+    // Upload the range of lights that changed since the last call
+    unsigned int first = maxLights, last = 0;
+    for (unsigned int i = 0; i < maxLights; i++)
+        if (memcmp(&blocks[i], &uploaded[i], sizeof(LightBlock)) != 0)
+        {
+            first = i < first ? i : first;
+            last = i;
+        }
+    if (first == maxLights)
+    {
+        stats.skipped += numLights;
+        return;
+    }
+    unsigned int count = last - first + 1;
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+    glBufferSubData(GL_UNIFORM_BUFFER, first * sizeof(LightBlock), count * sizeof(LightBlock), &blocks[first]);
+    memcpy(&uploaded[first], &blocks[first], count * sizeof(LightBlock));
+    stats.uploads++;
+    stats.lights  += count;
+    stats.skipped += numLights > count ? numLights - count : 0;
 }
 
-void Light::draw(unsigned int shaderID, glm::mat4 view, glm::mat4 projection, Model lightModel)
+void Light::draw(unsigned int shaderID, const Model &lightModel)
 {
+    static const Uniform MUniform("M"), lightColourUniform("lightColour");
     glUseProgram(shaderID);
+    ShaderProgram &program = ShaderProgram::get(shaderID);
     for (unsigned int i = 0; i < static_cast<unsigned int>(lightSources.size()); i++)
     {
         // Ignore directional lights
@@ -75,14 +166,19 @@ void Light::draw(unsigned int shaderID, glm::mat4 view, glm::mat4 projection, Mo
         glm::mat4 scale     = glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));
         glm::mat4 model     = translate * scale;
         
-        // Send the MVP and MV matrices to the vertex shader
-        glm::mat4 MVP = projection * view * model;
-        glUniformMatrix4fv(glGetUniformLocation(shaderID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
+        // Send the model matrix to the vertex shader
+        program.set(MUniform, model);
 
         // Send model, view, projection matrices and light colour to light shader
-        glUniform3fv(glGetUniformLocation(shaderID, "lightColour"), 1, &lightSources[i].colour[0]);
+        program.set(lightColourUniform, lightSources[i].colour);
 
         // Draw light source
         lightModel.draw(shaderID);
     }
 }
+
+void Light::deleteBuffers()
+{
+    buffer.reset();
+    uploaded.clear();
+}
@@ -2,6 +2,7 @@
 
 #include <external/glm-0.9.7.1/glm/gtc/matrix_transform.hpp>
 #include <common/model.hpp>
+#include <common/glhandle.hpp>
 
 struct LightSource
 {
@@ -15,12 +16,50 @@ struct LightSource
     unsigned int type;
 };
 
+// A light source as the shaders' Lights uniform block holds it, in the
+// std140 layout of their Light struct
+struct LightBlock
+{
+    float position[4];      // view space, w is padding
+    float colour[4];        // w is padding
+    float direction[3];     // view space
+    float constant;
+    float linear;
+    float quadratic;
+    float cosPhi;
+    int   type;
+};
+
+// Counters of the uploads to a light uniform buffer
+struct LightUploadStats
+{
+    size_t uploads = 0;     // glBufferSubData calls
+    size_t lights  = 0;     // lights uploaded
+    size_t skipped = 0;     // lights that hadn't changed
+};
+
 class Light
 {
 public:
+    Light() {}
+    
+    // Lights own their uniform buffer, so they can be moved but not copied
+    Light(Light &&other) = default;
+    Light &operator=(Light &&other) = default;
+    Light(const Light &) = delete;
+    Light &operator=(const Light &) = delete;
+    
     std::vector<LightSource> lightSources;
     unsigned int lightShaderID;
     
+    // Lights the shaders' Lights block holds and the binding point shared
+    // by every lit program
+    static const unsigned int maxLights = 10;
+    static const unsigned int binding = 0;
+    
+    // Counters of every toShader call
+    LightUploadStats stats;
+    
     // Add lightSources
     void addPointLight      (const glm::vec3 position,  const glm::vec3 colour,
                              const float constant,      const float linear,
@@ -31,9 +70,17 @@ public:
                              const float cosPhi);
     void addDirectionalLight(const glm::vec3 direction, const glm::vec3 colour);
     
-    // Send to shader
+    // Send to shader, uploading the lights that changed in view space
     void toShader(unsigned int shaderID, glm::mat4 view);
     
     // Draw light source
-    void draw(unsigned int shaderID, glm::mat4 view, glm::mat4 projection, Model lightModel);
+    void draw(unsigned int shaderID, const Model &lightModel);
+    
+    // Delete the uniform buffer
+    void deleteBuffers();
+    
+private:
+    GLBuffer buffer;
+    std::vector<LightBlock> uploaded;   // what the buffer holds
+    std::vector<LightBlock> blocks;     // built each toShader call
 };
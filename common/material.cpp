@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <vector>
+
+#include "material.hpp"
+#include "compressedtexture.hpp"
+#include "texturecache.hpp"
+#include "sourcefile.hpp"
+
+// Change whenever the packed textures change
+static const char *packVersion = "pack 2";
+
+// Key of the source file descriptions in the cached KTX2 files
+static const char *sourceKey = "CGLabs.source";
+
+std::string MaterialTexture::name() const
+{
+    std::string name = TextureCache::canonicalPath(path.c_str());
+    if (!specularPath.empty())
+        return name + "+" + TextureCache::canonicalPath(specularPath.c_str());
+    return normalMap ? name + "#xy" : name;
+}
+
+std::string packedCachePath(const char *diffusePath, const char *specularPath, TextureCompression format,
+                            const MipSettings &settings)
+{
+    // Named after the specular map's file, without its directory
+    std::string specular(specularPath);
+    size_t slash = specular.find_last_of("/\\");
+    if (slash != std::string::npos)
+        specular = specular.substr(slash + 1);
+    std::string base = std::string(diffusePath) + "+" + specular;
+    return format == TextureCompression::None ? mipCachePath(base.c_str(), settings)
+                                              : compressedCachePath(base.c_str(), format);
+}
+
+// Descriptions of both source files, one a line
+static bool describeSources(const char *diffusePath, const char *specularPath, const std::string &version,
+                            std::string &description)
+{
+    std::string diffuse, specular;
+    if (!describeSource(diffusePath, version, diffuse) || !describeSource(specularPath, version, specular))
+        return false;
+    description = diffuse + "\n" + specular;
+    return true;
+}
+
+static bool sourcesUnchanged(const char *diffusePath, const char *specularPath, const std::string &version,
+                             const std::string &description)
+{
+    size_t split = description.find('\n');
+    return split != std::string::npos &&
+           sourceUnchanged(diffusePath, version, description.substr(0, split)) &&
+           sourceUnchanged(specularPath, version, description.substr(split + 1));
+}
+
+// Colour of the diffuse map with the specular map's first channel as alpha
+static bool packImages(const char *diffusePath, const char *specularPath, std::vector<uint8_t> &rgba,
+                       int &width, int &height)
+{
+    Image diffuse, specular;
+    if (!diffuse.load(diffusePath) || !specular.load(specularPath))
+        return false;
+
+    width  = diffuse.width;
+    height = diffuse.height;
+    rgba.resize(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; y++)
+    {
+        // Nearest specular texel, if the sizes differ
+        int sy = static_cast<int>(static_cast<long long>(y) * specular.height / height);
+        for (int x = 0; x < width; x++)
+        {
+            int sx = static_cast<int>(static_cast<long long>(x) * specular.width / width);
+            const uint8_t *colour = diffuse.pixels + (static_cast<size_t>(y) * width + x) * diffuse.channels;
+            uint8_t *out = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+            out[0] = colour[0];
+            out[1] = diffuse.channels >= 3 ? colour[1] : colour[0];
+            out[2] = diffuse.channels >= 3 ? colour[2] : colour[0];
+            out[3] = specular.pixels[(static_cast<size_t>(sy) * specular.width + sx) * specular.channels];
+        }
+    }
+    return true;
+}
+
+bool loadPackedMaterial(const char *diffusePath, const char *specularPath, const MipSettings &settings,
+                        MipChain &chain)
+{
+    // Use the cache if it was built with the same settings from the same files
+    std::string version = std::string(packVersion) + " " + mipSettingsName(settings);
+    std::string cachePath = packedCachePath(diffusePath, specularPath, TextureCompression::None, settings);
+    std::string source;
+    if (readKtx2(cachePath.c_str(), chain, sourceKey, &source) &&
+        sourcesUnchanged(diffusePath, specularPath, version, source))
+    {
+        chain.settings = settings;
+        return true;
+    }
+
+    // Pack the images, build the mipmaps and cache them for next time
+    std::vector<uint8_t> rgba;
+    int width, height;
+    if (!packImages(diffusePath, specularPath, rgba, width, height) ||
+        !describeSources(diffusePath, specularPath, version, source))
+        return false;
+    chain = generateMips(rgba.data(), width, height, 4, settings);
+    if (!writeKtx2(cachePath.c_str(), chain, sourceKey, source))
+        printf("Couldn't write packed material cache %s\n", cachePath.c_str());
+    return true;
+}
+
+bool loadPackedMaterial(const char *diffusePath, const char *specularPath, CompressedTexture &texture)
+{
+    // Use the cache if it was written by this encoder from the same files
+    std::string version = std::string(packVersion) + " " + compressorVersion();
+    std::string cachePath = packedCachePath(diffusePath, specularPath, TextureCompression::BC3);
+    std::string source;
+    if (readKtx2(cachePath.c_str(), texture, sourceKey, &source) &&
+        sourcesUnchanged(diffusePath, specularPath, version, source))
+        return true;
+
+    // Pack and compress the images and cache them for next time
+    std::vector<uint8_t> rgba;
+    int width, height;
+    if (!packImages(diffusePath, specularPath, rgba, width, height) ||
+        !describeSources(diffusePath, specularPath, version, source))
+        return false;
+    texture = compressTexture(rgba.data(), width, height, TextureCompression::BC3);
+    if (!writeKtx2(cachePath.c_str(), texture, sourceKey, source))
+        printf("Couldn't write packed material cache %s\n", cachePath.c_str());
+    return true;
+}
+
+void keepNormalXY(MipChain &chain)
+{
+    if (chain.channels <= 2)
+        return;
+    for (size_t i = 0; i < chain.levels.size(); i++)
+    {
+        std::vector<uint8_t> &level = chain.levels[i];
+        size_t texels = level.size() / chain.channels;
+        for (size_t t = 0; t < texels; t++)
+        {
+            level[2 * t]     = level[t * chain.channels];
+            level[2 * t + 1] = level[t * chain.channels + 1];
+        }
+        level.resize(2 * texels);
+        level.shrink_to_fit();
+    }
+    chain.channels = 2;
+}
+
+bool loadMaterialTexture(const MaterialTexture &texture, TextureCompression compression,
+                         const MipSettings &settings, CompressedTexture &compressed, MipChain &chain)
+{
+    const char *path = texture.path.c_str();
+    if (!texture.specularPath.empty())
+    {
+        const char *specularPath = texture.specularPath.c_str();
+        if (compression != TextureCompression::None && loadPackedMaterial(path, specularPath, compressed))
+            return true;
+        return loadPackedMaterial(path, specularPath, settings, chain);
+    }
+
+    if (compression != TextureCompression::None && loadCompressedTexture(path, compression, compressed))
+        return true;
+    if (!loadMipChain(path, settings, chain))
+        return false;
+    if (texture.normalMap)
+        keepNormalXY(chain);
+    chain.settings = settings;
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+
+#include "image.hpp"
+#include "ktx.hpp"
+#include "mipmap.hpp"
+
+// A texture of a material packed so that a fragment shader samples fewer
+// textures: a diffuse map with a specular map in its alpha channel, or a
+// normal map keeping only x and y for the shader to rebuild z from
+struct MaterialTexture
+{
+    std::string path;           // of the diffuse or normal map
+    std::string specularPath;   // packed into the diffuse map's alpha, if not empty
+    bool normalMap = false;     // keep only x and y
+
+    // Name the texture is shared under in the texture cache, from the
+    // canonical paths of its files
+    std::string name() const;
+};
+
+// Path of a diffuse map packed with a specular map cached next to the
+// diffuse map, e.g. "bricks_diffuse.png+bricks_specular.png.bc3.ktx2", or
+// the mipmaps built with settings if format is None
+std::string packedCachePath(const char *diffusePath, const char *specularPath, TextureCompression format,
+                            const MipSettings &settings = MipSettings());
+
+// Read a diffuse map packed with a specular map from its cache, or pack,
+// build the mipmaps and write the cache if there is none or either image
+// has changed since. The specular map's first channel becomes the alpha,
+// resampled to the diffuse map's size if they differ; the alpha is filtered
+// linearly while the colour follows the settings. Touches no GL state.
+bool loadPackedMaterial(const char *diffusePath, const char *specularPath, const MipSettings &settings,
+                        MipChain &chain);
+
+// The same block compressed as BC3
+bool loadPackedMaterial(const char *diffusePath, const char *specularPath, CompressedTexture &texture);
+
+// Drop the z of a normal map's mipmaps, leaving two channels
+void keepNormalXY(MipChain &chain);
+
+// Load a material texture on any thread, compressed if compression isn't
+// None and that works, into chain otherwise. Normal maps are compressed to
+// BC5, which only has x and y, and packed diffuse maps to BC3.
+bool loadMaterialTexture(const MaterialTexture &texture, TextureCompression compression,
+                         const MipSettings &settings, CompressedTexture &compressed, MipChain &chain);
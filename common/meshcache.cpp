@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "meshcache.hpp"
+#include "atomicfile.hpp"
+#include "sourcefile.hpp"
+
+static const char meshCacheMagic[8] = { 'C', 'G', 'M', 'E', 'S', 'H', 0, 0 };
+
+// A single level isn't simplified, so its error doesn't matter
+static float cachedLodError(uint32_t flags, float lodMaxError)
+{
+    return ((flags >> MeshCache::lodShift) & 0xff) > 1 ? lodMaxError : 0.0f;
+}
+
+std::string MeshCache::cachePath(const char *objPath, uint32_t flags, float lodMaxError)
+{
+    char lods[32];
+    unsigned int numLods = (flags >> lodShift) & 0xff;
+    if (numLods > 1)
+        snprintf(lods, sizeof(lods), ".lod%u-%g", numLods, lodMaxError);
+    else
+        snprintf(lods, sizeof(lods), ".lod%u", numLods);
+    return std::string(objPath) + lods + ((flags & optimized) ? ".opt" : "") +
+           ((flags & compact) ? ".compact" : "") + ".mesh";
+}
+
+// Bytes of an index buffer, padded so what follows stays 4-byte aligned
+static uint64_t paddedIndexBytes(uint64_t numIndices, uint64_t indexSize)
+{
+    return (numIndices * indexSize + 3) & ~uint64_t(3);
+}
+
+bool MeshCache::open(const char *objPath, uint32_t flags, float lodMaxError)
+{
+    header = NULL;
+    buffers = MeshBuffers();
+    streams = MeshStreams();
+
+    std::string path = cachePath(objPath, flags, lodMaxError);
+    if (!file.open(path.c_str()) || file.size < sizeof(MeshCacheHeader))
+    {
+        file.close();
+        return false;
+    }
+
+    // Check the header
+    const MeshCacheHeader *cached = reinterpret_cast<const MeshCacheHeader *>(file.data);
+    VertexFormat format = (flags & compact) ? VertexFormat::Compact : VertexFormat::Standard;
+    uint64_t streamBytes = 4 * sizeof(glm::vec3) + sizeof(glm::vec2);
+    if (memcmp(cached->magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0 ||
+        cached->version != version ||
+        cached->headerSize != sizeof(MeshCacheHeader) ||
+        cached->flags != flags ||
+        cached->lodMaxError != cachedLodError(flags, lodMaxError) ||
+        cached->numLods == 0 ||
+        cached->vertexSize != vertexSize(format) ||
+        cached->indexSize != indexSize(static_cast<size_t>(cached->numVertices)) ||
+        file.size != sizeof(MeshCacheHeader) + cached->numVertices * (cached->vertexSize + streamBytes) +
+                     paddedIndexBytes(cached->numIndices, cached->indexSize) + cached->numLods * sizeof(MeshLod))
+    {
+        file.close();
+        return false;
+    }
+
+    // The cache is stale if the source has changed. A different modification
+    // time alone (e.g. after a fresh checkout) only costs a hash of the source.
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (!fileInfo(objPath, sourceSize, sourceTime) || sourceSize != cached->sourceSize)
+    {
+        file.close();
+        return false;
+    }
+    if (sourceTime != cached->sourceTime)
+    {
+        uint64_t sourceHash;
+        if (!hashFile(objPath, sourceHash) || sourceHash != cached->sourceHash)
+        {
+            file.close();
+            return false;
+        }
+    }
+
+    // Point the buffers and streams into the mapping
+    const char *data = file.data + sizeof(MeshCacheHeader);
+    size_t numVertices = static_cast<size_t>(cached->numVertices);
+    buffers.vertices    = data;
+    buffers.vertexBytes = numVertices * cached->vertexSize;
+    data += buffers.vertexBytes;
+    buffers.indices     = data;
+    buffers.indexSize   = cached->indexSize;
+    buffers.indexBytes  = static_cast<size_t>(cached->numIndices) * cached->indexSize;
+    data += paddedIndexBytes(cached->numIndices, cached->indexSize);
+    streams.numVertices = numVertices;
+    streams.numIndices  = static_cast<size_t>(cached->numIndices);
+    streams.numLods     = cached->numLods;
+    streams.lods        = reinterpret_cast<const MeshLod *>(data);
+    data += streams.numLods * sizeof(MeshLod);
+    streams.positions   = reinterpret_cast<const glm::vec3 *>(data);
+    data += numVertices * sizeof(glm::vec3);
+    streams.uvs         = reinterpret_cast<const glm::vec2 *>(data);
+    data += numVertices * sizeof(glm::vec2);
+    streams.normals     = reinterpret_cast<const glm::vec3 *>(data);
+    data += numVertices * sizeof(glm::vec3);
+    streams.tangents    = reinterpret_cast<const glm::vec3 *>(data);
+    data += numVertices * sizeof(glm::vec3);
+    streams.bitangents  = reinterpret_cast<const glm::vec3 *>(data);
+
+    // Every level of detail must lie within the indices
+    for (size_t i = 0; i < streams.numLods; i++)
+        if (static_cast<uint64_t>(streams.lods[i].offset) + streams.lods[i].count > cached->numIndices)
+        {
+            buffers = MeshBuffers();
+            streams = MeshStreams();
+            file.close();
+            return false;
+        }
+
+    header = cached;
+    return true;
+}
+
+bool MeshCache::write(const char *objPath, const MeshStreams &streams, const MeshBuffers &buffers,
+                      const Bounds &bounds, float uvDensity, uint32_t flags, float lodMaxError)
+{
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(MeshCacheHeader));
+    memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+    header.version      = version;
+    header.headerSize   = sizeof(MeshCacheHeader);
+    header.flags        = flags;
+    header.numVertices  = streams.numVertices;
+    header.numIndices   = streams.numIndices;
+    header.numLods      = static_cast<uint32_t>(streams.numLods);
+    header.vertexSize   = static_cast<uint32_t>(vertexSize((flags & compact) ? VertexFormat::Compact : VertexFormat::Standard));
+    header.indexSize    = static_cast<uint32_t>(buffers.indexSize);
+    header.boundsRadius = bounds.radius;
+    header.uvDensity    = uvDensity;
+    header.lodMaxError  = cachedLodError(flags, lodMaxError);
+    for (int i = 0; i < 3; i++)
+    {
+        header.boundsMin[i] = bounds.min[i];
+        header.boundsMax[i] = bounds.max[i];
+    }
+    if (!fileInfo(objPath, header.sourceSize, header.sourceTime) ||
+        !hashFile(objPath, header.sourceHash))
+        return false;
+
+    static const char padding[4] = { 0, 0, 0, 0 };
+    size_t paddingBytes = static_cast<size_t>(paddedIndexBytes(streams.numIndices, buffers.indexSize)) - buffers.indexBytes;
+    size_t n = streams.numVertices;
+    return writeFileAtomically(cachePath(objPath, flags, lodMaxError).c_str(), [&](FILE *file)
+    {
+        return fwrite(&header, sizeof(MeshCacheHeader), 1, file) == 1 &&
+               fwrite(buffers.vertices, 1, buffers.vertexBytes, file) == buffers.vertexBytes &&
+               fwrite(buffers.indices, 1, buffers.indexBytes, file) == buffers.indexBytes &&
+               fwrite(padding, 1, paddingBytes, file) == paddingBytes &&
+               fwrite(streams.lods, sizeof(MeshLod), streams.numLods, file) == streams.numLods &&
+               fwrite(streams.positions,  sizeof(glm::vec3), n, file) == n &&
+               fwrite(streams.uvs,        sizeof(glm::vec2), n, file) == n &&
+               fwrite(streams.normals,    sizeof(glm::vec3), n, file) == n &&
+               fwrite(streams.tangents,   sizeof(glm::vec3), n, file) == n &&
+               fwrite(streams.bitangents, sizeof(glm::vec3), n, file) == n;
+    });
+}
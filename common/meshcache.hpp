@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "objloader.hpp"
+#include "vertexformat.hpp"
+#include "culling.hpp"
+
+// Header at the start of a binary mesh cache file. It is followed by the
+// vertex buffer as uploaded, the index buffer of every level of detail
+// padded to 4 bytes, the level ranges and then the attribute streams in the
+// order positions, uvs, normals, tangents, bitangents.
+struct MeshCacheHeader
+{
+    char      magic[8];         // "CGMESH\0\0"
+    uint32_t  version;
+    uint32_t  headerSize;
+    uint32_t  flags;            // processing applied, see MeshCache
+    uint32_t  numLods;
+    uint64_t  sourceSize;       // size of the .obj file in bytes
+    int64_t   sourceTime;       // modification time of the .obj file
+    uint64_t  sourceHash;       // hash of the .obj file contents
+    uint64_t  numVertices;
+    uint64_t  numIndices;
+    uint32_t  vertexSize;       // bytes per vertex in the vertex buffer
+    uint32_t  indexSize;        // bytes per index in the index buffer, 2 or 4
+    float     boundsMin[3];
+    float     boundsMax[3];
+    float     boundsRadius;     // sphere centred on the box
+    float     uvDensity;        // of the full detail level, see Model
+    float     lodMaxError;      // the levels were simplified to, see ModelSettings
+};
+
+// Binary mesh cache stored next to the .obj file it was built from
+class MeshCache
+{
+public:
+    // Increase whenever the cached data or its layout changes
+    static const uint32_t version = 7;
+
+    // Processing applied to the cached mesh, a cache is only used if its
+    // flags match the ones asked for
+    static const uint32_t optimized = 1u << 0;
+    static const uint32_t compact   = 1u << 1;  // VertexFormat::Compact vertex buffer
+    static const uint32_t lodShift  = 8;        // number of LOD levels in bits 8-15
+
+    // Memory mapped cache contents, valid while the cache is open. Pages
+    // are only read when touched, so a model keeping no attributes in
+    // memory only reads the buffers it uploads. The streams have no
+    // indices, which are only in the index buffer.
+    const MeshCacheHeader *header = NULL;
+    MeshBuffers            buffers;
+    MeshStreams            streams;
+
+    // Map the cache for an .obj file. Returns false if there is no cache,
+    // the .obj file has changed since it was written or it was processed
+    // differently. lodMaxError only matters with more than one level.
+    bool open(const char *objPath, uint32_t flags = 0, float lodMaxError = 0.0f);
+
+    // Write the cache for an .obj file: the buffers to upload, the mesh's
+    // bounds and texture density, and the streams the buffers were built from
+    static bool write(const char *objPath, const MeshStreams &streams, const MeshBuffers &buffers,
+                      const Bounds &bounds, float uvDensity, uint32_t flags = 0,
+                      float lodMaxError = 0.0f);
+
+    // Path of the cache for an .obj file processed with flags. Each set of
+    // flags and LOD error has its own file, e.g.
+    // "teapot.obj.lod4-0.05.opt.compact.mesh", so models loaded with
+    // different settings don't keep rewriting each other's.
+    static std::string cachePath(const char *objPath, uint32_t flags = 0, float lodMaxError = 0.0f);
+
+private:
+    MappedFile file;
+};
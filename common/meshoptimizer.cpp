@@ -0,0 +1,798 @@
+#include <math.h>
+#include <string.h>
+#include <float.h>
+#include <algorithm>
+#include <unordered_map>
+
+#include "meshoptimizer.hpp"
+
+// -----------------------------------------------------------------------------
+// Vertex cache analysis
+// -----------------------------------------------------------------------------
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices,
+                                    size_t numVertices, unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+        return stats;
+
+    // A vertex is in the FIFO cache if fewer than cacheSize misses happened
+    // since it was last loaded
+    std::vector<unsigned int> loadedAt(numVertices, 0);
+    std::vector<char> used(numVertices, 0);
+    unsigned int misses = 0;
+    size_t numUsed = 0;
+
+    for (size_t i = 0; i < numTriangles * 3; i++)
+    {
+        unsigned int v = indices[i];
+        if (!used[v] || misses - loadedAt[v] > cacheSize)
+        {
+            if (!used[v])
+            {
+                used[v] = 1;
+                numUsed++;
+            }
+            loadedAt[v] = misses;
+            misses++;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / numTriangles;
+    stats.atvr = static_cast<float>(misses) / numUsed;
+    return stats;
+}
+
+// -----------------------------------------------------------------------------
+// Forsyth vertex cache optimisation
+// -----------------------------------------------------------------------------
+static const int   forsythCacheSize    = 32;
+static const float forsythDecayPower   = 1.5f;
+static const float forsythLastTriScore = 0.75f;
+static const float forsythValenceScale = 2.0f;
+static const float forsythValencePower = 0.5f;
+
+static float forsythScore(int cachePosition, unsigned int liveTriangles)
+{
+    // Vertices with no triangles left are never wanted
+    if (liveTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The three vertices of the last triangle get a fixed score so the
+        // next triangle doesn't just reuse the same edge
+        if (cachePosition < 3)
+            score = forsythLastTriScore;
+        else
+            score = powf(1.0f - static_cast<float>(cachePosition - 3) / (forsythCacheSize - 3),
+                         forsythDecayPower);
+    }
+
+    // Boost vertices with few triangles left to get rid of lone triangles
+    score += forsythValenceScale * powf(static_cast<float>(liveTriangles), -forsythValencePower);
+    return score;
+}
+
+// Scores for every cache position and small valences, so the main loop
+// doesn't call powf
+static const unsigned int forsythMaxValence = 32;
+
+struct ForsythTable
+{
+    float score[forsythCacheSize + 1][forsythMaxValence];
+
+    ForsythTable()
+    {
+        for (int position = -1; position < forsythCacheSize; position++)
+            for (unsigned int valence = 0; valence < forsythMaxValence; valence++)
+                score[position + 1][valence] = forsythScore(position, valence);
+    }
+
+    float operator()(int cachePosition, unsigned int liveTriangles) const
+    {
+        if (liveTriangles < forsythMaxValence)
+            return score[cachePosition + 1][liveTriangles];
+        return forsythScore(cachePosition, liveTriangles);
+    }
+};
+
+void optimizeVertexCache(std::vector<unsigned int> &indices, size_t numVertices)
+{
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+        return;
+
+    // Triangles using each vertex, stored as one array with per-vertex ranges
+    std::vector<unsigned int> liveTriangles(numVertices, 0);
+    for (size_t i = 0; i < numTriangles * 3; i++)
+        liveTriangles[indices[i]]++;
+
+    std::vector<unsigned int> offsets(numVertices + 1, 0);
+    for (size_t v = 0; v < numVertices; v++)
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+
+    std::vector<unsigned int> adjacency(numTriangles * 3);
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < numTriangles; t++)
+        for (int k = 0; k < 3; k++)
+            adjacency[fill[indices[3 * t + k]]++] = static_cast<unsigned int>(t);
+
+    // Initial scores
+    static const ForsythTable scoreTable;
+    std::vector<int> cachePosition(numVertices, -1);
+    std::vector<float> vertexScore(numVertices);
+    for (size_t v = 0; v < numVertices; v++)
+        vertexScore[v] = scoreTable(-1, liveTriangles[v]);
+
+    std::vector<char> emitted(numTriangles, 0);
+
+    std::vector<unsigned int> output(numTriangles * 3);
+    unsigned int cache[forsythCacheSize + 3];
+    unsigned int newCache[forsythCacheSize + 3];
+    int cacheCount = 0;
+
+    size_t inputCursor = 0;
+    long long bestTriangle = -1;
+
+    for (size_t emittedCount = 0; emittedCount < numTriangles; emittedCount++)
+    {
+        // If no cached vertex has a live triangle, take the next unused
+        // triangle in input order
+        if (bestTriangle < 0)
+        {
+            while (emitted[inputCursor])
+                inputCursor++;
+            bestTriangle = static_cast<long long>(inputCursor);
+        }
+
+        // Emit the triangle
+        size_t t = static_cast<size_t>(bestTriangle);
+        const unsigned int *triangle = &indices[3 * t];
+        output[3 * emittedCount]     = triangle[0];
+        output[3 * emittedCount + 1] = triangle[1];
+        output[3 * emittedCount + 2] = triangle[2];
+        emitted[t] = 1;
+
+        // Remove it from its vertices' live triangle lists
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = triangle[k];
+            unsigned int *list = &adjacency[offsets[v]];
+            for (unsigned int j = 0; j < liveTriangles[v]; j++)
+            {
+                if (list[j] == t)
+                {
+                    list[j] = list[liveTriangles[v] - 1];
+                    break;
+                }
+            }
+            liveTriangles[v]--;
+        }
+
+        // Push the triangle's vertices to the front of the LRU cache
+        int newCount = 0;
+        for (int k = 0; k < 3; k++)
+            newCache[newCount++] = triangle[k];
+        for (int j = 0; j < cacheCount; j++)
+        {
+            unsigned int v = cache[j];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache[newCount++] = v;
+        }
+
+        // Update the scores of the vertices in the cache and of any pushed out
+        for (int j = 0; j < newCount; j++)
+        {
+            unsigned int v = newCache[j];
+            cachePosition[v] = j < forsythCacheSize ? j : -1;
+            vertexScore[v] = scoreTable(cachePosition[v], liveTriangles[v]);
+        }
+
+        // Re-score the live triangles of the cached vertices and pick the best
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (int j = 0; j < newCount && j < forsythCacheSize; j++)
+        {
+            unsigned int v = newCache[j];
+            const unsigned int *list = &adjacency[offsets[v]];
+            for (unsigned int k = 0; k < liveTriangles[v]; k++)
+            {
+                unsigned int candidate = list[k];
+                const unsigned int *c = &indices[3 * candidate];
+                float score = vertexScore[c[0]] + vertexScore[c[1]] + vertexScore[c[2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = candidate;
+                }
+            }
+        }
+
+        cacheCount = newCount < forsythCacheSize ? newCount : forsythCacheSize;
+        for (int j = 0; j < cacheCount; j++)
+            cache[j] = newCache[j];
+    }
+
+    indices.swap(output);
+}
+
+// -----------------------------------------------------------------------------
+// Overdraw optimisation
+// -----------------------------------------------------------------------------
+
+// FIFO cache simulation that can be reset in constant time
+struct FifoCache
+{
+    std::vector<unsigned int> loadedAt;
+    unsigned int time = 0;
+    unsigned int size;
+
+    FifoCache(size_t numVertices, unsigned int cacheSize)
+        : loadedAt(numVertices, 0), time(cacheSize + 1), size(cacheSize) {}
+
+    // Returns the number of misses for a triangle
+    unsigned int triangle(const unsigned int *t)
+    {
+        unsigned int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            if (time - loadedAt[t[k]] > size)
+            {
+                loadedAt[t[k]] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+    void reset()
+    {
+        time += size + 1;
+    }
+};
+
+void optimizeOverdraw(std::vector<unsigned int> &indices, const glm::vec3 *positions,
+                      size_t numVertices, float threshold)
+{
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles < 2)
+        return;
+
+    const unsigned int cacheSize = 16;
+
+    // Hard cluster boundaries are where the cache is flushed anyway, i.e.
+    // all three vertices of a triangle miss
+    std::vector<size_t> hardBoundaries;
+    {
+        FifoCache cache(numVertices, cacheSize);
+        for (size_t t = 0; t < numTriangles; t++)
+            if (cache.triangle(&indices[3 * t]) == 3)
+                hardBoundaries.push_back(t);
+    }
+    if (hardBoundaries.empty() || hardBoundaries[0] != 0)
+        hardBoundaries.insert(hardBoundaries.begin(), 0);
+    hardBoundaries.push_back(numTriangles);
+
+    // Split the hard clusters further wherever the ACMR so far is within the
+    // threshold of the whole cluster's, as restarting there costs little
+    std::vector<size_t> clusters;
+    {
+        FifoCache cache(numVertices, cacheSize);
+        for (size_t c = 0; c + 1 < hardBoundaries.size(); c++)
+        {
+            size_t start = hardBoundaries[c], end = hardBoundaries[c + 1];
+
+            cache.reset();
+            unsigned int clusterMisses = 0;
+            for (size_t t = start; t < end; t++)
+                clusterMisses += cache.triangle(&indices[3 * t]);
+            float limit = threshold * clusterMisses / (end - start);
+
+            cache.reset();
+            clusters.push_back(start);
+            unsigned int misses = 0, triangles = 0;
+            for (size_t t = start; t < end; t++)
+            {
+                misses += cache.triangle(&indices[3 * t]);
+                triangles++;
+                if (t + 1 < end && static_cast<float>(misses) / triangles <= limit)
+                {
+                    clusters.push_back(t + 1);
+                    cache.reset();
+                    misses = triangles = 0;
+                }
+            }
+        }
+    }
+    clusters.push_back(numTriangles);
+    size_t numClusters = clusters.size() - 1;
+
+    // Area weighted centroid of the whole mesh
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < numTriangles; t++)
+    {
+        const glm::vec3 &a = positions[indices[3 * t]];
+        const glm::vec3 &b = positions[indices[3 * t + 1]];
+        const glm::vec3 &c = positions[indices[3 * t + 2]];
+        float area = glm::length(glm::cross(b - a, c - a));
+        meshCentroid += area * (a + b + c) / 3.0f;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Sort key of each cluster: how much it faces away from the centre
+    std::vector<float> keys(numClusters);
+    float minKey = 0.0f, maxKey = 0.0f;
+    for (size_t c = 0; c < numClusters; c++)
+    {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            const glm::vec3 &a = positions[indices[3 * t]];
+            const glm::vec3 &b = positions[indices[3 * t + 1]];
+            const glm::vec3 &p = positions[indices[3 * t + 2]];
+            glm::vec3 n = glm::cross(b - a, p - a);
+            float triangleArea = glm::length(n);
+            centroid += triangleArea * (a + b + p) / 3.0f;
+            normal += n;
+            area += triangleArea;
+        }
+        if (area > 0.0f)
+            centroid /= area;
+        float length = glm::length(normal);
+        keys[c] = length > 0.0f ? glm::dot(centroid - meshCentroid, normal / length) : 0.0f;
+        minKey = c == 0 ? keys[c] : glm::min(minKey, keys[c]);
+        maxKey = c == 0 ? keys[c] : glm::max(maxKey, keys[c]);
+    }
+
+    // Counting sort of the quantised keys, largest first, keeps this linear
+    const unsigned int numBuckets = 1024;
+    std::vector<unsigned int> bucket(numClusters);
+    std::vector<size_t> bucketStart(numBuckets + 1, 0);
+    float scale = maxKey > minKey ? (numBuckets - 1) / (maxKey - minKey) : 0.0f;
+    for (size_t c = 0; c < numClusters; c++)
+    {
+        bucket[c] = numBuckets - 1 - static_cast<unsigned int>((keys[c] - minKey) * scale);
+        bucketStart[bucket[c] + 1]++;
+    }
+    for (unsigned int b = 0; b < numBuckets; b++)
+        bucketStart[b + 1] += bucketStart[b];
+
+    std::vector<size_t> order(numClusters);
+    for (size_t c = 0; c < numClusters; c++)
+        order[bucketStart[bucket[c]]++] = c;
+
+    // Write the clusters out in sorted order
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (size_t i = 0; i < numClusters; i++)
+    {
+        size_t c = order[i];
+        output.insert(output.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * clusters[c + 1]);
+    }
+    indices.swap(output);
+}
+
+// -----------------------------------------------------------------------------
+// Vertex fetch optimisation
+// -----------------------------------------------------------------------------
+std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int> &indices,
+                                              size_t numVertices)
+{
+    const unsigned int unused = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(numVertices, unused);
+    unsigned int next = 0;
+
+    // Number vertices in order of first use
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        unsigned int &target = remap[indices[i]];
+        if (target == unused)
+            target = next++;
+        indices[i] = target;
+    }
+
+    // Keep unreferenced vertices at the end
+    for (size_t v = 0; v < numVertices; v++)
+        if (remap[v] == unused)
+            remap[v] = next++;
+
+    return remap;
+}
+
+// -----------------------------------------------------------------------------
+// Simplification
+// -----------------------------------------------------------------------------
+
+// Sum of squared distances to a set of planes, n.p + d = 0, weighted by the
+// area of the triangle each plane came from
+struct Quadric
+{
+    double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0;
+    double weight = 0;
+
+    void addPlane(const glm::vec3 &n, float d, float w)
+    {
+        a00 += w * n.x * n.x;
+        a11 += w * n.y * n.y;
+        a22 += w * n.z * n.z;
+        a01 += w * n.x * n.y;
+        a02 += w * n.x * n.z;
+        a12 += w * n.y * n.z;
+        b0  += w * n.x * d;
+        b1  += w * n.y * d;
+        b2  += w * n.z * d;
+        c   += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric &q)
+    {
+        a00 += q.a00; a11 += q.a11; a22 += q.a22;
+        a01 += q.a01; a02 += q.a02; a12 += q.a12;
+        b0  += q.b0;  b1  += q.b1;  b2  += q.b2;
+        c   += q.c;
+        weight += q.weight;
+    }
+
+    // Root mean square distance of a point to the planes
+    float error(const glm::vec3 &p) const
+    {
+        if (weight <= 0.0)
+            return 0.0f;
+        double x = p.x, y = p.y, z = p.z;
+        double e = a00 * x * x + a11 * y * y + a22 * z * z
+                 + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                 + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return e > 0.0 ? static_cast<float>(sqrt(e / weight)) : 0.0f;
+    }
+};
+
+// Bit pattern of a position, used to find vertices at the same place
+struct PositionKey
+{
+    uint32_t bits[3];
+
+    bool operator==(const PositionKey &other) const
+    {
+        return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+    }
+};
+
+struct PositionKeyHash
+{
+    size_t operator()(const PositionKey &key) const
+    {
+        uint32_t hash = 2166136261u;
+        for (int i = 0; i < 3; i++)
+            hash = (hash ^ key.bits[i]) * 16777619u;
+        return hash;
+    }
+};
+
+// Vertices that must stay where they are: several vertices sharing a position
+// (UV or normal seams) and vertices on open borders
+static std::vector<char> lockedVertices(const std::vector<unsigned int> &indices,
+                                        const glm::vec3 *positions, size_t numVertices)
+{
+    // Weld vertices by position
+    std::vector<unsigned int> welded(numVertices);
+    std::vector<unsigned int> wedges(numVertices, 0);
+    std::unordered_map<PositionKey, unsigned int, PositionKeyHash> lookup;
+    lookup.reserve(numVertices);
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        PositionKey key;
+        memcpy(key.bits, &positions[v], sizeof(key.bits));
+        unsigned int first = lookup.emplace(key, static_cast<unsigned int>(v)).first->second;
+        welded[v] = first;
+        wedges[first]++;
+    }
+
+    std::vector<char> locked(numVertices, 0);
+    for (size_t v = 0; v < numVertices; v++)
+        if (wedges[welded[v]] > 1)
+            locked[v] = 1;
+
+    // An edge of the welded mesh used by a single triangle is on a border
+    std::unordered_map<uint64_t, unsigned int> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            uint64_t a = welded[indices[i + k]];
+            uint64_t b = welded[indices[i + (k + 1) % 3]];
+            edges[a < b ? (a << 32) | b : (b << 32) | a]++;
+        }
+    }
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            uint64_t a = welded[indices[i + k]];
+            uint64_t b = welded[indices[i + (k + 1) % 3]];
+            if (edges[a < b ? (a << 32) | b : (b << 32) | a] == 1)
+                locked[indices[i + k]] = locked[indices[i + (k + 1) % 3]] = 1;
+        }
+    }
+
+    return locked;
+}
+
+// Candidate collapse of one vertex onto a neighbour
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    float error;
+
+    bool operator<(const Collapse &other) const
+    {
+        return error < other.error;
+    }
+};
+
+std::vector<unsigned int> simplifyMesh(const std::vector<unsigned int> &indices,
+                                       const glm::vec3 *positions, const glm::vec3 *normals,
+                                       size_t numVertices, size_t targetIndexCount,
+                                       float targetError, float *outError)
+{
+    std::vector<unsigned int> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+    float resultError = 0.0f;
+
+    std::vector<char> locked = lockedVertices(result, positions, numVertices);
+
+    // Plane quadrics of the triangles around each vertex
+    std::vector<Quadric> quadrics(numVertices);
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const glm::vec3 &a = positions[result[i]];
+        const glm::vec3 &b = positions[result[i + 1]];
+        const glm::vec3 &c = positions[result[i + 2]];
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float area = glm::length(n);
+        if (area == 0.0f)
+            continue;
+        n /= area;
+        float d = -glm::dot(n, a);
+        for (int k = 0; k < 3; k++)
+            quadrics[result[i + k]].addPlane(n, d, area);
+    }
+
+    std::vector<unsigned int> offsets(numVertices + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> remap(numVertices);
+    std::vector<char> touched(numVertices);
+    std::vector<Collapse> collapses;
+    std::vector<float> bestError(numVertices);
+    std::vector<unsigned int> bestTarget(numVertices);
+
+    // Each pass collapses the cheapest edges whose neighbourhoods don't overlap
+    while (result.size() > targetIndexCount)
+    {
+        size_t numTriangles = result.size() / 3;
+
+        // Triangles around each vertex
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (size_t i = 0; i < result.size(); i++)
+            offsets[result[i] + 1]++;
+        for (size_t v = 0; v < numVertices; v++)
+            offsets[v + 1] += offsets[v];
+        adjacency.resize(result.size());
+        {
+            std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+                adjacency[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        // Cheapest collapse of every free vertex along one of its edges
+        std::fill(bestError.begin(), bestError.end(), FLT_MAX);
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                for (int j = 1; j < 3; j++)
+                {
+                    unsigned int from = result[i + k];
+                    unsigned int to   = result[i + (k + j) % 3];
+                    if (locked[from])
+                        continue;
+
+                    // Position error plus the shading change from snapping
+                    // to the neighbour's normal
+                    float error = quadrics[from].error(positions[to]);
+                    float edge = glm::length(positions[to] - positions[from]);
+                    float normalError = 0.5f * edge * (1.0f - glm::dot(normals[from], normals[to]));
+                    error = glm::max(error, normalError);
+
+                    if (error < bestError[from])
+                    {
+                        bestError[from] = error;
+                        bestTarget[from] = to;
+                    }
+                }
+            }
+        }
+
+        collapses.clear();
+        for (size_t v = 0; v < numVertices; v++)
+        {
+            if (bestError[v] <= targetError)
+            {
+                Collapse collapse;
+                collapse.from  = static_cast<unsigned int>(v);
+                collapse.to    = bestTarget[v];
+                collapse.error = bestError[v];
+                collapses.push_back(collapse);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end());
+
+        // Apply collapses in order of error until enough triangles are gone
+        size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        size_t removed = 0;
+        for (size_t v = 0; v < numVertices; v++)
+            remap[v] = static_cast<unsigned int>(v);
+        std::fill(touched.begin(), touched.end(), 0);
+
+        for (size_t c = 0; c < collapses.size() && removed < trianglesToRemove; c++)
+        {
+            unsigned int from = collapses[c].from, to = collapses[c].to;
+            if (touched[from] || touched[to])
+                continue;
+
+            // Reject collapses that flip a triangle, and count the ones that
+            // disappear
+            bool flips = false;
+            size_t collapsed = 0;
+            for (unsigned int j = offsets[from]; j < offsets[from + 1]; j++)
+            {
+                const unsigned int *t = &result[3 * adjacency[j]];
+                if (t[0] == to || t[1] == to || t[2] == to)
+                {
+                    collapsed++;
+                    continue;
+                }
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    p[k] = positions[t[k]];
+                    q[k] = t[k] == from ? positions[to] : p[k];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after  = glm::cross(q[1] - q[0], q[2] - q[0]);
+                if (glm::dot(before, after) <= 0.0f)
+                {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips)
+                continue;
+
+            // Freeze the neighbourhood for the rest of this pass so that the
+            // checks above stay valid
+            for (unsigned int j = offsets[from]; j < offsets[from + 1]; j++)
+                for (int k = 0; k < 3; k++)
+                    touched[result[3 * adjacency[j] + k]] = 1;
+
+            remap[from] = to;
+            quadrics[to].add(quadrics[from]);
+            resultError = glm::max(resultError, collapses[c].error);
+            removed += collapsed;
+        }
+
+        if (removed == 0)
+            break;
+
+        // Rewrite the indices, dropping triangles that became degenerate
+        size_t write = 0;
+        for (size_t t = 0; t < numTriangles; t++)
+        {
+            unsigned int a = remap[result[3 * t]];
+            unsigned int b = remap[result[3 * t + 1]];
+            unsigned int c = remap[result[3 * t + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    if (outError)
+        *outError = resultError;
+    return result;
+}
+
+std::vector<MeshLod> buildLods(std::vector<unsigned int> &indices, const glm::vec3 *positions,
+                               const glm::vec3 *normals, size_t numVertices,
+                               unsigned int maxLevels, float maxError, bool optimize)
+{
+    std::vector<MeshLod> lods;
+    MeshLod base;
+    base.offset = 0;
+    base.count  = static_cast<uint32_t>(indices.size());
+    base.error  = 0.0f;
+    lods.push_back(base);
+
+    // Simplify each level from the original mesh so errors don't compound
+    std::vector<unsigned int> original(indices);
+    size_t target = original.size();
+    while (lods.size() < maxLevels)
+    {
+        target = target / 6 * 3;
+        if (target == 0)
+            break;
+
+        float error;
+        std::vector<unsigned int> level = simplifyMesh(original, positions, normals, numVertices,
+                                                       target, maxError, &error);
+
+        // Stop once a level isn't noticeably smaller than the last
+        if (level.empty() || level.size() * 10 > lods.back().count * 8)
+            break;
+        if (optimize)
+            optimizeVertexCache(level, numVertices);
+
+        MeshLod lod;
+        lod.offset = static_cast<uint32_t>(indices.size());
+        lod.count  = static_cast<uint32_t>(level.size());
+        lod.error  = glm::max(error, lods.back().error);
+        lods.push_back(lod);
+        indices.insert(indices.end(), level.begin(), level.end());
+    }
+
+    return lods;
+}
+
+float lodPixelScale(const glm::mat4 &projection, const glm::mat4 &modelView,
+                    const glm::vec3 &centre, float radius, float viewportHeight)
+{
+    // Object space units are scaled by the largest axis of the model matrix
+    float scale = glm::max(glm::length(glm::vec3(modelView[0])),
+                  glm::max(glm::length(glm::vec3(modelView[1])),
+                           glm::length(glm::vec3(modelView[2]))));
+
+    // Perspective divide at the nearest point of the sphere, which may be
+    // inside it
+    float depth = -(modelView * glm::vec4(centre, 1.0f)).z - radius * scale;
+    if (depth <= 0.0f)
+        return FLT_MAX;
+    return scale * projection[1][1] * 0.5f * viewportHeight / depth;
+}
+
+float uvDensity(const glm::vec3 *positions, const glm::vec2 *uvs,
+                const unsigned int *indices, size_t numIndices)
+{
+    // Twice the areas, which cancels out in the ratio
+    double uvArea = 0.0, area = 0.0;
+    for (size_t i = 0; i + 2 < numIndices; i += 3)
+    {
+        unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        glm::vec2 uv1 = uvs[b] - uvs[a];
+        glm::vec2 uv2 = uvs[c] - uvs[a];
+        uvArea += fabs(uv1.x * uv2.y - uv1.y * uv2.x);
+        area   += glm::length(glm::cross(positions[b] - positions[a], positions[c] - positions[a]));
+    }
+    if (area <= 0.0)
+        return 0.0f;
+    return static_cast<float>(sqrt(uvArea / area));
+}
+
+size_t selectLod(const std::vector<MeshLod> &lods, float pixelScale, float pixelError)
+{
+    size_t lod = 0;
+    while (lod + 1 < lods.size() && lods[lod + 1].error * pixelScale <= pixelError)
+        lod++;
+    return lod;
+}
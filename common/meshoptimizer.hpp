@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "vertexformat.hpp"
+
+// Post-transform vertex cache statistics of an index buffer
+struct VertexCacheStats
+{
+    float acmr = 0.0f;  // average cache miss ratio, transformed vertices per triangle
+    float atvr = 0.0f;  // average transform to vertex ratio, 1.0 is ideal
+};
+
+// Simulate a FIFO post-transform vertex cache
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices,
+                                    size_t numVertices, unsigned int cacheSize = 16);
+
+// Reorder triangles for post-transform vertex cache locality using Tom
+// Forsyth's linear-speed vertex cache optimisation
+void optimizeVertexCache(std::vector<unsigned int> &indices, size_t numVertices);
+
+// Reorder clusters of the cache optimised triangles so that the ones facing
+// away from the centre of the mesh are drawn first, reducing overdraw from
+// any view point. threshold is how much worse (e.g. 1.05) the ACMR of the
+// clusters may get compared to the input.
+void optimizeOverdraw(std::vector<unsigned int> &indices, const glm::vec3 *positions,
+                      size_t numVertices, float threshold = 1.05f);
+
+// Renumber the vertices in the order they are first used so that vertex
+// fetch is sequential. Rewrites indices and returns the table mapping old
+// vertex numbers to new ones; unused vertices are moved to the end.
+std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int> &indices,
+                                              size_t numVertices);
+
+// Reorder a vertex attribute array using a table from optimizeVertexFetch
+template <typename T>
+void remapVertices(std::vector<T> &attribute, const std::vector<unsigned int> &remap)
+{
+    if (attribute.size() != remap.size())
+        return;
+    std::vector<T> remapped(attribute.size());
+    for (size_t i = 0; i < remap.size(); i++)
+        remapped[remap[i]] = attribute[i];
+    attribute.swap(remapped);
+}
+
+// Simplify a mesh with quadric error metric edge collapses towards
+// targetIndexCount indices, never moving a vertex further than targetError
+// (object space units). Vertices are collapsed onto neighbours so the result
+// indexes the same vertex buffer. Vertices on UV or normal seams (several
+// vertices at one position) and on open borders are never moved, and the
+// normal deviation of a collapse counts towards its error. The error reached
+// is written to outError.
+std::vector<unsigned int> simplifyMesh(const std::vector<unsigned int> &indices,
+                                       const glm::vec3 *positions, const glm::vec3 *normals,
+                                       size_t numVertices, size_t targetIndexCount,
+                                       float targetError, float *outError = NULL);
+
+// Append up to maxLevels - 1 simplified levels, each with half the triangles
+// of the previous one, to the end of indices. Stops early once a level can't
+// be reduced within maxError. Returns the range of every level, level 0
+// being the original indices.
+std::vector<MeshLod> buildLods(std::vector<unsigned int> &indices, const glm::vec3 *positions,
+                               const glm::vec3 *normals, size_t numVertices,
+                               unsigned int maxLevels, float maxError, bool optimize);
+
+// Pixels covered by one object space unit at the nearest point of a bounding
+// sphere, for a viewport viewportHeight pixels high
+float lodPixelScale(const glm::mat4 &projection, const glm::mat4 &modelView,
+                    const glm::vec3 &centre, float radius, float viewportHeight);
+
+// Texture coordinate units per object space unit, from the total UV and
+// object space areas of the triangles, 0 if the mesh has no UVs
+float uvDensity(const glm::vec3 *positions, const glm::vec2 *uvs,
+                const unsigned int *indices, size_t numIndices);
+
+// Coarsest level whose error projects to at most pixelError pixels
+size_t selectLod(const std::vector<MeshLod> &lods, float pixelScale, float pixelError = 1.0f);
@@ -0,0 +1,368 @@
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAP_SSE2 1
+#endif
+
+#include "mipmap.hpp"
+#include "threadpool.hpp"
+
+MipSettings mipSettingsForType(const std::string &type)
+{
+    MipSettings settings;
+    settings.gammaCorrect = type == "diffuse";
+    settings.normalMap    = type == "normal";
+    return settings;
+}
+
+std::string mipSettingsName(const MipSettings &settings)
+{
+    std::string name = settings.filter == MipFilter::Kaiser ? "kaiser" : "box";
+    if (settings.gammaCorrect)
+        name += " srgb";
+    if (settings.normalMap)
+        name += " normal";
+    name += settings.repeat ? " repeat" : " clamp";
+    return name;
+}
+
+int MipChain::levelWidth(size_t level) const
+{
+    int size = width >> level;
+    return size > 0 ? size : 1;
+}
+
+int MipChain::levelHeight(size_t level) const
+{
+    int size = height >> level;
+    return size > 0 ? size : 1;
+}
+
+size_t MipChain::bytes() const
+{
+    size_t total = 0;
+    for (size_t i = 0; i < levels.size(); i++)
+        total += levels[i].size();
+    return total;
+}
+
+int mipLevelCount(int width, int height)
+{
+    int count = 1;
+    while (width > 1 || height > 1)
+    {
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        count++;
+    }
+    return count;
+}
+
+// Conversions between sRGB encoded bytes and linear light
+struct SrgbTables
+{
+    float   decode[256];
+    float   thresholds[256];    // linear value at which byte i + 1 starts
+    uint8_t guess[4097];        // largest byte starting at or below i / 4096
+
+    SrgbTables()
+    {
+        for (int i = 0; i < 256; i++)
+            decode[i] = toLinear(i / 255.0);
+        for (int i = 0; i < 255; i++)
+            thresholds[i] = toLinear((i + 0.5) / 255.0);
+        thresholds[255] = 2.0f;
+        int byte = 0;
+        for (int i = 0; i <= 4096; i++)
+        {
+            while (byte < 255 && thresholds[byte] <= i / 4096.0f)
+                byte++;
+            guess[i] = static_cast<uint8_t>(byte);
+        }
+    }
+
+    static float toLinear(double value)
+    {
+        return static_cast<float>(value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4));
+    }
+
+    // Byte a linear value in [0, 1] rounds to once encoded. The thresholds
+    // are at least 1 / (255 * 12.92) apart, more than a step of the guess
+    // table, so the guess is at most one byte short.
+    uint8_t encode(float value) const
+    {
+        int byte = guess[static_cast<int>(value * 4096.0f)];
+        return static_cast<uint8_t>(byte + (value >= thresholds[byte]));
+    }
+};
+
+static const SrgbTables &srgbTables()
+{
+    static SrgbTables tables;
+    return tables;
+}
+
+// Weights of a filter halving an image. Destination texel x is centred
+// between source texels 2x and 2x + 1 and weighs source texels
+// 2x + first to 2x + first + taps - 1.
+struct HalvingFilter
+{
+    int   first;
+    int   taps;
+    float weights[6];
+};
+
+// Zeroth order modified Bessel function of the first kind
+static double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        double factor = x / (2.0 * k);
+        term *= factor * factor;
+        sum  += term;
+    }
+    return sum;
+}
+
+static HalvingFilter halvingFilter(MipFilter type)
+{
+    HalvingFilter filter;
+    if (type == MipFilter::Box)
+    {
+        filter.first = 0;
+        filter.taps  = 2;
+        filter.weights[0] = filter.weights[1] = 0.5f;
+        return filter;
+    }
+
+    // Sinc windowed by a Kaiser window of radius 1.5 destination texels,
+    // sampled at the source texel centres 0.25, 0.75 and 1.25 either side
+    const double pi = 3.14159265358979323846;
+    const double radius = 1.5, alpha = 4.0;
+    filter.first = -2;
+    filter.taps  = 6;
+    double sum = 0.0, weights[6];
+    for (int k = 0; k < 6; k++)
+    {
+        double t = (k - 2.5) / 2.0;
+        double sinc = sin(pi * t) / (pi * t);
+        double window = t / radius;
+        weights[k] = sinc * besselI0(alpha * sqrt(1.0 - window * window)) / besselI0(alpha);
+        sum += weights[k];
+    }
+    for (int k = 0; k < 6; k++)
+        filter.weights[k] = static_cast<float>(weights[k] / sum);
+    return filter;
+}
+
+// Four channels of a texel
+#ifdef MIPMAP_SSE2
+typedef __m128 Texel;
+
+static inline Texel loadTexel(const float *p)                    { return _mm_loadu_ps(p); }
+static inline void  storeTexel(float *p, Texel t)                { _mm_storeu_ps(p, t); }
+static inline Texel zeroTexel()                                  { return _mm_setzero_ps(); }
+static inline Texel multiplyAdd(Texel sum, Texel t, float w)     { return _mm_add_ps(sum, _mm_mul_ps(t, _mm_set1_ps(w))); }
+static inline Texel saturate(Texel t)                            { return _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f)); }
+#else
+struct Texel { float v[4]; };
+
+static inline Texel loadTexel(const float *p)                    { Texel t; memcpy(t.v, p, sizeof(t.v)); return t; }
+static inline void  storeTexel(float *p, Texel t)                { memcpy(p, t.v, sizeof(t.v)); }
+static inline Texel zeroTexel()                                  { Texel t = { { 0.0f, 0.0f, 0.0f, 0.0f } }; return t; }
+static inline Texel multiplyAdd(Texel sum, Texel t, float w)
+{
+    for (int c = 0; c < 4; c++)
+        sum.v[c] += t.v[c] * w;
+    return sum;
+}
+static inline Texel saturate(Texel t)
+{
+    for (int c = 0; c < 4; c++)
+        t.v[c] = t.v[c] < 0.0f ? 0.0f : (t.v[c] > 1.0f ? 1.0f : t.v[c]);
+    return t;
+}
+#endif
+
+// Index of a texel outside the image, wrapped or clamped
+static inline int edgeIndex(int i, int size, bool repeat)
+{
+    if (repeat)
+        return ((i % size) + size) % size;
+    return i < 0 ? 0 : (i >= size ? size - 1 : i);
+}
+
+// How the channels of an image map to and from linear floats
+struct ChannelCodec
+{
+    int  channels;
+    int  colourChannels;        // channels stored sRGB encoded, alpha never is
+    bool normalMap;
+    float linear[256];
+    const float *decode[4];     // byte to float table of each channel
+
+    ChannelCodec(int channels, const MipSettings &settings) : channels(channels)
+    {
+        colourChannels = settings.gammaCorrect ? (channels >= 3 ? 3 : 1) : 0;
+        normalMap      = settings.normalMap && channels >= 3;
+        for (int i = 0; i < 256; i++)
+            linear[i] = i / 255.0f;
+        for (int c = 0; c < 4; c++)
+            decode[c] = c < colourChannels ? srgbTables().decode : linear;
+    }
+
+    // Expand a row of bytes to four floats per texel
+    void decodeRow(const uint8_t *in, float *out, int width) const
+    {
+        switch (channels)
+        {
+            case 1:  decodeTexels<1>(in, out, width); break;
+            case 2:  decodeTexels<2>(in, out, width); break;
+            case 3:  decodeTexels<3>(in, out, width); break;
+            default: decodeTexels<4>(in, out, width); break;
+        }
+    }
+
+    template <int N>
+    void decodeTexels(const uint8_t *in, float *out, int width) const
+    {
+        for (int x = 0; x < width; x++, in += N, out += 4)
+            for (int c = 0; c < 4; c++)
+                out[c] = c < N ? decode[c][in[c]] : 0.0f;
+    }
+
+    // Pack a row of floats in [0, 1] back into bytes
+    void encodeRow(const float *in, uint8_t *out, int width) const
+    {
+        switch (channels)
+        {
+            case 1:  encodeTexels<1>(in, out, width); break;
+            case 2:  encodeTexels<2>(in, out, width); break;
+            case 3:  encodeTexels<3>(in, out, width); break;
+            default: encodeTexels<4>(in, out, width); break;
+        }
+    }
+
+    template <int N>
+    void encodeTexels(const float *in, uint8_t *out, int width) const
+    {
+        const SrgbTables &srgb = srgbTables();
+        for (int x = 0; x < width; x++, in += 4, out += N)
+            for (int c = 0; c < N; c++)
+                out[c] = c < colourChannels ? srgb.encode(in[c])
+                                            : static_cast<uint8_t>(in[c] * 255.0f + 0.5f);
+    }
+
+    // Scale the xyz of a filtered normal back to unit length
+    void renormalise(float *texel) const
+    {
+        if (!normalMap)
+            return;
+        float n[3], length = 0.0f;
+        for (int c = 0; c < 3; c++)
+        {
+            n[c] = 2.0f * texel[c] - 1.0f;
+            length += n[c] * n[c];
+        }
+        if (length <= 0.0f)
+            return;
+        float scale = 0.5f / sqrtf(length);
+        for (int c = 0; c < 3; c++)
+            texel[c] = n[c] * scale + 0.5f;
+    }
+};
+
+// Halve a level. Bands of rows run on the thread pool; each band expands
+// the source rows it reads to linear floats, then filters every row down the
+// columns and along the row before packing it back into bytes.
+static void halveLevel(const std::vector<uint8_t> &source, int width, int height,
+                       std::vector<uint8_t> &destination, const HalvingFilter &filter,
+                       const ChannelCodec &codec, bool repeat)
+{
+    int halfWidth  = width  > 1 ? width  / 2 : 1;
+    int halfHeight = height > 1 ? height / 2 : 1;
+    destination.resize(static_cast<size_t>(halfWidth) * halfHeight * codec.channels);
+
+    // Source columns of every destination texel, wrapped at the edges
+    std::vector<int> columns(static_cast<size_t>(halfWidth) * filter.taps);
+    for (int x = 0; x < halfWidth; x++)
+        for (int k = 0; k < filter.taps; k++)
+            columns[x * filter.taps + k] = edgeIndex(2 * x + filter.first + k, width, repeat);
+
+    const int bandRows = 8;
+    size_t bands = static_cast<size_t>((halfHeight + bandRows - 1) / bandRows);
+    const uint8_t *src = source.data();
+    uint8_t *dst = destination.data();
+    ThreadPool::global().parallelFor(bands, [&](size_t band)
+    {
+        int firstRow = static_cast<int>(band) * bandRows;
+        int lastRow  = firstRow + bandRows < halfHeight ? firstRow + bandRows : halfHeight;
+
+        // Source rows read by the band, the filter's taps either side included
+        int top = 2 * firstRow + filter.first;
+        int sourceRows = 2 * (lastRow - firstRow - 1) + filter.taps;
+        std::vector<float> rows(static_cast<size_t>(sourceRows) * width * 4);
+        for (int r = 0; r < sourceRows; r++)
+            codec.decodeRow(src + static_cast<size_t>(edgeIndex(top + r, height, repeat)) * width * codec.channels,
+                            &rows[static_cast<size_t>(r) * width * 4], width);
+
+        std::vector<float> filtered(static_cast<size_t>(width) * 4), row(static_cast<size_t>(halfWidth) * 4);
+        for (int y = firstRow; y < lastRow; y++)
+        {
+            // Down the columns
+            const float *taps[6];
+            for (int k = 0; k < filter.taps; k++)
+                taps[k] = &rows[static_cast<size_t>(2 * (y - firstRow) + k) * width * 4];
+            for (int x = 0; x < width; x++)
+            {
+                Texel sum = zeroTexel();
+                for (int k = 0; k < filter.taps; k++)
+                    sum = multiplyAdd(sum, loadTexel(taps[k] + 4 * x), filter.weights[k]);
+                storeTexel(&filtered[4 * x], sum);
+            }
+
+            // Along the row
+            for (int x = 0; x < halfWidth; x++)
+            {
+                const int *index = &columns[x * filter.taps];
+                Texel sum = zeroTexel();
+                for (int k = 0; k < filter.taps; k++)
+                    sum = multiplyAdd(sum, loadTexel(&filtered[4 * index[k]]), filter.weights[k]);
+
+                // The negative lobes of the Kaiser filter can overshoot
+                storeTexel(&row[4 * x], saturate(sum));
+                codec.renormalise(&row[4 * x]);
+            }
+            codec.encodeRow(row.data(), dst + static_cast<size_t>(y) * halfWidth * codec.channels, halfWidth);
+        }
+    });
+}
+
+MipChain generateMips(const uint8_t *pixels, int width, int height, int channels,
+                      const MipSettings &settings)
+{
+    MipChain chain;
+    if (!pixels || width <= 0 || height <= 0 || channels < 1 || channels > 4)
+        return chain;
+
+    chain.width    = width;
+    chain.height   = height;
+    chain.channels = channels;
+    chain.settings = settings;
+    chain.levels.resize(mipLevelCount(width, height));
+    chain.levels[0].assign(pixels, pixels + static_cast<size_t>(width) * height * channels);
+    if (chain.levels.size() == 1)
+        return chain;
+
+    // Each level is filtered from the one above, so only the rows of a
+    // level run in parallel
+    ChannelCodec codec(channels, settings);
+    HalvingFilter filter = halvingFilter(settings.filter);
+    for (size_t level = 1; level < chain.levels.size(); level++)
+        halveLevel(chain.levels[level - 1], chain.levelWidth(level - 1), chain.levelHeight(level - 1),
+                   chain.levels[level], filter, codec, settings.repeat);
+    return chain;
+}
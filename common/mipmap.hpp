@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+// Filter each mipmap level is downsampled from the level above with
+enum class MipFilter
+{
+    Box,        // average of 2x2 texels
+    Kaiser      // Kaiser windowed sinc over 6x6 texels, sharper than the box
+};
+
+// How a mipmap chain is built
+struct MipSettings
+{
+    MipFilter filter  = MipFilter::Kaiser;
+    bool gammaCorrect = true;   // filter colour in linear light, for sRGB colour maps
+    bool normalMap    = false;  // renormalise the xyz of every level
+    bool repeat       = true;   // filters wrap around the edges rather than clamp
+
+    bool operator==(const MipSettings &other) const
+    {
+        return filter == other.filter && gammaCorrect == other.gammaCorrect &&
+               normalMap == other.normalMap && repeat == other.repeat;
+    }
+};
+
+// Settings for a texture type: only diffuse maps are gamma correct, and
+// normal maps are renormalised
+MipSettings mipSettingsForType(const std::string &type);
+
+// Short description of the settings, e.g. "kaiser srgb repeat"
+std::string mipSettingsName(const MipSettings &settings);
+
+// 8-bit image with its full mipmap chain, level 0 first, rows tightly packed
+struct MipChain
+{
+    int width    = 0;
+    int height   = 0;
+    int channels = 0;
+    MipSettings settings;
+    std::vector<std::vector<uint8_t>> levels;
+
+    // Width and height of a mipmap level
+    int levelWidth(size_t level) const;
+    int levelHeight(size_t level) const;
+
+    // Total size of the levels in bytes
+    size_t bytes() const;
+};
+
+// Number of levels of a full chain down to 1x1
+int mipLevelCount(int width, int height);
+
+// Build the mipmap chain of an image with 1 to 4 channels. Each level is
+// filtered from the one above in floating point, four channels at a time
+// with SSE, with bands of rows split across the global thread pool, and
+// stored as bytes before the next level is filtered from it.
+MipChain generateMips(const uint8_t *pixels, int width, int height, int channels,
+                      const MipSettings &settings = MipSettings());
@@ -1,113 +1,343 @@
 #include <vector>
+#include <memory>
+#include <utility>
 #include <stdio.h>
 #include <string>
 #include <cstring>
+#include <cstddef>
+#include <cfloat>
 #include <iostream>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
 #include "model.hpp"
-#include "stb_image.hpp"
+#include "camera.hpp"
+#include "objloader.hpp"
+#include "meshoptimizer.hpp"
+#include "tangents.hpp"
+#include "compressedtexture.hpp"
+#include "textureuploader.hpp"
 
-Model::Model(const char *path)
+// Free a vector's memory, clear() keeps its capacity
+template <typename T>
+static void freeVector(std::vector<T> &v)
 {
+    std::vector<T>().swap(v);
+}
+
+Model::Model(const char *path, const ModelSettings &settings)
+{
+    this->settings = settings;
+    if (loadMesh(path))
+        upload();
+}
+
+Model::Model(const ModelSettings &settings)
+{
+    this->settings = settings;
+}
+
+Model::Model(Model &&other)
+{
+    *this = static_cast<Model &&>(other);
+}
+
+Model &Model::operator=(Model &&other)
+{
+    if (this != &other)
+    {
+        vertices       = std::move(other.vertices);
+        uvs            = std::move(other.uvs);
+        normals        = std::move(other.normals);
+        tangents       = std::move(other.tangents);
+        bitangents     = std::move(other.bitangents);
+        indices        = std::move(other.indices);
+        lods           = std::move(other.lods);
+        textures       = std::move(other.textures);
+        bounds         = other.bounds;
+        uvDensity      = other.uvDensity;
+        textureID      = other.textureID;
+        ka             = other.ka;
+        kd             = other.kd;
+        ks             = other.ks;
+        Ns             = other.Ns;
+        placeholder    = other.placeholder;
+        settings       = other.settings;
+        ready          = other.ready;
+        VAO            = std::move(other.VAO);
+        vertexBuffer   = std::move(other.vertexBuffer);
+        indexBuffer    = std::move(other.indexBuffer);
+        indexType      = other.indexType;
+        textureHandles = std::move(other.textureHandles);
+        gpuBufferBytes = other.gpuBufferBytes;
+        cache          = std::move(other.cache);
+        vertexData     = std::move(other.vertexData);
+        indexData      = std::move(other.indexData);
+
+        // The buffers went with the move, so the old model can't be drawn
+        other.ready          = false;
+        other.gpuBufferBytes = 0;
+    }
+    return *this;
+}
+
+// Widen an index buffer of 16 or 32-bit indices
+static void unpackIndices(const MeshBuffers &buffers, std::vector<unsigned int> &outIndices)
+{
+    size_t numIndices = buffers.indexBytes / buffers.indexSize;
+    if (buffers.indexSize == sizeof(unsigned int))
+    {
+        const unsigned int *indices = static_cast<const unsigned int *>(buffers.indices);
+        outIndices.assign(indices, indices + numIndices);
+        return;
+    }
+    const unsigned short *indices = static_cast<const unsigned short *>(buffers.indices);
+    outIndices.assign(indices, indices + numIndices);
+}
+
+bool Model::loadMesh(const char *path)
+{
+    // Use the binary mesh cache if it is up to date
+    std::unique_ptr<MeshCache> cached(new MeshCache());
+    if (cached->open(path, cacheFlags(), settings.lodMaxError))
+    {
+        printf("Loading cached mesh %s\n", MeshCache::cachePath(path, cacheFlags(), settings.lodMaxError).c_str());
+        
+        // The buffers are uploaded straight from the mapping, so only the
+        // arrays the residency policy keeps are copied out of it
+        const MeshCacheHeader &header = *cached->header;
+        const MeshStreams &mesh = cached->streams;
+        bounds.min    = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        bounds.max    = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        bounds.centre = 0.5f * (bounds.min + bounds.max);
+        bounds.radius = header.boundsRadius;
+        uvDensity     = header.uvDensity;
+        lods.assign(mesh.lods, mesh.lods + mesh.numLods);
+        if (settings.residency != Residency::Drop)
+        {
+            vertices.assign(mesh.positions, mesh.positions + mesh.numVertices);
+            unpackIndices(cached->buffers, indices);
+        }
+        if (settings.residency == Residency::Keep)
+        {
+            uvs.assign(mesh.uvs, mesh.uvs + mesh.numVertices);
+            normals.assign(mesh.normals, mesh.normals + mesh.numVertices);
+            tangents.assign(mesh.tangents, mesh.tangents + mesh.numVertices);
+            bitangents.assign(mesh.bitangents, mesh.bitangents + mesh.numVertices);
+        }
+        cache = std::move(cached);
+        return true;
+    }
+    
     // Load object
-    bool res = loadObj(path, vertices, uvs, normals);
+    if (!loadObj(path, vertices, uvs, normals, indices))
+        return false;
 
     // Calculate tangent and bitangent vectors
     calculateTangents();
     
-    // Setup buffers
-    setupBuffers();
+    // Optimise the triangle and vertex order
+    if (settings.optimize)
+        optimize();
+    
+    // Build the levels of detail
+    calculateBounds();
+    lods = buildLods(indices, vertices.data(), normals.data(), vertices.size(), settings.lodLevels,
+                     settings.lodMaxError * 2.0f * bounds.radius, settings.optimize);
+    
+    // Build the buffers to upload and cache them for next time
+    interleaveVertices(settings.format, streams(), vertexData);
+    packIndices(indices.data(), indices.size(), vertices.size(), indexData);
+    if (!MeshCache::write(path, streams(), builtBuffers(), bounds, uvDensity, cacheFlags(),
+                          settings.lodMaxError))
+        printf("Couldn't write mesh cache %s\n", MeshCache::cachePath(path, cacheFlags(), settings.lodMaxError).c_str());
+    
+    return true;
 }
 
-void Model::draw(unsigned int &shaderID)
+void Model::upload()
 {
-    // Send material properties to the shader
-    glUniform1f(glGetUniformLocation(shaderID, "ka"), ka);
-    glUniform1f(glGetUniformLocation(shaderID, "kd"), kd);
-    glUniform1f(glGetUniformLocation(shaderID, "ks"), ks);
-    glUniform1f(glGetUniformLocation(shaderID, "Ns"), Ns);
+    // Upload from the mesh cache's mapping or the buffers loadMesh built,
+    // neither of which is needed afterwards
+    setupBuffers(cache ? cache->buffers : builtBuffers());
+    cache.reset();
+    freeVector(vertexData);
+    freeVector(indexData);
+    ready = true;
+    applyResidency();
+}
+
+MeshBuffers Model::builtBuffers() const
+{
+    MeshBuffers buffers;
+    buffers.vertices    = vertexData.data();
+    buffers.vertexBytes = vertexData.size();
+    buffers.indices     = indexData.data();
+    buffers.indexBytes  = indexData.size();
+    buffers.indexSize   = indexSize(vertices.size());
+    return buffers;
+}
+
+void Model::applyResidency()
+{
+    if (settings.residency == Residency::Keep)
+        return;
+    
+    freeVector(uvs);
+    freeVector(normals);
+    freeVector(tangents);
+    freeVector(bitangents);
+    if (settings.residency == Residency::Drop)
+    {
+        freeVector(vertices);
+        freeVector(indices);
+    }
+}
+
+ModelMemory Model::memoryUsage() const
+{
+    ModelMemory memory;
+    memory.cpuBytes = vertices.capacity() * sizeof(glm::vec3) +
+                      uvs.capacity() * sizeof(glm::vec2) +
+                      normals.capacity() * sizeof(glm::vec3) +
+                      tangents.capacity() * sizeof(glm::vec3) +
+                      bitangents.capacity() * sizeof(glm::vec3) +
+                      indices.capacity() * sizeof(unsigned int) +
+                      lods.capacity() * sizeof(MeshLod) +
+                      vertexData.capacity() + indexData.capacity();
+    memory.gpuBytes = gpuBufferBytes;
+    for (size_t i = 0; i < textureHandles.size(); i++)
+        if (textureHandles[i])
+            memory.gpuBytes += textureHandles[i]->bytes;
+    return memory;
+}
+
+void Model::draw(unsigned int shaderID, unsigned int lod) const
+{
+    // Stand in for a model that is still loading with the placeholder's
+    // mesh and this model's material. Its textures are the loader's
+    // placeholders until they load, so nothing bound for the previous
+    // object is sampled.
+    if (!ready)
+    {
+        if (placeholder && placeholder->ready)
+        {
+            bindMaterial(shaderID);
+            placeholder->drawMesh(0);
+        }
+        return;
+    }
+    
+    bindMaterial(shaderID);
+    drawMesh(lod);
+}
+
+void Model::bindMaterial(unsigned int shaderID) const
+{
+    // Send material properties to the shader, skipping the ones it has
+    static const Uniform kaUniform("ka"), kdUniform("kd"), ksUniform("ks"), NsUniform("Ns");
+    ShaderProgram &program = ShaderProgram::get(shaderID);
+    program.set(kaUniform, ka);
+    program.set(kdUniform, kd);
+    program.set(ksUniform, ks);
+    program.set(NsUniform, Ns);
     
     // Bind the textures
     unsigned int diffuseNum = 0;
     unsigned int normalNum = 0;
     for (unsigned int i = 0; i < textures.size(); i++)
     {
-        // Bind texture
-        std::string name = textures[i].type;
+        // Bind texture, shared textures by their current name as streaming
+        // may replace it
         glActiveTexture(GL_TEXTURE0 + i);
-        glUniform1i(glGetUniformLocation(shaderID, (name + "Map").c_str()), i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        program.set(textures[i].samplerUniform, static_cast<int>(i));
+        if (textures[i].layer >= 0)
+        {
+            // Texture arrays also need the layer and where the texture is in it
+            glBindTexture(GL_TEXTURE_2D_ARRAY, textures[i].id);
+            program.set(textures[i].layerUniform, textures[i].layer);
+            program.set(textures[i].rectUniform, textures[i].rect);
+        }
+        else
+            glBindTexture(GL_TEXTURE_2D, textureHandles[i] ? textureHandles[i]->texture.get() : textures[i].id);
     }
-    
-    // Draw the triangles
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, static_cast<unsigned int>(vertices.size()));
+}
+
+void Model::drawMesh(unsigned int lod) const
+{
+    // Draw the triangles of the level of detail
+    if (lod >= lods.size())
+        lod = static_cast<unsigned int>(lods.size()) - 1;
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    glBindVertexArray(VAO.get());
+    glDrawElements(GL_TRIANGLES, lods[lod].count, indexType, (void*)(lods[lod].offset * indexSize));
     glBindVertexArray(0);
 }
 
-void Model::setupBuffers()
+MeshStreams Model::streams() const
+{
+    MeshStreams mesh;
+    mesh.numVertices = vertices.size();
+    mesh.numIndices  = indices.size();
+    mesh.positions   = vertices.data();
+    mesh.uvs         = uvs.data();
+    mesh.normals     = normals.data();
+    mesh.tangents    = tangents.data();
+    mesh.bitangents  = bitangents.data();
+    mesh.indices     = indices.data();
+    mesh.numLods     = lods.size();
+    mesh.lods        = lods.data();
+    return mesh;
+}
+
+void Model::setupBuffers(const MeshBuffers &buffers)
 {
     // Create and bind the Vertex Array Object (VAO)
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-    
-    // Create Vertex Buffer Object
-    unsigned int vertexBuffer;
-    glGenBuffers(1, &vertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-    
-    // Create uv buffer
-    unsigned int uvBuffer;
-    glGenBuffers(1, &uvBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, uvBuffer);
-    glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
+    VAO = GLVertexArray::create();
+    glBindVertexArray(VAO.get());
     
-    // Create normal buffer
-    unsigned int normalBuffer;
-    glGenBuffers(1, &normalBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
+    // Create a single interleaved vertex buffer
+    vertexBuffer = GLBuffer::create();
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.get());
+    glBufferData(GL_ARRAY_BUFFER, buffers.vertexBytes, buffers.vertices, GL_STATIC_DRAW);
+    gpuBufferBytes = buffers.vertexBytes;
     
-    // Bind the vertex buffer
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    
-    // Bind the uv buffer
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, uvBuffer);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    if (settings.format == VertexFormat::Compact)
+    {
+        // Position, half float uv, octahedral normal and tangent with sign
+        GLsizei stride = sizeof(CompactVertex);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactVertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactVertex, uv));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(CompactVertex, normal));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_BYTE, GL_TRUE, stride, (void*)offsetof(CompactVertex, tangent));
+    }
+    else
+    {
+        // Position, uv, normal, tangent and bitangent as floats
+        GLsizei stride = sizeof(StandardVertex);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(StandardVertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(StandardVertex, uv));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(StandardVertex, normal));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(StandardVertex, tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(StandardVertex, bitangent));
+    }
     
-    // Bind the normal buffer
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-    // Create tangent buffer
-    GLuint tangentBuffer;
-    glGenBuffers(1, &tangentBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, tangentBuffer);
-    glBufferData(GL_ARRAY_BUFFER, tangents.size() * sizeof(glm::vec3), &tangents[0], GL_STATIC_DRAW);
-
-    // Create bitangent buffer
-    GLuint bitangentBuffer;
-    glGenBuffers(1, &bitangentBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, bitangentBuffer);
-    glBufferData(GL_ARRAY_BUFFER, bitangents.size() * sizeof(glm::vec3), &bitangents[0], GL_STATIC_DRAW);
-
-    // Bind the tangent buffer
-    glEnableVertexAttribArray(3);
-    glBindBuffer(GL_ARRAY_BUFFER, tangentBuffer);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-    // Bind the bitangent buffer
-    glEnableVertexAttribArray(4);
-    glBindBuffer(GL_ARRAY_BUFFER, bitangentBuffer);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    // Create the index buffer, of 16-bit indices when they are big enough
+    indexBuffer = GLBuffer::create();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.get());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBytes, buffers.indices, GL_STATIC_DRAW);
+    gpuBufferBytes += buffers.indexBytes;
+    indexType = buffers.indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
     
      // Unbind the VAO
     glBindVertexArray(0);
@@ -115,193 +345,172 @@ void Model::setupBuffers()
 
 void Model::deleteBuffers()
 {
-    glDeleteBuffers(1, &vertexBuffer);
-    glDeleteBuffers(1, &uvBuffer);
-    glDeleteBuffers(1, &normalBuffer);
-    glDeleteVertexArrays(1, &VAO);
+    vertexBuffer.reset();
+    indexBuffer.reset();
+    VAO.reset();
+    for (size_t i = 0; i < textureHandles.size(); i++)
+        textureHandles[i].reset();
+    gpuBufferBytes = 0;
+    ready = false;
 }
 
 bool Model::loadObj(const char *path,
                     std::vector<glm::vec3> &outVertices,
                     std::vector<glm::vec2> &outUVs,
-                    std::vector<glm::vec3> &outNormals)
+                    std::vector<glm::vec3> &outNormals,
+                    std::vector<unsigned int> &outIndices)
 {
     
     printf("Loading file %s\n", path);
     
-    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-    std::vector<glm::vec3> tempVertices;
-    std::vector<glm::vec2> tempUVs;
-    std::vector<glm::vec3> tempNormals;
-    
-    FILE *file = fopen(path, "r");
-    if (file==NULL)
-    {
-        printf("Impossible to open the file. Check paths and directories.");
-        getchar();
+    // Parse the .obj file using all cores
+    ObjData obj;
+    if (!parseObj(path, obj, 0))
         return false;
-    }
     
-    while (true)
-    {
-        // Read the first word of the line
-        char lineHeader[128];
-        int res = fscanf(file, "%s", lineHeader);
-        if (res == EOF)
-        {
-            // If end of file reached exit the loop
-            break;
-        }
-        
-        if (strcmp(lineHeader, "v") == 0)
-        {
-            // Read vertices
-            glm::vec3 vertex;
-            fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
-            tempVertices.push_back(vertex);
-        }
-        else if (strcmp(lineHeader, "vt") == 0)
-        {
-            // Read texture co-ordinates
-            glm::vec2 uv;
-            fscanf(file, "%f %f\n", &uv.x, &uv.y);
-            tempUVs.push_back(uv);
-        }
-        else if (strcmp(lineHeader, "vn") == 0)
-        {
-            // Read vertex normals
-            glm::vec3 normal;
-            fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-            tempNormals.push_back(normal);
-        }
-        else if (strcmp(lineHeader, "f") == 0)
-        {
-            // Read vertex indices
-            std::string vertex1, vertex2, vertex3;
-            unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-            int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n",
-                                 &vertexIndex[0], &uvIndex[0], &normalIndex[0],
-                                 &vertexIndex[1], &uvIndex[1], &normalIndex[1],
-                                 &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
-            
-            // Check for error
-            if (matches != 9)
-            {
-                printf("File can't be read by loadObj().\n");
-                fclose(file);
-                return false;
-            }
-            vertexIndices.push_back(vertexIndex[0]);
-            vertexIndices.push_back(vertexIndex[1]);
-            vertexIndices.push_back(vertexIndex[2]);
-            uvIndices    .push_back(uvIndex[0]);
-            uvIndices    .push_back(uvIndex[1]);
-            uvIndices    .push_back(uvIndex[2]);
-            normalIndices.push_back(normalIndex[0]);
-            normalIndices.push_back(normalIndex[1]);
-            normalIndices.push_back(normalIndex[2]);
-        }
-        else
-        {
-            // Remove comment line
-            char commentBuffer[1000];
-            fgets(commentBuffer, 1000, file);
-        }
-    }
+    // Weld identical vertices and build the index buffer
+    indexObj(obj, outVertices, outUVs, outNormals, outIndices);
+    
+    return true;
+}
+
+uint32_t Model::cacheFlags() const
+{
+    uint32_t flags = settings.lodLevels << MeshCache::lodShift;
+    if (settings.optimize)
+        flags |= MeshCache::optimized;
+    if (settings.format == VertexFormat::Compact)
+        flags |= MeshCache::compact;
+    return flags;
+}
+
+void Model::calculateBounds()
+{
+    bounds = computeBounds(vertices.data(), vertices.size());
     
-    // For each vertex of the triangle
-    for (unsigned int i = 0; i < vertexIndices.size(); i++)
+    // Texture density of the full detail level
+    uvDensity = 0.0f;
+    if (uvs.size() == vertices.size())
     {
-        // Get the indices of its attributes
-        unsigned int vertexIndex = vertexIndices[i];
-        unsigned int uvIndex = uvIndices[i];
-        unsigned int normalIndex = normalIndices[i];
-        
-        // Get the attributes
-        glm::vec3 vertex = tempVertices[vertexIndex - 1];
-        glm::vec2 uv = tempUVs[uvIndex - 1];
-        glm::vec3 normal = tempNormals[normalIndex - 1];
-        
-        // Copy the attributes to the buffers
-        outVertices.push_back(vertex);
-        outUVs.push_back(uv);
-        outNormals.push_back(normal);
+        size_t count = lods.empty() ? indices.size() : lods[0].count;
+        size_t first = lods.empty() ? 0 : lods[0].offset;
+        uvDensity = ::uvDensity(vertices.data(), uvs.data(), indices.data() + first, count);
     }
-    
-    // Close .obj file
-    fclose(file);
-    
-    return true;
+}
+
+unsigned int Model::selectLod(const Camera &camera, const glm::mat4 &model,
+                              float pixelError, float viewportHeight) const
+{
+    float pixelScale = lodPixelScale(camera.projection(), camera.view() * model, bounds.centre,
+                                     bounds.radius, viewportHeight);
+    return static_cast<unsigned int>(::selectLod(lods, pixelScale, pixelError));
+}
+
+void Model::requestTextures(TextureUploader &uploader, const Camera &camera, const glm::mat4 &model,
+                            float viewportHeight) const
+{
+    // Pixels covered by a whole texture, the wrapped copies being as large
+    if (uvDensity <= 0.0f)
+        return;
+    float pixelScale = lodPixelScale(camera.projection(), camera.view() * model, bounds.centre,
+                                     bounds.radius, viewportHeight);
+    float screenSize = pixelScale < FLT_MAX ? pixelScale / uvDensity : FLT_MAX;
+    for (size_t i = 0; i < textureHandles.size(); i++)
+        if (textureHandles[i])
+            uploader.request(textureHandles[i], screenSize);
+}
+
+void Model::optimize()
+{
+    // Triangle order for the post-transform cache, then clusters of it for
+    // overdraw, then vertex order for fetch locality
+    optimizeVertexCache(indices, vertices.size());
+    optimizeOverdraw(indices, vertices.data(), vertices.size());
+    std::vector<unsigned int> remap = optimizeVertexFetch(indices, vertices.size());
+    remapVertices(vertices, remap);
+    remapVertices(uvs, remap);
+    remapVertices(normals, remap);
+    remapVertices(tangents, remap);
+    remapVertices(bitangents, remap);
 }
 
 void Model::addTexture(const char *path, const std::string type)
+{
+    setTexture(addTexture(0u, type), TextureCache::global().load(path, textureCompression(type),
+                                                                 TextureSampling(), mipSettings(type)));
+}
+
+void Model::addMaterial(const char *diffusePath, const char *specularPath, const char *normalPath)
+{
+    MaterialTexture diffuse;
+    diffuse.path = diffusePath;
+    diffuse.specularPath = specularPath;
+    setTexture(addTexture(0u, "diffuse"), TextureCache::global().load(diffuse, materialCompression("diffuse"),
+                                                                      TextureSampling(), mipSettings("diffuse")));
+
+    MaterialTexture normal;
+    normal.path = normalPath;
+    normal.normalMap = true;
+    setTexture(addTexture(0u, "normal"), TextureCache::global().load(normal, materialCompression("normal"),
+                                                                     TextureSampling(), mipSettings("normal")));
+}
+
+size_t Model::addTexture(unsigned int id, const std::string type)
 {
     Texture texture;
-    texture.id = loadTexture(path);
+    texture.id = id;
     texture.type = type;
+    texture.uniform = type + "Map";
+    texture.samplerUniform = Uniform(texture.uniform);
+    texture.layerUniform   = Uniform(type + "Layer");
+    texture.rectUniform    = Uniform(type + "Rect");
     textures.push_back(texture);
+    textureHandles.push_back(TextureHandle());
+    return textures.size() - 1;
 }
 
-unsigned int Model::loadTexture(const char *path)
+void Model::setTexture(size_t slot, TextureHandle texture)
 {
+    textures[slot].id = texture->texture.get();
+    textures[slot].layer = -1;
+    textureHandles[slot] = texture;
+}
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+void Model::setTexture(size_t slot, const PackedTexture &texture)
+{
+    textures[slot].id    = texture.array->texture.get();
+    textures[slot].layer = texture.layer;
+    textures[slot].rect  = texture.rect;
+    textureHandles[slot] = texture.array;
+}
 
-    int width, height, numComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &numComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (numComponents == 1)
-            format = GL_RED;
-        else if (numComponents == 3)
-            format = GL_RGB;
-        else if (numComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture " << path << " failed to load." << std::endl;
-        stbi_image_free(data);
-    }
+TextureCompression Model::textureCompression(const std::string &type) const
+{
+    if (!settings.compressTextures)
+        return TextureCompression::None;
+    TextureCompression compression = compressionForType(type);
+    return compressionSupported(compression) ? compression : TextureCompression::None;
+}
+
+TextureCompression Model::materialCompression(const std::string &type) const
+{
+    TextureCompression compression = textureCompression(type);
+    if (type != "diffuse" || compression == TextureCompression::None)
+        return compression;
+    return compressionSupported(TextureCompression::BC3) ? TextureCompression::BC3 : TextureCompression::None;
+}
 
-    return textureID;
+MipSettings Model::mipSettings(const std::string &type) const
+{
+    MipSettings mips = mipSettingsForType(type);
+    mips.filter = settings.mipFilter;
+    return mips;
 }
 
 void Model::calculateTangents()
 {
-    for (unsigned int i = 0; i < vertices.size(); i += 3)
-    {
-        // Calculate edge vectors and deltas
-        glm::vec3 E1 = vertices[i + 1] - vertices[i];
-        glm::vec3 E2 = vertices[i + 2] - vertices[i + 1];
-        float deltaU1 = uvs[i + 1].x - uvs[i].x;
-        float deltaV1 = uvs[i + 1].y - uvs[i].y;
-        float deltaU2 = uvs[i + 2].x - uvs[i + 1].x;
-        float deltaV2 = uvs[i + 2].y - uvs[i + 1].y;
-
-        // Calculate tangents
-        float denom = 1.0f / (deltaU1 * deltaV2 - deltaU2 * deltaV1);
-        glm::vec3 tangent = (deltaV2 * E1 - deltaV1 * E2) * denom;
-        glm::vec3 bitangent = (deltaU1 * E2 - deltaU2 * E1) * denom;
-
-        // Set the same tangents for the three vertices of the triangle
-        tangents.push_back(tangent);
-        tangents.push_back(tangent);
-        tangents.push_back(tangent);
-        bitangents.push_back(bitangent);
-        bitangents.push_back(bitangent);
-        bitangents.push_back(bitangent);
-    }
-}
\ No newline at end of file
+    tangents.resize(vertices.size());
+    bitangents.resize(vertices.size());
+    generateTangents(vertices.data(), uvs.data(), normals.data(), vertices.size(),
+                     indices.data(), indices.size(), tangents.data(), bitangents.data());
+}
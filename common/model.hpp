@@ -1,17 +1,80 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 #include <stdio.h>
 #include <string>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "meshcache.hpp"
+#include "vertexformat.hpp"
+#include "glhandle.hpp"
+#include "texturecache.hpp"
+#include "texturearray.hpp"
+#include "culling.hpp"
+#include "shaderprogram.hpp"
+
+class Camera;
+class TextureUploader;
+
+// What a model keeps in memory once its buffers are uploaded
+enum class Residency
+{
+    Keep,           // every attribute array and the indices
+    Drop,           // nothing, the model can only be drawn
+    Positions       // vertices and indices, for picking and bounds
+};
+
+// Memory used by a model in bytes
+struct ModelMemory
+{
+    size_t cpuBytes = 0;
+    size_t gpuBytes = 0;
+};
+
+// Options used when loading a model
+struct ModelSettings
+{
+    // Layout of the vertex buffer, Compact needs a vertex shader that decodes it
+    VertexFormat format = VertexFormat::Standard;
+    
+    // Reorder triangles and vertices for the vertex cache and overdraw
+    bool optimize = false;
+    
+    // Number of levels of detail to build by simplification, 1 for none
+    unsigned int lodLevels = 1;
+    
+    // Largest error of a level of detail as a fraction of the model's size
+    float lodMaxError = 0.05f;
+    
+    // Arrays kept in memory after upload
+    Residency residency = Residency::Keep;
+    
+    // Block compress textures by type (BC1 diffuse, BC4 specular, BC5 normal)
+    // and cache them as KTX2 files next to the images. Normal maps then only
+    // keep x and y, which the fragment shader must rebuild z from.
+    bool compressTextures = false;
+    
+    // Filter the texture mipmaps are built with on the CPU
+    MipFilter mipFilter = MipFilter::Kaiser;
+};
+
 // Texture struct
 struct Texture
 {
     unsigned int id;
     std::string type;
+    std::string uniform;    // sampler name, type + "Map"
+    
+    // Layer of a texture array and the part of it covered, sent to the
+    // shader as type + "Layer" and type + "Rect", or -1 for a 2D texture
+    int layer = -1;
+    glm::vec4 rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    
+    // The uniforms above, interned when the texture is added
+    Uniform samplerUniform, layerUniform, rectUniform;
 };
 
 class Model
@@ -23,44 +86,152 @@ public:
     std::vector<glm::vec3> normals;
     std::vector<glm::vec3> tangents;
     std::vector<glm::vec3> bitangents;
+    std::vector<unsigned int> indices;      // every level of detail, see lods
+    std::vector<MeshLod>   lods;
     std::vector<Texture>   textures;
+    Bounds bounds;                          // object space, set when the mesh is loaded
+    float uvDensity = 0.0f;                 // UV units per object space unit, set with the bounds
     unsigned int textureID;
-    float ka, kd, ks, Ns;
+    float ka = 0.2f, kd = 0.7f, ks = 1.0f, Ns = 20.0f;
+    
+    // Mesh drawn in place of the model until it is ready, with the model's
+    // own material and textures
+    Model *placeholder = NULL;
+    
+    // Constructor, loads and uploads the model straight away. A model whose
+    // file can't be loaded is left not ready.
+    Model(const char *path, const ModelSettings &settings = ModelSettings());
+    
+    // Constructor for an empty model, filled later by loadMesh and upload
+    Model(const ModelSettings &settings);
+    
+    // Models own their GL objects so can be moved but not copied. A model
+    // moved from is left not ready, with no buffers.
+    Model(Model &&other);
+    Model &operator=(Model &&other);
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+    
+    // Load the mesh into memory. Touches no GL state, so it can run on a
+    // worker thread.
+    bool loadMesh(const char *path);
     
-    // Constructor
-    Model(const char *path);
+    // Create the GL buffers, on the thread owning the GL context
+    void upload();
+    
+    // Whether the buffers have been uploaded
+    bool isReady() const { return ready; }
     
     // Draw model
-    void draw(unsigned int &shaderID);
+    void draw(unsigned int shaderID, unsigned int lod = 0) const;
+    
+    // Coarsest level of detail whose error is at most pixelError pixels on
+    // screen when drawn with this model matrix
+    unsigned int selectLod(const Camera &camera, const glm::mat4 &model,
+                           float pixelError = 1.0f, float viewportHeight = 768.0f) const;
+    
+    // Ask an uploader for the mipmap levels of the model's textures needed
+    // to draw it with this model matrix, from the on-screen size of its
+    // bounds and its texture coordinate density
+    void requestTextures(TextureUploader &uploader, const Camera &camera, const glm::mat4 &model,
+                         float viewportHeight = 768.0f) const;
     
-    // Add textures
+    // Add textures, shared with other models through the global texture cache
     void addTexture(const char *path, const std::string type);
     
+    // Add the textures of a material packed so the shader samples two: the
+    // diffuse map with the specular map in its alpha, and the x and y of the
+    // normal map. Shared with other models through the global texture cache.
+    void addMaterial(const char *diffusePath, const char *specularPath, const char *normalPath);
+    
+    // Bind a texture without taking ownership, returns its slot
+    size_t addTexture(unsigned int id, const std::string type);
+    
+    // Replace the texture in a slot, holding a reference to it
+    void setTexture(size_t slot, TextureHandle texture);
+    
+    // Replace the texture in a slot with a layer of a texture array, which
+    // the shader must sample as a sampler2DArray
+    void setTexture(size_t slot, const PackedTexture &texture);
+    
+    // Compression of textures of a type, None unless the settings ask for it
+    // and the GL context supports it
+    TextureCompression textureCompression(const std::string &type) const;
+    
+    // Compression of the textures of a packed material: BC3 for the diffuse
+    // map with specular in its alpha, otherwise as textureCompression()
+    TextureCompression materialCompression(const std::string &type) const;
+    
+    // How the mipmaps of uncompressed textures of a type are built
+    MipSettings mipSettings(const std::string &type) const;
+    
+    // Memory held by the model and its buffers and textures. Textures shared
+    // with other models count towards each of them.
+    ModelMemory memoryUsage() const;
+    
     // Cleanup
     void deleteBuffers();
     
 private:
     
+    // Load settings
+    ModelSettings settings;
+    
     // Array buffers
-    unsigned int VAO;
-    unsigned int vertexBuffer;
-    unsigned int uvBuffer;
-    unsigned int normalBuffer;
-    unsigned int tangentBuffer;
-    unsigned int bitangentBuffer;
+    bool ready = false;
+    GLVertexArray VAO;
+    GLBuffer vertexBuffer;
+    GLBuffer indexBuffer;
+    unsigned int indexType = 0;
+    
+    // References to the textures bound in the slots, empty for textures the
+    // model doesn't hold
+    std::vector<TextureHandle> textureHandles;
+    
+    // Size of the buffers in video memory
+    size_t gpuBufferBytes = 0;
+    
+    // Contents of the buffers between loadMesh and upload: the mesh cache
+    // they are mapped from, or the arrays loadMesh built them in
+    std::unique_ptr<MeshCache> cache;
+    std::vector<unsigned char> vertexData;
+    std::vector<unsigned char> indexData;
     
     // Load .obj file method
     bool loadObj(const char *path,
                  std::vector<glm::vec3> &inVertices,
                  std::vector<glm::vec2> &inUVs,
-                 std::vector<glm::vec3> &inNormals);
+                 std::vector<glm::vec3> &inNormals,
+                 std::vector<unsigned int> &inIndices);
     
     // Setup buffers
-    void setupBuffers();
+    void setupBuffers(const MeshBuffers &buffers);
+    
+    // The buffers loadMesh built, when not loaded from the cache
+    MeshBuffers builtBuffers() const;
+    
+    // Pointers to the attribute arrays
+    MeshStreams streams() const;
+    
+    // Send the material properties and bind the textures
+    void bindMaterial(unsigned int shaderID) const;
+    
+    // Draw the triangles of a level of detail
+    void drawMesh(unsigned int lod) const;
 
     // Calculate tangents and bitangents
     void calculateTangents();
     
-    // Load texture
-    unsigned int loadTexture(const char *path);
+    // Reorder the mesh for the vertex cache, overdraw and vertex fetch
+    void optimize();
+    
+    // Calculate the bounding box and sphere
+    void calculateBounds();
+    
+    // Free the arrays the residency policy doesn't keep
+    void applyResidency();
+    
+    // Mesh cache flags for the load settings
+    uint32_t cacheFlags() const;
+
 };
@@ -0,0 +1,642 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "objloader.hpp"
+#include "threadpool.hpp"
+
+// -----------------------------------------------------------------------------
+// Memory mapped file
+// -----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char *path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // An empty file is valid but can't be mapped
+    if (fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    size          = static_cast<size_t>(fileSize.QuadPart);
+    fileHandle    = file;
+    mappingHandle = mapping;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // An empty file is valid but can't be mapped
+    if (info.st_size == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+
+    void *mapping = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    // The file is read front to back so ask for aggressive read-ahead
+    madvise(mapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+    data = static_cast<const char *>(mapping);
+    size = static_cast<size_t>(info.st_size);
+#endif
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data == NULL)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(static_cast<HANDLE>(mappingHandle));
+    CloseHandle(static_cast<HANDLE>(fileHandle));
+    fileHandle    = NULL;
+    mappingHandle = NULL;
+#else
+    munmap(const_cast<char *>(data), size);
+#endif
+
+    data = NULL;
+    size = 0;
+}
+
+// -----------------------------------------------------------------------------
+// Tokenizer
+// -----------------------------------------------------------------------------
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c)
+{
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+static inline const char *skipSpace(const char *p, const char *end)
+{
+    while (p < end && isSpace(*p))
+        p++;
+    return p;
+}
+
+static inline const char *skipLine(const char *p, const char *end)
+{
+    while (p < end && *p != '\n')
+        p++;
+    return p < end ? p + 1 : end;
+}
+
+// Exactly representable powers of ten
+static const double powersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Parse a decimal floating point number. The mantissa is accumulated as an
+// integer so the result only needs a single rounding step for the digit
+// counts found in .obj files.
+static const char *parseFloat(const char *p, const char *end, float &out)
+{
+    p = skipSpace(p, end);
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits   = 0;
+    int exponent = 0;
+
+    // Integer part
+    for (; p < end && isDigit(*p); p++)
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + static_cast<unsigned int>(*p - '0');
+            digits += mantissa != 0;
+        }
+        else
+            exponent++;
+    }
+
+    // Fractional part
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && isDigit(*p); p++)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<unsigned int>(*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+
+    // Exponent
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negativeExponent = *p++ == '-';
+
+        int value = 0;
+        for (; p < end && isDigit(*p); p++)
+            if (value < 10000)
+                value = value * 10 + (*p - '0');
+        exponent += negativeExponent ? -value : value;
+    }
+
+    double value = static_cast<double>(mantissa);
+    while (exponent < -22)
+    {
+        value /= powersOfTen[22];
+        exponent += 22;
+    }
+    while (exponent > 22)
+    {
+        value *= powersOfTen[22];
+        exponent -= 22;
+    }
+    if (exponent < 0)
+        value /= powersOfTen[-exponent];
+    else
+        value *= powersOfTen[exponent];
+
+    out = static_cast<float>(negative ? -value : value);
+    return p;
+}
+
+// Parse a (possibly negative) integer. Returns NULL if there are no digits.
+static inline const char *parseInt(const char *p, const char *end, long long &out)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    if (p == end || !isDigit(*p))
+        return NULL;
+
+    long long value = 0;
+    for (; p < end && isDigit(*p); p++)
+        value = value * 10 + (*p - '0');
+
+    out = negative ? -value : value;
+    return p;
+}
+
+// Convert a 1-based or negative relative .obj index to a 0-based index
+static inline unsigned int resolveIndex(long long index, size_t count)
+{
+    if (index > 0)
+        return static_cast<unsigned int>(index - 1);
+    if (index < 0 && static_cast<size_t>(-index) <= count)
+        return static_cast<unsigned int>(static_cast<long long>(count) + index);
+    return ObjData::missing;
+}
+
+// Type of the record at the start of a line
+enum ObjRecord
+{
+    RecordNone,
+    RecordPosition,
+    RecordUV,
+    RecordNormal,
+    RecordFace
+};
+
+static inline ObjRecord recordType(const char *p, const char *end)
+{
+    if (p + 1 >= end)
+        return RecordNone;
+
+    if (p[0] == 'v')
+    {
+        if (isSpace(p[1]))
+            return RecordPosition;
+        if (p + 2 < end && isSpace(p[2]))
+        {
+            if (p[1] == 't')
+                return RecordUV;
+            if (p[1] == 'n')
+                return RecordNormal;
+        }
+    }
+    else if (p[0] == 'f' && isSpace(p[1]))
+        return RecordFace;
+
+    return RecordNone;
+}
+
+// -----------------------------------------------------------------------------
+// Parser
+// -----------------------------------------------------------------------------
+ObjCounts countObj(const char *begin, const char *end)
+{
+    ObjCounts counts;
+    const char *p = begin;
+    while (p < end)
+    {
+        p = skipSpace(p, end);
+        switch (recordType(p, end))
+        {
+            case RecordPosition:
+                counts.positions++;
+                break;
+
+            case RecordUV:
+                counts.uvs++;
+                break;
+
+            case RecordNormal:
+                counts.normals++;
+                break;
+
+            case RecordFace:
+            {
+                // Count the vertices of the polygon
+                size_t polygonSize = 0;
+                p++;
+                while (true)
+                {
+                    p = skipSpace(p, end);
+                    if (p == end || *p == '\n' || *p == '#')
+                        break;
+                    polygonSize++;
+                    while (p < end && !isSpace(*p) && *p != '\n')
+                        p++;
+                }
+                if (polygonSize >= 3)
+                    counts.corners += 3 * (polygonSize - 2);
+                break;
+            }
+
+            default:
+                break;
+        }
+        p = skipLine(p, end);
+    }
+    return counts;
+}
+
+bool parseObjRange(const char *begin, const char *end,
+                   const ObjCounts &offset, ObjData &obj)
+{
+    glm::vec3    *positions       = obj.positions.data()       + offset.positions;
+    glm::vec2    *uvs             = obj.uvs.data()             + offset.uvs;
+    glm::vec3    *normals         = obj.normals.data()         + offset.normals;
+    unsigned int *positionIndices = obj.positionIndices.data() + offset.corners;
+    unsigned int *uvIndices       = obj.uvIndices.data()       + offset.corners;
+    unsigned int *normalIndices   = obj.normalIndices.data()   + offset.corners;
+
+    // Number of records seen so far, needed to resolve relative indices
+    size_t numPositions = offset.positions;
+    size_t numUVs       = offset.uvs;
+    size_t numNormals   = offset.normals;
+
+    const char *p = begin;
+    while (p < end)
+    {
+        p = skipSpace(p, end);
+        switch (recordType(p, end))
+        {
+            case RecordPosition:
+            {
+                glm::vec3 &position = *positions++;
+                p = parseFloat(p + 1, end, position.x);
+                p = parseFloat(p, end, position.y);
+                p = parseFloat(p, end, position.z);
+                numPositions++;
+                break;
+            }
+
+            case RecordUV:
+            {
+                glm::vec2 &uv = *uvs++;
+                p = parseFloat(p + 2, end, uv.x);
+                p = parseFloat(p, end, uv.y);
+                numUVs++;
+                break;
+            }
+
+            case RecordNormal:
+            {
+                glm::vec3 &normal = *normals++;
+                p = parseFloat(p + 2, end, normal.x);
+                p = parseFloat(p, end, normal.y);
+                p = parseFloat(p, end, normal.z);
+                numNormals++;
+                break;
+            }
+
+            case RecordFace:
+            {
+                // Read the polygon and triangulate it as a fan around the
+                // first vertex
+                unsigned int first[3]    = { 0, 0, 0 };
+                unsigned int previous[3] = { 0, 0, 0 };
+                unsigned int polygonSize = 0;
+                p++;
+                while (true)
+                {
+                    p = skipSpace(p, end);
+                    if (p == end || *p == '\n' || *p == '#')
+                        break;
+
+                    // Vertex is one of v, v/vt, v//vn or v/vt/vn
+                    long long index;
+                    unsigned int vertex[3] = { ObjData::missing, ObjData::missing, ObjData::missing };
+                    p = parseInt(p, end, index);
+                    if (p == NULL)
+                    {
+                        printf("File can't be read by loadObj().\n");
+                        return false;
+                    }
+                    vertex[0] = resolveIndex(index, numPositions);
+                    if (p < end && *p == '/')
+                    {
+                        p++;
+                        if (p < end && *p != '/')
+                        {
+                            p = parseInt(p, end, index);
+                            if (p == NULL)
+                            {
+                                printf("File can't be read by loadObj().\n");
+                                return false;
+                            }
+                            vertex[1] = resolveIndex(index, numUVs);
+                        }
+                        if (p < end && *p == '/')
+                        {
+                            p = parseInt(p + 1, end, index);
+                            if (p == NULL)
+                            {
+                                printf("File can't be read by loadObj().\n");
+                                return false;
+                            }
+                            vertex[2] = resolveIndex(index, numNormals);
+                        }
+                    }
+
+                    // Emit a triangle for every vertex after the second
+                    if (polygonSize == 0)
+                    {
+                        first[0] = vertex[0], first[1] = vertex[1], first[2] = vertex[2];
+                    }
+                    else if (polygonSize >= 2)
+                    {
+                        *positionIndices++ = first[0];
+                        *uvIndices++       = first[1];
+                        *normalIndices++   = first[2];
+                        *positionIndices++ = previous[0];
+                        *uvIndices++       = previous[1];
+                        *normalIndices++   = previous[2];
+                        *positionIndices++ = vertex[0];
+                        *uvIndices++       = vertex[1];
+                        *normalIndices++   = vertex[2];
+                    }
+                    previous[0] = vertex[0], previous[1] = vertex[1], previous[2] = vertex[2];
+                    polygonSize++;
+
+                    // Skip anything unexpected up to the next vertex
+                    while (p < end && !isSpace(*p) && *p != '\n')
+                        p++;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+        p = skipLine(p, end);
+    }
+
+    return true;
+}
+
+// Split [begin, end) into about numChunks pieces that start and end on line
+// boundaries
+static std::vector<const char *> splitLines(const char *begin, const char *end, size_t numChunks)
+{
+    std::vector<const char *> boundaries(1, begin);
+    size_t size = static_cast<size_t>(end - begin);
+    for (size_t i = 1; i < numChunks; i++)
+    {
+        const char *p = begin + size / numChunks * i;
+        if (p < boundaries.back())
+            p = boundaries.back();
+        p = skipLine(p, end);
+        if (p > boundaries.back() && p < end)
+            boundaries.push_back(p);
+    }
+    boundaries.push_back(end);
+    return boundaries;
+}
+
+bool parseObj(const char *path, ObjData &obj, unsigned int numThreads)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        printf("Impossible to open the file. Check paths and directories.\n");
+        return false;
+    }
+
+    const char *begin = file.data;
+    const char *end   = file.data + file.size;
+
+    // Small files aren't worth handing to other threads
+    const size_t minChunkSize = 256 * 1024;
+    if (numThreads == 0)
+        numThreads = ThreadPool::global().size() + 1;
+    size_t numChunks = file.size / minChunkSize;
+    if (numChunks > numThreads)
+        numChunks = numThreads;
+    if (numThreads <= 1 || numChunks <= 1)
+    {
+        // Size the output arrays from a counting pass
+        ObjCounts counts = countObj(begin, end);
+        obj.positions.resize(counts.positions);
+        obj.uvs.resize(counts.uvs);
+        obj.normals.resize(counts.normals);
+        obj.positionIndices.resize(counts.corners);
+        obj.uvIndices.resize(counts.corners);
+        obj.normalIndices.resize(counts.corners);
+
+        // Parse the records straight out of the mapping
+        return parseObjRange(begin, end, ObjCounts(), obj);
+    }
+
+    // Count the records of each chunk in parallel
+    std::vector<const char *> boundaries = splitLines(begin, end, numChunks);
+    numChunks = boundaries.size() - 1;
+    std::vector<ObjCounts> offsets(numChunks + 1);
+    ThreadPool::global().parallelFor(numChunks, [&](size_t i)
+    {
+        offsets[i + 1] = countObj(boundaries[i], boundaries[i + 1]);
+    });
+
+    // Prefix sums give where each chunk writes its records, and the number of
+    // earlier records needed to resolve relative face indices
+    for (size_t i = 1; i <= numChunks; i++)
+    {
+        offsets[i].positions += offsets[i - 1].positions;
+        offsets[i].uvs       += offsets[i - 1].uvs;
+        offsets[i].normals   += offsets[i - 1].normals;
+        offsets[i].corners   += offsets[i - 1].corners;
+    }
+
+    const ObjCounts &counts = offsets[numChunks];
+    obj.positions.resize(counts.positions);
+    obj.uvs.resize(counts.uvs);
+    obj.normals.resize(counts.normals);
+    obj.positionIndices.resize(counts.corners);
+    obj.uvIndices.resize(counts.corners);
+    obj.normalIndices.resize(counts.corners);
+
+    // Parse the chunks in parallel, each straight into its own slice
+    std::vector<char> success(numChunks);
+    ThreadPool::global().parallelFor(numChunks, [&](size_t i)
+    {
+        success[i] = parseObjRange(boundaries[i], boundaries[i + 1], offsets[i], obj);
+    });
+
+    for (size_t i = 0; i < numChunks; i++)
+        if (!success[i])
+            return false;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Vertex welding
+// -----------------------------------------------------------------------------
+struct VertexKey
+{
+    glm::vec3 position;
+    glm::vec2 uv;
+    glm::vec3 normal;
+
+    bool operator==(const VertexKey &other) const
+    {
+        return memcmp(this, &other, sizeof(VertexKey)) == 0;
+    }
+};
+
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey &key) const
+    {
+        // FNV-1a over the raw bits, so vertices are only welded if every
+        // attribute is bit-identical
+        uint32_t words[sizeof(VertexKey) / 4];
+        memcpy(words, &key, sizeof(VertexKey));
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned int i = 0; i < sizeof(VertexKey) / 4; i++)
+            hash = (hash ^ words[i]) * 1099511628211ull;
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+};
+
+void indexObj(const ObjData &obj,
+              std::vector<glm::vec3> &outVertices,
+              std::vector<glm::vec2> &outUVs,
+              std::vector<glm::vec3> &outNormals,
+              std::vector<unsigned int> &outIndices)
+{
+    size_t numCorners = obj.positionIndices.size();
+    outVertices.clear();
+    outUVs.clear();
+    outNormals.clear();
+    outIndices.resize(numCorners);
+
+    std::unordered_map<VertexKey, unsigned int, VertexKeyHash> uniqueVertices;
+    uniqueVertices.reserve(numCorners);
+
+    for (size_t i = 0; i < numCorners; i++)
+    {
+        unsigned int vertexIndex = obj.positionIndices[i];
+        unsigned int uvIndex     = obj.uvIndices[i];
+        unsigned int normalIndex = obj.normalIndices[i];
+
+        VertexKey key = { glm::vec3(0.0f), glm::vec2(0.0f), glm::vec3(0.0f) };
+        if (vertexIndex < obj.positions.size())
+            key.position = obj.positions[vertexIndex];
+        if (uvIndex < obj.uvs.size())
+            key.uv = obj.uvs[uvIndex];
+        if (normalIndex < obj.normals.size())
+            key.normal = obj.normals[normalIndex];
+
+        // Reuse the vertex if it has been seen before
+        unsigned int next = static_cast<unsigned int>(outVertices.size());
+        auto result = uniqueVertices.insert(std::make_pair(key, next));
+        if (result.second)
+        {
+            outVertices.push_back(key.position);
+            outUVs.push_back(key.uv);
+            outNormals.push_back(key.normal);
+        }
+        outIndices[i] = result.first->second;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    const char *data = NULL;
+    size_t size = 0;
+
+    MappedFile() {}
+    ~MappedFile();
+
+    // Map the file into memory, returns false if it can't be opened
+    bool open(const char *path);
+
+    // Unmap the file
+    void close();
+
+    // Mappings can't be copied
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+#ifdef _WIN32
+private:
+    void *fileHandle    = NULL;
+    void *mappingHandle = NULL;
+#endif
+};
+
+// Number of each type of record in (part of) an .obj file
+struct ObjCounts
+{
+    size_t positions = 0;
+    size_t uvs       = 0;
+    size_t normals   = 0;
+    size_t corners   = 0;   // triangle corners after fan triangulation
+};
+
+// Contents of an .obj file. Faces are triangulated and every triangle corner
+// has an index into each attribute array (0-based, ObjData::missing if the
+// face didn't specify that attribute).
+struct ObjData
+{
+    static const unsigned int missing = 0xFFFFFFFFu;
+
+    std::vector<glm::vec3>    positions;
+    std::vector<glm::vec2>    uvs;
+    std::vector<glm::vec3>    normals;
+    std::vector<unsigned int> positionIndices;
+    std::vector<unsigned int> uvIndices;
+    std::vector<unsigned int> normalIndices;
+};
+
+// Count the records in the text [begin, end)
+ObjCounts countObj(const char *begin, const char *end);
+
+// Parse the text [begin, end) into obj, writing each record type starting at
+// the position given by offset. The arrays must already be large enough.
+// Returns false if a malformed face is found.
+bool parseObjRange(const char *begin, const char *end,
+                   const ObjCounts &offset, ObjData &obj);
+
+// Load an .obj file using a memory mapping and a counting pass so that the
+// output arrays are allocated exactly once. Large files are split at line
+// boundaries and parsed on numThreads threads (0 for all cores); the result
+// is identical to parsing on a single thread.
+bool parseObj(const char *path, ObjData &obj, unsigned int numThreads = 1);
+
+// Weld identical position/uv/normal combinations into a unique vertex array
+// and an index buffer of 3 indices per triangle. Missing attributes are zero.
+void indexObj(const ObjData &obj,
+              std::vector<glm::vec3> &outVertices,
+              std::vector<glm::vec2> &outUVs,
+              std::vector<glm::vec3> &outNormals,
+              std::vector<unsigned int> &outIndices);
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "programcache.hpp"
+#include "hash.hpp"
+#include "atomicfile.hpp"
+#include "glextensions.hpp"
+
+static const char programCacheMagic[8] = { 'C', 'G', 'P', 'R', 'O', 'G', 0, 0 };
+
+bool ProgramCache::supported()
+{
+    // Some drivers have the extension but no binary formats to save to
+    if (!GLEW_VERSION_4_1 && !hasExtension("GL_ARB_get_program_binary"))
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+uint64_t ProgramCache::sourceHash(const std::string &vertexCode, const std::string &fragmentCode)
+{
+    // A driver update can change the binaries, so it changes the hash
+    uint64_t hash = hashBytes(vertexCode.data(), vertexCode.size(), version);
+    hash = hashBytes(fragmentCode.data(), fragmentCode.size(), hash);
+    const GLenum strings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (int i = 0; i < 3; i++)
+    {
+        const char *string = reinterpret_cast<const char *>(glGetString(strings[i]));
+        if (string)
+            hash = hashBytes(string, strlen(string), hash);
+    }
+    return hash;
+}
+
+std::string ProgramCache::cachePath(const char *vertexPath, const char *fragmentPath)
+{
+    // Named after the fragment shader's file, without its directory
+    std::string fragment(fragmentPath);
+    size_t slash = fragment.find_last_of("/\\");
+    if (slash != std::string::npos)
+        fragment = fragment.substr(slash + 1);
+    return std::string(vertexPath) + "+" + fragment + ".program";
+}
+
+GLProgram ProgramCache::load(const char *vertexPath, const char *fragmentPath, uint64_t sourceHash)
+{
+    if (!supported())
+        return GLProgram();
+
+    std::string path = cachePath(vertexPath, fragmentPath);
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return GLProgram();
+
+    // Check the header, then that the binary is whole
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    bool ok = fread(&header, sizeof(ProgramCacheHeader), 1, file) == 1 &&
+              memcmp(header.magic, programCacheMagic, sizeof(programCacheMagic)) == 0 &&
+              header.version == version &&
+              header.headerSize == sizeof(ProgramCacheHeader) &&
+              header.sourceHash == sourceHash &&
+              header.binarySize > 0 && header.binarySize < (1ull << 30);
+    if (ok)
+    {
+        binary.resize(static_cast<size_t>(header.binarySize));
+        ok = fread(binary.data(), 1, binary.size(), file) == binary.size() &&
+             fgetc(file) == EOF &&
+             hashBytes(binary.data(), binary.size()) == header.binaryHash;
+    }
+    fclose(file);
+    if (!ok)
+        return GLProgram();
+
+    // The driver can still refuse a binary, e.g. after an update that kept
+    // its version string
+    GLProgram program = GLProgram::create();
+    glProgramBinary(program.get(), header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program.get(), GL_LINK_STATUS, &linked);
+    if (!linked)
+        return GLProgram();
+    return program;
+}
+
+void ProgramCache::prepare(unsigned int program)
+{
+    if (supported())
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool ProgramCache::write(const char *vertexPath, const char *fragmentPath, uint64_t sourceHash,
+                         unsigned int program)
+{
+    if (!supported())
+        return false;
+
+    // Get the binary from the driver
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0)
+        return false;
+    binary.resize(static_cast<size_t>(written));
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(ProgramCacheHeader));
+    memcpy(header.magic, programCacheMagic, sizeof(programCacheMagic));
+    header.version      = version;
+    header.headerSize   = sizeof(ProgramCacheHeader);
+    header.sourceHash   = sourceHash;
+    header.binaryFormat = format;
+    header.binarySize   = binary.size();
+    header.binaryHash   = hashBytes(binary.data(), binary.size());
+
+    return writeFileAtomically(cachePath(vertexPath, fragmentPath).c_str(), [&](FILE *file)
+    {
+        return fwrite(&header, sizeof(ProgramCacheHeader), 1, file) == 1 &&
+               fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+    });
+}
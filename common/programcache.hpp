@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+#include <GL/glew.h>
+
+#include "glhandle.hpp"
+
+// Header at the start of a program binary cache file, followed by the
+// binary as the driver returned it
+struct ProgramCacheHeader
+{
+    char      magic[8];         // "CGPROG\0\0"
+    uint32_t  version;
+    uint32_t  headerSize;
+    uint64_t  sourceHash;       // hash of the shader sources and the driver
+    uint32_t  binaryFormat;     // as returned by glGetProgramBinary
+    uint32_t  reserved;
+    uint64_t  binarySize;
+    uint64_t  binaryHash;       // hash of the binary, to catch corrupt files
+};
+
+// Linked shader programs cached next to their vertex shader as the binary
+// the driver compiled them to. A binary only works with the driver that
+// wrote it, so the sources are hashed along with the GL vendor, renderer and
+// version; a cache written by another driver or from other sources is simply
+// recompiled and overwritten. Must be used on the thread owning the GL
+// context.
+class ProgramCache
+{
+public:
+    // Increase whenever the layout of the cache changes
+    static const uint32_t version = 1;
+
+    // Whether the GL context can save and load program binaries
+    static bool supported();
+
+    // Hash of a program's shader sources and the GL driver
+    static uint64_t sourceHash(const std::string &vertexCode, const std::string &fragmentCode);
+
+    // Create a program from its cache. Returns an empty handle if there is no
+    // cache, it is corrupt, was written from other sources or the driver
+    // rejects it.
+    static GLProgram load(const char *vertexPath, const char *fragmentPath, uint64_t sourceHash);
+
+    // Ask the driver to keep a program's binary, before it is linked
+    static void prepare(unsigned int program);
+
+    // Write the cache of a linked program
+    static bool write(const char *vertexPath, const char *fragmentPath, uint64_t sourceHash,
+                      unsigned int program);
+
+    // Path of the cache of a program, next to its vertex shader, e.g.
+    // "vertexShader.glsl+fragmentShader.glsl.program"
+    static std::string cachePath(const char *vertexPath, const char *fragmentPath);
+};
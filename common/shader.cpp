@@ -1,104 +1,215 @@
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <vector>
-#include <iostream>
 #include <fstream>
-#include <algorithm>
 #include <sstream>
-using namespace std;
-
-#include <stdlib.h>
-#include <string.h>
-
-#include <GL/glew.h>
+#include <chrono>
 
 #include "shader.hpp"
+#include "programcache.hpp"
+#include "glextensions.hpp"
+
+// GLEW 1.13 predates the KHR version of the extension, which has the same
+// token as the ARB one
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+struct ProgramFuture::State
+{
+    std::string  vertexPath, fragmentPath;
+    uint64_t     sourceHash = 0;
+    GLProgram    program;
+    unsigned int vertexShader = 0, fragmentShader = 0;
+    bool         parallel = false;      // the driver reports completion
+    bool         done = false;          // checked, or loaded from the cache
+    ProgramLoadStats stats;
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+// Read a shader file into a string
+static bool readShader(const char *path, std::string &code)
+{
+    std::ifstream stream(path, std::ios::in);
+    if (!stream.is_open())
+        return false;
+    std::stringstream sstr;
+    sstr << stream.rdbuf();
+    code = sstr.str();
+    return true;
+}
 
-    // Create the shaders
-    GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-    GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+// Hand a shader to the driver without waiting for it
+static unsigned int compileShader(GLenum type, const char *path, const std::string &code)
+{
+    printf("Compiling shader : %s\n", path);
+    unsigned int ShaderID = glCreateShader(type);
+    char const * SourcePointer = code.c_str();
+    glShaderSource(ShaderID, 1, &SourcePointer , NULL);
+    glCompileShader(ShaderID);
+    return ShaderID;
+}
 
-    // Read the Vertex Shader code from the file
-    std::string VertexShaderCode;
-    std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-    if(VertexShaderStream.is_open()){
-        std::stringstream sstr;
-        sstr << VertexShaderStream.rdbuf();
-        VertexShaderCode = sstr.str();
-        VertexShaderStream.close();
-    }else{
-        printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
-        getchar();
-        return 0;
+// Print a shader's log, which waits for it to compile
+static void printShaderLog(unsigned int ShaderID)
+{
+    int InfoLogLength;
+    glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+    if ( InfoLogLength > 0 )
+    {
+        std::vector<char> ShaderErrorMessage(InfoLogLength+1);
+        glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, 
+                           &ShaderErrorMessage[0]);
+        printf("%s\n", &ShaderErrorMessage[0]);
     }
+}
 
-    // Read the Fragment Shader code from the file
-    std::string FragmentShaderCode;
-    std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-    if(FragmentShaderStream.is_open()){
-        std::stringstream sstr;
-        sstr << FragmentShaderStream.rdbuf();
-        FragmentShaderCode = sstr.str();
-        FragmentShaderStream.close();
+bool ProgramFuture::ready() const
+{
+    if (!state || state->done || !state->parallel)
+        return true;
+    GLint complete = GL_FALSE;
+    glGetProgramiv(state->program.get(), GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+GLProgram ProgramFuture::get(ProgramLoadStats *stats)
+{
+    if (!state)
+        return GLProgram();
+
+    State &s = *state;
+    if (!s.done)
+    {
+        auto start = std::chrono::steady_clock::now();
+        printShaderLog(s.vertexShader);
+        printShaderLog(s.fragmentShader);
+
+        // Check the program
+        GLint Result = GL_FALSE;
+        int InfoLogLength;
+        glGetProgramiv(s.program.get(), GL_LINK_STATUS, &Result);
+        glGetProgramiv(s.program.get(), GL_INFO_LOG_LENGTH, &InfoLogLength);
+        if ( InfoLogLength > 0 )
+        {
+            std::vector<char> ProgramErrorMessage(InfoLogLength+1);
+            glGetProgramInfoLog(s.program.get(), InfoLogLength, NULL, 
+                                &ProgramErrorMessage[0]);
+            printf("%s\n", &ProgramErrorMessage[0]);
+        }
+
+        glDetachShader(s.program.get(), s.vertexShader);
+        glDetachShader(s.program.get(), s.fragmentShader);
+        
+        glDeleteShader(s.vertexShader);
+        glDeleteShader(s.fragmentShader);
+
+        // Cache the binary for next time
+        if (Result == GL_TRUE)
+            ProgramCache::write(s.vertexPath.c_str(), s.fragmentPath.c_str(), s.sourceHash, s.program.get());
+
+        s.done = true;
+        s.stats.milliseconds += elapsedMs(start);
+        printf("%s program %s + %s in %.1f ms\n", Result == GL_TRUE ? "Built" : "Failed to build",
+               s.vertexPath.c_str(), s.fragmentPath.c_str(), s.stats.milliseconds);
     }
 
-    GLint Result = GL_FALSE;
-    int InfoLogLength;
+    if (stats)
+        *stats = s.stats;
+    return std::move(s.program);
+}
 
-    // Compile Vertex Shader
-    printf("Compiling shader : %s\n", vertex_file_path);
-    char const * VertexSourcePointer = VertexShaderCode.c_str();
-    glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-    glCompileShader(VertexShaderID);
-
-    // Check Vertex Shader
-    glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-    glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-    if ( InfoLogLength > 0 ){
-        std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-        glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-        printf("%s\n", &VertexShaderErrorMessage[0]);
+ShaderBatch::ShaderBatch()
+{
+    // Let the driver choose how many threads to compile on. GLEW's flag is
+    // set whenever the function resolves, and without the extension
+    // GL_COMPLETION_STATUS_KHR would never report a program complete, so
+    // look the extension up in the context's list.
+    if (hasExtension("GL_ARB_parallel_shader_compile"))
+    {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        parallelCompile = true;
+    }
+    else if (hasExtension("GL_KHR_parallel_shader_compile"))
+    {
+        PFNGLMAXSHADERCOMPILERTHREADSARBPROC maxShaderCompilerThreads =
+            reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSARBPROC>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        if (maxShaderCompilerThreads)
+        {
+            maxShaderCompilerThreads(0xFFFFFFFF);
+            parallelCompile = true;
+        }
     }
+}
+
+ProgramFuture ShaderBatch::add(const char *vertexPath, const char *fragmentPath)
+{
+    auto start = std::chrono::steady_clock::now();
+    ProgramFuture future;
+    future.state = std::make_shared<ProgramFuture::State>();
+    ProgramFuture::State &s = *future.state;
+    s.vertexPath   = vertexPath;
+    s.fragmentPath = fragmentPath;
+    s.parallel     = parallelCompile;
+    s.done         = true;
+    programs.push_back(future);
 
-    // Compile Fragment Shader
-    printf("Compiling shader : %s\n", fragment_file_path);
-    char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-    glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-    glCompileShader(FragmentShaderID);
-
-    // Check Fragment Shader
-    glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-    glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-    if ( InfoLogLength > 0 ){
-        std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-        glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-        printf("%s\n", &FragmentShaderErrorMessage[0]);
+    // Read the Vertex Shader code from the file
+    std::string VertexShaderCode;
+    if (!readShader(vertexPath, VertexShaderCode))
+    {
+        printf("Impossible to open %s. Are you in the right directory?\n", 
+               vertexPath);
+        getchar();
+        return future;
     }
 
-    // Link the program
-    printf("Linking program\n");
-    GLuint ProgramID = glCreateProgram();
-    glAttachShader(ProgramID, VertexShaderID);
-    glAttachShader(ProgramID, FragmentShaderID);
-    glLinkProgram(ProgramID);
-
-    // Check the program
-    glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-    glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-    if ( InfoLogLength > 0 ){
-        std::vector<char> ProgramErrorMessage(InfoLogLength+1);
-        glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-        printf("%s\n", &ProgramErrorMessage[0]);
+    // Read the Fragment Shader code from the file
+    std::string FragmentShaderCode;
+    readShader(fragmentPath, FragmentShaderCode);
+
+    // Use the program the driver compiled last time if the sources are the same
+    s.sourceHash = ProgramCache::sourceHash(VertexShaderCode, FragmentShaderCode);
+    s.program = ProgramCache::load(vertexPath, fragmentPath, s.sourceHash);
+    if (s.program)
+    {
+        s.stats.cached = true;
+        s.stats.milliseconds = elapsedMs(start);
+        printf("Loaded cached program %s + %s in %.1f ms\n", vertexPath, fragmentPath, s.stats.milliseconds);
+        return future;
     }
 
-    glDetachShader(ProgramID, VertexShaderID);
-    glDetachShader(ProgramID, FragmentShaderID);
-    
-    glDeleteShader(VertexShaderID);
-    glDeleteShader(FragmentShaderID);
+    // Compile the shaders and link the program, leaving the checks to get()
+    s.vertexShader   = compileShader(GL_VERTEX_SHADER, vertexPath, VertexShaderCode);
+    s.fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentPath, FragmentShaderCode);
+    printf("Linking program\n");
+    s.program = GLProgram::create();
+    ProgramCache::prepare(s.program.get());
+    glAttachShader(s.program.get(), s.vertexShader);
+    glAttachShader(s.program.get(), s.fragmentShader);
+    glLinkProgram(s.program.get());
+    s.done = false;
+    s.stats.milliseconds = elapsedMs(start);
+    return future;
+}
 
-    return ProgramID;
+bool ShaderBatch::ready() const
+{
+    for (size_t i = 0; i < programs.size(); i++)
+        if (!programs[i].ready())
+            return false;
+    return true;
 }
 
+GLProgram LoadShaders(const char *vertex_file_path,
+                      const char *fragment_file_path,
+                      ProgramLoadStats *stats)
+{
+    ShaderBatch batch;
+    return batch.add(vertex_file_path, fragment_file_path).get(stats);
+}
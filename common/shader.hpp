@@ -1,108 +1,69 @@
 #pragma once
 
+#include <vector>
+#include <memory>
+
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-#include <vector>
-#include <fstream>
-#include <sstream>
+#include "glhandle.hpp"
 
-unsigned int LoadShaders(const char *vertex_file_path,
-                         const char *fragment_file_path)
+// How a program was loaded
+struct ProgramLoadStats
 {
+    bool   cached = false;          // from its binary cache rather than compiled
+    double milliseconds = 0.0;      // spent starting and waiting for it
+};
 
-    // Create the shaders
-    unsigned int VertexShaderID   = glCreateShader(GL_VERTEX_SHADER);
-    unsigned int FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-    // Read the Vertex Shader code from the file
-    std::string VertexShaderCode;
-    std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-    if(VertexShaderStream.is_open()){
-        std::stringstream sstr;
-        sstr << VertexShaderStream.rdbuf();
-        VertexShaderCode = sstr.str();
-        VertexShaderStream.close();
-    }
-    else
-    {
-        printf("Impossible to open %s. Are you in the right directory?\n", 
-               vertex_file_path);
-        getchar();
-        return 0;
-    }
-
-    // Read the Fragment Shader code from the file
-    std::string FragmentShaderCode;
-    std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-    if(FragmentShaderStream.is_open())
-    {
-        std::stringstream sstr;
-        sstr << FragmentShaderStream.rdbuf();
-        FragmentShaderCode = sstr.str();
-        FragmentShaderStream.close();
-    }
-
-    GLint Result = GL_FALSE;
-    int InfoLogLength;
+// A program a ShaderBatch is compiling and linking
+class ProgramFuture
+{
+public:
+    // Whether the program is compiled and linked, so that get() won't wait.
+    // Drivers without GL_KHR_parallel_shader_compile can't tell, so it is
+    // always true and get() may wait.
+    bool ready() const;
 
-    // Compile Vertex Shader
-    printf("Compiling shader : %s\n", vertex_file_path);
-    char const * VertexSourcePointer = VertexShaderCode.c_str();
-    glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-    glCompileShader(VertexShaderID);
+    // Wait for the program, print its logs and hand it over, or an empty
+    // handle if its shaders couldn't be read. Only the first call waits and
+    // gets the program, later ones get an empty handle.
+    GLProgram get(ProgramLoadStats *stats = NULL);
 
-    // Check Vertex Shader
-    glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-    glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-    if ( InfoLogLength > 0 )
-    {
-        std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-        glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, 
-                           &VertexShaderErrorMessage[0]);
-        printf("%s\n", &VertexShaderErrorMessage[0]);
-    }
+private:
+    friend class ShaderBatch;
+    struct State;
+    std::shared_ptr<State> state;
+};
 
-    // Compile Fragment Shader
-    printf("Compiling shader : %s\n", fragment_file_path);
-    char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-    glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-    glCompileShader(FragmentShaderID);
+// Hands shader programs to the driver as they are added without checking
+// on any of them, so that drivers with GL_KHR_parallel_shader_compile
+// compile them on their own threads while the caller gets on with loading
+// models. The status and logs of a program are only asked for once its
+// future's get() is called. Programs in the binary cache load straight
+// away. Must be used on the thread owning the GL context.
+class ShaderBatch
+{
+public:
+    ShaderBatch();
 
-    // Check Fragment Shader
-    glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-    glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-    if ( InfoLogLength > 0 )
-    {
-        std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-        glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, 
-                           &FragmentShaderErrorMessage[0]);
-        printf("%s\n", &FragmentShaderErrorMessage[0]);
-    }
+    // Read a program's shaders and start compiling and linking them
+    ProgramFuture add(const char *vertexPath, const char *fragmentPath);
 
-    // Link the program
-    printf("Linking program\n");
-    unsigned int ProgramID = glCreateProgram();
-    glAttachShader(ProgramID, VertexShaderID);
-    glAttachShader(ProgramID, FragmentShaderID);
-    glLinkProgram(ProgramID);
+    // Whether every program added is compiled and linked
+    bool ready() const;
 
-    // Check the program
-    glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-    glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-    if ( InfoLogLength > 0 )
-    {
-        std::vector<char> ProgramErrorMessage(InfoLogLength+1);
-        glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, 
-                            &ProgramErrorMessage[0]);
-        printf("%s\n", &ProgramErrorMessage[0]);
-    }
+    // Whether the driver compiles in the background
+    bool parallel() const { return parallelCompile; }
 
-    glDetachShader(ProgramID, VertexShaderID);
-    glDetachShader(ProgramID, FragmentShaderID);
-    
-    glDeleteShader(VertexShaderID);
-    glDeleteShader(FragmentShaderID);
+private:
+    std::vector<ProgramFuture> programs;
+    bool parallelCompile = false;
+};
 
-    return ProgramID;
-}
+// Compile and link a vertex and fragment shader into a program, or load it
+// from the binary cache next to the vertex shader if the driver compiled
+// the same sources before. Returns an empty handle if a shader file can't
+// be opened.
+GLProgram LoadShaders(const char *vertex_file_path,
+                      const char *fragment_file_path,
+                      ProgramLoadStats *stats = NULL);
@@ -0,0 +1,257 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+
+#include "shaderprogram.hpp"
+#include "glextensions.hpp"
+#include "glhandle.hpp"
+
+// Every uniform name interned, shared by all programs. Models may be built
+// on worker threads, so the table is locked.
+struct UniformNames
+{
+    std::mutex lock;
+    std::unordered_map<std::string, unsigned int> indices;
+    std::vector<std::string> names;     // by index
+};
+
+static UniformNames &uniformNames()
+{
+    static UniformNames names;
+    return names;
+}
+
+Uniform::Uniform(const char *name) : Uniform(std::string(name))
+{
+}
+
+Uniform::Uniform(const std::string &name)
+{
+    UniformNames &names = uniformNames();
+    std::lock_guard<std::mutex> guard(names.lock);
+    auto it = names.indices.find(name);
+    if (it == names.indices.end())
+    {
+        it = names.indices.emplace(name, static_cast<unsigned int>(names.names.size())).first;
+        names.names.push_back(name);
+    }
+    index = it->second;
+}
+
+size_t Uniform::count()
+{
+    UniformNames &names = uniformNames();
+    std::lock_guard<std::mutex> guard(names.lock);
+    return names.names.size();
+}
+
+// Every program reflected so far, by id
+static std::unordered_map<unsigned int, std::unique_ptr<ShaderProgram>> &programs()
+{
+    static std::unordered_map<unsigned int, std::unique_ptr<ShaderProgram>> reflected;
+    return reflected;
+}
+
+ShaderProgram &ShaderProgram::get(unsigned int program)
+{
+    std::unique_ptr<ShaderProgram> &reflected = programs()[program];
+    if (!reflected)
+        reflected.reset(new ShaderProgram(program));
+    return *reflected;
+}
+
+void ShaderProgram::release(unsigned int program)
+{
+    programs().erase(program);
+}
+
+void GLProgramTraits::destroy(unsigned int id)
+{
+    ShaderProgram::release(id);
+    glDeleteProgram(id);
+}
+
+UniformStats &ShaderProgram::stats()
+{
+    static UniformStats counters;
+    return counters;
+}
+
+// Binding points of the uniform blocks shared by programs, by block name
+static std::unordered_map<std::string, unsigned int> &blockBindings()
+{
+    static std::unordered_map<std::string, unsigned int> bindings;
+    return bindings;
+}
+
+void ShaderProgram::bindBlock(const char *name, unsigned int binding)
+{
+    blockBindings()[name] = binding;
+    for (auto &reflected : programs())
+        if (reflected.second)
+            reflected.second->applyBlock(name, binding);
+}
+
+void ShaderProgram::applyBlock(const std::string &name, unsigned int binding)
+{
+    GLuint index = glGetUniformBlockIndex(program, name.c_str());
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, index, binding);
+}
+
+ShaderProgram::ShaderProgram(unsigned int program) : program(program)
+{
+    // Bind the shared uniform blocks
+    for (auto &block : blockBindings())
+        applyBlock(block.first, block.second);
+    
+    // Enumerate the active uniforms once
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> buffer(maxLength + 1);
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type;
+        glGetActiveUniform(program, i, maxLength, &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        // Members of uniform blocks have no location
+        GLint location = glGetUniformLocation(program, name.c_str());
+        if (location < 0)
+            continue;
+        locations[name] = location;
+
+        // Arrays of basic types are listed once as "name[0]", and can be
+        // named without the index too
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+        {
+            std::string base = name.substr(0, name.size() - 3);
+            locations[base] = location;
+            for (GLint element = 1; element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                locations[elementName] = glGetUniformLocation(program, elementName.c_str());
+            }
+        }
+    }
+}
+
+int ShaderProgram::slot(const Uniform &uniform)
+{
+    if (!uniform.valid())
+        return inactive;
+
+    // Resolve each name once for the program
+    if (uniform.id() >= slotOf.size())
+        slotOf.resize(Uniform::count(), unresolved);
+    int &index = slotOf[uniform.id()];
+    if (index != unresolved)
+        return index;
+
+    UniformNames &names = uniformNames();
+    std::unique_lock<std::mutex> guard(names.lock);
+    auto found = locations.find(names.names[uniform.id()]);
+    guard.unlock();
+    if (found == locations.end())
+    {
+        index = inactive;
+        return index;
+    }
+    Slot slot;
+    slot.location = found->second;
+    slots.push_back(slot);
+    index = static_cast<int>(slots.size()) - 1;
+    return index;
+}
+
+GLint ShaderProgram::location(const Uniform &uniform)
+{
+    int index = slot(uniform);
+    return index == inactive ? -1 : slots[index].location;
+}
+
+bool ShaderProgram::update(int index, const void *value, size_t size)
+{
+    Slot &slot = slots[index];
+    if (slot.known && memcmp(slot.value, value, size) == 0)
+    {
+        stats().skipped++;
+        return false;
+    }
+    memcpy(slot.value, value, size);
+    slot.known = true;
+    stats().sent++;
+    return true;
+}
+
+bool ShaderProgram::direct() const
+{
+    static const bool separate = GLEW_VERSION_4_1 || hasExtension("GL_ARB_separate_shader_objects");
+    if (separate)
+        return true;
+#ifndef NDEBUG
+    GLint current = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+    assert(static_cast<unsigned int>(current) == program);
+#endif
+    return false;
+}
+
+void ShaderProgram::set(const Uniform &uniform, int value)
+{
+    int index = slot(uniform);
+    if (index == inactive || !update(index, &value, sizeof(value)))
+        return;
+    if (direct())
+        glProgramUniform1i(program, slots[index].location, value);
+    else
+        glUniform1i(slots[index].location, value);
+}
+
+void ShaderProgram::set(const Uniform &uniform, float value)
+{
+    int index = slot(uniform);
+    if (index == inactive || !update(index, &value, sizeof(value)))
+        return;
+    if (direct())
+        glProgramUniform1f(program, slots[index].location, value);
+    else
+        glUniform1f(slots[index].location, value);
+}
+
+void ShaderProgram::set(const Uniform &uniform, const glm::vec3 &value)
+{
+    int index = slot(uniform);
+    if (index == inactive || !update(index, &value[0], sizeof(value)))
+        return;
+    if (direct())
+        glProgramUniform3fv(program, slots[index].location, 1, &value[0]);
+    else
+        glUniform3fv(slots[index].location, 1, &value[0]);
+}
+
+void ShaderProgram::set(const Uniform &uniform, const glm::vec4 &value)
+{
+    int index = slot(uniform);
+    if (index == inactive || !update(index, &value[0], sizeof(value)))
+        return;
+    if (direct())
+        glProgramUniform4fv(program, slots[index].location, 1, &value[0]);
+    else
+        glUniform4fv(slots[index].location, 1, &value[0]);
+}
+
+void ShaderProgram::set(const Uniform &uniform, const glm::mat4 &value)
+{
+    int index = slot(uniform);
+    if (index == inactive || !update(index, &value[0][0], sizeof(value)))
+        return;
+    if (direct())
+        glProgramUniformMatrix4fv(program, slots[index].location, 1, GL_FALSE, &value[0][0]);
+    else
+        glUniformMatrix4fv(slots[index].location, 1, GL_FALSE, &value[0][0]);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// The name of a uniform, interned once so that programs find it by index
+// rather than by string. Make them once, e.g. as statics or members, rather
+// than every frame.
+class Uniform
+{
+public:
+    // A uniform no program has, which set() ignores
+    Uniform() {}
+
+    explicit Uniform(const char *name);
+    explicit Uniform(const std::string &name);
+
+    // Index of the name, the same for every Uniform made from it
+    unsigned int id() const { return index; }
+    bool valid() const { return index != invalid; }
+
+    // Number of names interned so far
+    static size_t count();
+
+private:
+    static const unsigned int invalid = ~0u;
+    unsigned int index = invalid;
+};
+
+// Counters of the values sent to programs
+struct UniformStats
+{
+    size_t sent    = 0;     // glUniform* or glProgramUniform* calls
+    size_t skipped = 0;     // values a program already had
+};
+
+// The active uniforms of a linked program, enumerated the first time it is
+// used, and the values last sent to each so that sending one again costs
+// nothing. Values are sent with glProgramUniform* where the context has it
+// (GL 4.1 or ARB_separate_shader_objects), otherwise with glUniform*, which
+// needs the program to be in use. Must be used on the thread owning the GL
+// context.
+class ShaderProgram
+{
+public:
+    // The reflection of a program id, made the first time it is asked for
+    static ShaderProgram &get(unsigned int program);
+
+    // Forget a program before it is deleted, as GL may reuse its id. A
+    // GLProgram does this itself when it deletes its program.
+    static void release(unsigned int program);
+
+    // Counters of every program
+    static UniformStats &stats();
+    
+    // Bind the uniform block of this name to a binding point in every
+    // program that has it, those reflected already and those to come
+    static void bindBlock(const char *name, unsigned int binding);
+
+    // Location of a uniform, or -1 if the program doesn't use it
+    GLint location(const Uniform &uniform);
+
+    // Send a value unless the uniform already has it
+    void set(const Uniform &uniform, int value);
+    void set(const Uniform &uniform, float value);
+    void set(const Uniform &uniform, const glm::vec3 &value);
+    void set(const Uniform &uniform, const glm::vec4 &value);
+    void set(const Uniform &uniform, const glm::mat4 &value);
+
+private:
+    // A uniform the program uses and its current value
+    struct Slot
+    {
+        GLint    location = -1;
+        bool     known = false;     // value holds what was last sent
+        uint32_t value[16];
+    };
+
+    enum { unresolved = -2, inactive = -1 };
+
+    unsigned int program;
+    std::unordered_map<std::string, GLint> locations;  // of every active uniform and array element
+    std::vector<int>  slotOf;   // by Uniform::id(), an index in slots, unresolved or inactive
+    std::vector<Slot> slots;
+
+    explicit ShaderProgram(unsigned int program);
+
+    // Bind a uniform block if the program has it
+    void applyBlock(const std::string &name, unsigned int binding);
+    
+    // Slot of a uniform, or inactive
+    int slot(const Uniform &uniform);
+
+    // Store a value in a slot, returns false if it held it already
+    bool update(int slot, const void *value, size_t size);
+    
+    // Whether values go through glProgramUniform*, otherwise the program
+    // must be in use
+    bool direct() const;
+};
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "sourcefile.hpp"
+#include "hash.hpp"
+#include "objloader.hpp"
+
+bool fileInfo(const char *path, uint64_t &size, int64_t &time)
+{
+    struct stat info;
+    if (stat(path, &info) != 0)
+        return false;
+    size = static_cast<uint64_t>(info.st_size);
+    time = static_cast<int64_t>(info.st_mtime);
+    return true;
+}
+
+bool hashFile(const char *path, uint64_t &hash)
+{
+    MappedFile source;
+    if (!source.open(path))
+        return false;
+    hash = hashBytes(source.data, source.size);
+    return true;
+}
+
+bool describeSource(const char *path, const std::string &version, std::string &description)
+{
+    uint64_t size, hash;
+    int64_t time;
+    if (!fileInfo(path, size, time) || !hashFile(path, hash))
+        return false;
+
+    char source[64];
+    snprintf(source, sizeof(source), "%" PRIu64 " %" PRId64 " %" PRIx64, size, time, hash);
+    description = version + "|" + source;
+    return true;
+}
+
+bool sourceUnchanged(const char *path, const std::string &version, const std::string &description)
+{
+    std::string prefix = version + "|";
+    uint64_t size, cachedSize, hash, cachedHash;
+    int64_t time, cachedTime;
+    if (description.compare(0, prefix.size(), prefix) != 0 ||
+        sscanf(description.c_str() + prefix.size(), "%" SCNu64 " %" SCNd64 " %" SCNx64,
+               &cachedSize, &cachedTime, &cachedHash) != 3 ||
+        !fileInfo(path, size, time) || size != cachedSize)
+        return false;
+    return time == cachedTime || (hashFile(path, hash) && hash == cachedHash);
+}
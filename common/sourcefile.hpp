@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+// Size and modification time of a file
+bool fileInfo(const char *path, uint64_t &size, int64_t &time);
+
+// Hash of a file's contents
+bool hashFile(const char *path, uint64_t &hash);
+
+// Description of a source file stored in a cache derived from it: a version
+// naming the code that wrote the cache and anything else the cache depends
+// on, then the file's size, modification time and hash
+bool describeSource(const char *path, const std::string &version, std::string &description);
+
+// Whether a cache holding a description was derived from the file as it is
+// now, by the same version. A different modification time alone (e.g. after
+// a fresh checkout) only costs a hash of the file.
+bool sourceUnchanged(const char *path, const std::string &version, const std::string &description);
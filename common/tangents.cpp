@@ -0,0 +1,376 @@
+#include <math.h>
+#include <float.h>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TANGENTS_SSE2 1
+#endif
+
+#include "tangents.hpp"
+#include "threadpool.hpp"
+
+// Unit tangent of a triangle with the sign of its UV area folded in, the
+// handedness of its UV mapping in w (+1, -1, or 0 for degenerate UVs, which
+// also give a zero tangent) and the angle at each corner
+struct TriangleFrame
+{
+    glm::vec4 tangent;
+    float     angles[4];
+};
+
+// acos with an error below 1e-4 radians (Abramowitz and Stegun 4.4.45),
+// plenty for weights
+static inline float fastAcos(float x)
+{
+    float a = fabsf(x);
+    a = a > 1.0f ? 1.0f : a;
+    float r = sqrtf(1.0f - a) * (1.5707288f + a * (-0.2121144f + a * (0.0742610f - 0.0187293f * a)));
+    return x < 0.0f ? 3.14159265f - r : r;
+}
+
+// Angle between two edges given their lengths, 0 if either has no length
+static inline float cornerAngle(const glm::vec3 &a, const glm::vec3 &b, float lengthA, float lengthB)
+{
+    float lengths = lengthA * lengthB;
+    return lengths > 0.0f ? fastAcos(glm::dot(a, b) / lengths) : 0.0f;
+}
+
+static void triangleFrame(const glm::vec3 *positions, const glm::vec2 *uvs,
+                          const unsigned int *t, TriangleFrame &frame)
+{
+    const glm::vec3 &p0 = positions[t[0]], &p1 = positions[t[1]], &p2 = positions[t[2]];
+    glm::vec3 E1 = p1 - p0;
+    glm::vec3 E2 = p2 - p0;
+    glm::vec3 E3 = p2 - p1;
+    float l1 = glm::length(E1), l2 = glm::length(E2), l3 = glm::length(E3);
+    frame.angles[0] = cornerAngle(E1, E2, l1, l2);
+    frame.angles[1] = cornerAngle(-E1, E3, l1, l3);
+    frame.angles[2] = cornerAngle(-E2, -E3, l2, l3);
+    frame.angles[3] = 0.0f;
+
+    glm::vec2 D1 = uvs[t[1]] - uvs[t[0]];
+    glm::vec2 D2 = uvs[t[2]] - uvs[t[0]];
+    float det = D1.x * D2.y - D2.x * D1.y;
+    if (fabsf(det) <= FLT_MIN)
+    {
+        frame.tangent = glm::vec4(0.0f);
+        return;
+    }
+    float sign = det < 0.0f ? -1.0f : 1.0f;
+    glm::vec3 tangent = sign * (D2.y * E1 - D1.y * E2);
+    float length = glm::length(tangent);
+    frame.tangent = glm::vec4(length > 0.0f ? tangent * (1.0f / length) : glm::vec3(0.0f), sign);
+}
+
+#ifdef TANGENTS_SSE2
+static inline __m128 dot3(const __m128 *a, const __m128 *b)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])), _mm_mul_ps(a[2], b[2]));
+}
+
+// fastAcos of four values
+static inline __m128 fastAcos4(__m128 x)
+{
+    __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 a = _mm_min_ps(_mm_andnot_ps(signMask, x), _mm_set1_ps(1.0f));
+    __m128 poly = _mm_add_ps(_mm_set1_ps(0.0742610f), _mm_mul_ps(a, _mm_set1_ps(-0.0187293f)));
+    poly = _mm_add_ps(_mm_set1_ps(-0.2121144f), _mm_mul_ps(a, poly));
+    poly = _mm_add_ps(_mm_set1_ps(1.5707288f), _mm_mul_ps(a, poly));
+    __m128 r = _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), a)), poly);
+    __m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+    __m128 flipped = _mm_sub_ps(_mm_set1_ps(3.14159265f), r);
+    return _mm_or_ps(_mm_and_ps(negative, flipped), _mm_andnot_ps(negative, r));
+}
+
+// Angle between edges a and b, which may be negated, given the reciprocals
+// of their lengths, which are 0 for edges with no length
+static inline __m128 cornerAngle4(const __m128 *a, const __m128 *b, __m128 invLengths, bool negate)
+{
+    __m128 positive = _mm_cmpgt_ps(invLengths, _mm_setzero_ps());
+    __m128 c = _mm_mul_ps(dot3(a, b), invLengths);
+    if (negate)
+        c = _mm_xor_ps(c, _mm_set1_ps(-0.0f));
+    return _mm_and_ps(fastAcos4(c), positive);
+}
+
+// Approximate 1 / sqrt(x), or 0 where x is 0
+static inline __m128 rsqrt4(__m128 x)
+{
+    return _mm_and_ps(_mm_rsqrt_ps(x), _mm_cmpgt_ps(x, _mm_setzero_ps()));
+}
+
+// The 12 bytes of a vec3 in the first three lanes, without reading past it
+static inline __m128 loadVec3(const glm::vec3 &v)
+{
+    __m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(&v.x)));
+    return _mm_movelh_ps(xy, _mm_load_ss(&v.z));
+}
+
+static inline __m128 loadVec2(const glm::vec2 &v)
+{
+    return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(&v.x)));
+}
+
+// Corner k of four triangles, one register per component
+static inline void gatherCorner(const glm::vec3 *positions, const glm::vec2 *uvs, const unsigned int *t, int k,
+                                __m128 *p, __m128 &u, __m128 &v)
+{
+    __m128 r0 = loadVec3(positions[t[k]]), r1 = loadVec3(positions[t[3 + k]]);
+    __m128 r2 = loadVec3(positions[t[6 + k]]), r3 = loadVec3(positions[t[9 + k]]);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    p[0] = r0;
+    p[1] = r1;
+    p[2] = r2;
+    __m128 uv01 = _mm_movelh_ps(loadVec2(uvs[t[k]]), loadVec2(uvs[t[3 + k]]));
+    __m128 uv23 = _mm_movelh_ps(loadVec2(uvs[t[6 + k]]), loadVec2(uvs[t[9 + k]]));
+    u = _mm_shuffle_ps(uv01, uv23, _MM_SHUFFLE(2, 0, 2, 0));
+    v = _mm_shuffle_ps(uv01, uv23, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+// Four triangles at once, one register per component
+static void triangleFrames4(const glm::vec3 *positions, const glm::vec2 *uvs,
+                            const unsigned int *t, TriangleFrame *frames)
+{
+    // Edges and UV deltas
+    __m128 p0[3], p[3], u0, v0, u, v;
+    __m128 e1[3], e2[3], e3[3];
+    gatherCorner(positions, uvs, t, 0, p0, u0, v0);
+    gatherCorner(positions, uvs, t, 1, p, u, v);
+    for (int c = 0; c < 3; c++)
+        e1[c] = _mm_sub_ps(p[c], p0[c]);
+    __m128 du1 = _mm_sub_ps(u, u0), dv1 = _mm_sub_ps(v, v0);
+    gatherCorner(positions, uvs, t, 2, p, u, v);
+    for (int c = 0; c < 3; c++)
+    {
+        e2[c] = _mm_sub_ps(p[c], p0[c]);
+        e3[c] = _mm_sub_ps(e2[c], e1[c]);
+    }
+    __m128 du2 = _mm_sub_ps(u, u0), dv2 = _mm_sub_ps(v, v0);
+
+    // Tangents with sign(det) folded in, zero for degenerate UVs
+    __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 det = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+    __m128 sign = _mm_or_ps(_mm_set1_ps(1.0f), _mm_and_ps(det, signMask));
+    sign = _mm_and_ps(sign, _mm_cmpgt_ps(_mm_andnot_ps(signMask, det), _mm_set1_ps(FLT_MIN)));
+    dv1 = _mm_mul_ps(dv1, sign);
+    dv2 = _mm_mul_ps(dv2, sign);
+    __m128 tangent[4];
+    for (int c = 0; c < 3; c++)
+        tangent[c] = _mm_sub_ps(_mm_mul_ps(dv2, e1[c]), _mm_mul_ps(dv1, e2[c]));
+    __m128 scale = rsqrt4(dot3(tangent, tangent));
+    for (int c = 0; c < 3; c++)
+        tangent[c] = _mm_mul_ps(tangent[c], scale);
+    tangent[3] = sign;
+    _MM_TRANSPOSE4_PS(tangent[0], tangent[1], tangent[2], tangent[3]);
+    for (int i = 0; i < 4; i++)
+        _mm_storeu_ps(&frames[i].tangent.x, tangent[i]);
+
+    // Corner angles
+    __m128 l1 = rsqrt4(dot3(e1, e1));
+    __m128 l2 = rsqrt4(dot3(e2, e2));
+    __m128 l3 = rsqrt4(dot3(e3, e3));
+    __m128 angles[4];
+    angles[0] = cornerAngle4(e1, e2, _mm_mul_ps(l1, l2), false);
+    angles[1] = cornerAngle4(e1, e3, _mm_mul_ps(l1, l3), true);
+    angles[2] = cornerAngle4(e2, e3, _mm_mul_ps(l2, l3), false);
+    angles[3] = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(angles[0], angles[1], angles[2], angles[3]);
+    for (int i = 0; i < 4; i++)
+        _mm_storeu_ps(frames[i].angles, angles[i]);
+}
+#endif
+
+// Any unit vector perpendicular to n
+static glm::vec3 perpendicular(const glm::vec3 &n)
+{
+    glm::vec3 axis = fabsf(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 t = glm::cross(n, axis);
+    float length = glm::length(t);
+    return length > 0.0f ? t / length : glm::vec3(1.0f, 0.0f, 0.0f);
+}
+
+// Component of v in the plane perpendicular to n, normalised
+static glm::vec3 projectToPlane(const glm::vec3 &v, const glm::vec3 &n)
+{
+    glm::vec3 p = v - n * glm::dot(n, v);
+    float length = glm::length(p);
+    return length > 0.0f ? p / length : glm::vec3(0.0f);
+}
+
+// Orthonormal frame of a vertex from its normal and the sum of its
+// triangles' tangents and handedness
+static void vertexFrame(const glm::vec3 &normal, const glm::vec4 &sum, glm::vec3 &tangent, glm::vec3 &bitangent)
+{
+    float length = glm::length(normal);
+    glm::vec3 n = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+
+    // Projecting onto the tangent plane is linear, so the sum is projected
+    // once rather than each triangle's tangent
+    glm::vec3 t = projectToPlane(glm::vec3(sum), n);
+    if (glm::dot(t, t) == 0.0f)
+        t = perpendicular(n);
+    float sign = sum.w < 0.0f ? -1.0f : 1.0f;
+    tangent   = t;
+    bitangent = sign * glm::cross(n, t);
+}
+
+#ifdef TANGENTS_SSE2
+// Store the first three lanes of a register to a vec3
+static inline void storeVec3(glm::vec3 &v, __m128 x)
+{
+    _mm_storel_pi(reinterpret_cast<__m64 *>(&v.x), x);
+    _mm_store_ss(&v.z, _mm_movehl_ps(x, x));
+}
+
+// 1 / sqrt(x) where x is positive, otherwise 0
+static inline __m128 invSqrt4(__m128 x)
+{
+    __m128 positive = _mm_cmpgt_ps(x, _mm_setzero_ps());
+    __m128 root = _mm_sqrt_ps(_mm_or_ps(_mm_and_ps(positive, x), _mm_andnot_ps(positive, _mm_set1_ps(1.0f))));
+    return _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), root), positive);
+}
+
+// vertexFrame of four vertices. Returns a bit for each vertex whose sum has
+// no component in its tangent plane, which vertexFrame must redo.
+static int vertexFrames4(const glm::vec3 *normals, const glm::vec4 *sums,
+                         glm::vec3 *outTangents, glm::vec3 *outBitangents)
+{
+    __m128 n[4] = { loadVec3(normals[0]), loadVec3(normals[1]), loadVec3(normals[2]), loadVec3(normals[3]) };
+    __m128 s[4] = { _mm_loadu_ps(&sums[0].x), _mm_loadu_ps(&sums[1].x),
+                    _mm_loadu_ps(&sums[2].x), _mm_loadu_ps(&sums[3].x) };
+    _MM_TRANSPOSE4_PS(n[0], n[1], n[2], n[3]);
+    _MM_TRANSPOSE4_PS(s[0], s[1], s[2], s[3]);
+
+    // Unit normals, (0, 0, 1) for zero ones
+    __m128 scale = invSqrt4(dot3(n, n));
+    __m128 zero = _mm_cmpeq_ps(scale, _mm_setzero_ps());
+    n[0] = _mm_mul_ps(n[0], scale);
+    n[1] = _mm_mul_ps(n[1], scale);
+    n[2] = _mm_or_ps(_mm_mul_ps(n[2], scale), _mm_and_ps(zero, _mm_set1_ps(1.0f)));
+
+    // Tangents projected onto the tangent planes and normalised
+    __m128 d = dot3(n, s), t[4];
+    for (int c = 0; c < 3; c++)
+        t[c] = _mm_sub_ps(s[c], _mm_mul_ps(n[c], d));
+    scale = invSqrt4(dot3(t, t));
+    for (int c = 0; c < 3; c++)
+        t[c] = _mm_mul_ps(t[c], scale);
+    int missing = _mm_movemask_ps(_mm_cmpeq_ps(scale, _mm_setzero_ps()));
+
+    // Bitangents as sign * cross(n, t)
+    __m128 sign = _mm_or_ps(_mm_set1_ps(1.0f), _mm_and_ps(s[3], _mm_set1_ps(-0.0f)));
+    __m128 b[4];
+    b[0] = _mm_mul_ps(sign, _mm_sub_ps(_mm_mul_ps(n[1], t[2]), _mm_mul_ps(n[2], t[1])));
+    b[1] = _mm_mul_ps(sign, _mm_sub_ps(_mm_mul_ps(n[2], t[0]), _mm_mul_ps(n[0], t[2])));
+    b[2] = _mm_mul_ps(sign, _mm_sub_ps(_mm_mul_ps(n[0], t[1]), _mm_mul_ps(n[1], t[0])));
+    t[3] = b[3] = _mm_setzero_ps();
+
+    _MM_TRANSPOSE4_PS(t[0], t[1], t[2], t[3]);
+    _MM_TRANSPOSE4_PS(b[0], b[1], b[2], b[3]);
+    for (int i = 0; i < 4; i++)
+    {
+        storeVec3(outTangents[i], t[i]);
+        storeVec3(outBitangents[i], b[i]);
+    }
+    return missing;
+}
+#endif
+
+// Frames of triangles [begin, end). begin is a multiple of 4, so whether a
+// triangle takes the SSE2 path depends only on its index.
+static void triangleFrames(const glm::vec3 *positions, const glm::vec2 *uvs, const unsigned int *indices,
+                           size_t begin, size_t end, TriangleFrame *frames)
+{
+    size_t t = begin;
+#ifdef TANGENTS_SSE2
+    for (; t + 4 <= end; t += 4)
+        triangleFrames4(positions, uvs, indices + 3 * t, frames + (t - begin));
+#endif
+    for (; t < end; t++)
+        triangleFrame(positions, uvs, indices + 3 * t, frames[t - begin]);
+}
+
+// Add the frames of triangles to the sums at their corners, weighted by the
+// corner angles
+static void addFrames(const TriangleFrame *frames, size_t count, const unsigned int *t, glm::vec4 *sums)
+{
+    for (size_t i = 0; i < count; i++, t += 3)
+    {
+#ifdef TANGENTS_SSE2
+        __m128 tangent = _mm_loadu_ps(&frames[i].tangent.x);
+        for (int k = 0; k < 3; k++)
+        {
+            float *sum = &sums[t[k]].x;
+            _mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), _mm_mul_ps(tangent, _mm_set1_ps(frames[i].angles[k]))));
+        }
+#else
+        for (int k = 0; k < 3; k++)
+            sums[t[k]] += frames[i].angles[k] * frames[i].tangent;
+#endif
+    }
+}
+
+// Run task(begin, end) over about equal ranges of [0, count), each starting
+// at a multiple of 4
+static void parallelRanges(size_t count, unsigned int numThreads,
+                           const std::function<void(size_t, size_t)> &task)
+{
+    const size_t minChunkSize = 1024;
+    size_t numChunks = count / minChunkSize;
+    size_t maxChunks = numThreads == 0 ? ThreadPool::global().size() + 1 : numThreads;
+    if (numChunks > maxChunks)
+        numChunks = maxChunks;
+    if (numThreads == 1 || numChunks <= 1)
+    {
+        task(0, count);
+        return;
+    }
+    ThreadPool::global().parallelFor(numChunks, [&](size_t chunk)
+    {
+        size_t begin = count * chunk / numChunks & ~size_t(3);
+        size_t end = chunk + 1 == numChunks ? count : count * (chunk + 1) / numChunks & ~size_t(3);
+        task(begin, end);
+    });
+}
+
+void generateTangents(const glm::vec3 *positions, const glm::vec2 *uvs,
+                      const glm::vec3 *normals, size_t numVertices,
+                      const unsigned int *indices, size_t numIndices,
+                      glm::vec3 *outTangents, glm::vec3 *outBitangents,
+                      unsigned int numThreads)
+{
+    // The triangle frames are built a block at a time into a buffer that
+    // stays in cache, and added to their vertices in index order, so the
+    // sums don't depend on how the work is split
+    const size_t blockSize = 4096;
+    size_t numTriangles = numIndices / 3;
+    std::vector<TriangleFrame> frames(numTriangles < blockSize ? numTriangles : blockSize);
+    std::vector<glm::vec4> sums(numVertices, glm::vec4(0.0f));
+    for (size_t block = 0; block < numTriangles; block += blockSize)
+    {
+        size_t count = numTriangles - block < blockSize ? numTriangles - block : blockSize;
+        parallelRanges(count, numThreads, [&](size_t begin, size_t end)
+        {
+            triangleFrames(positions, uvs, indices, block + begin, block + end, &frames[begin]);
+        });
+        addFrames(frames.data(), count, indices + 3 * block, sums.data());
+    }
+
+    // Orthonormal frame at each vertex
+    parallelRanges(numVertices, numThreads, [&](size_t begin, size_t end)
+    {
+        size_t v = begin;
+#ifdef TANGENTS_SSE2
+        for (; v + 4 <= end; v += 4)
+        {
+            int missing = vertexFrames4(normals + v, sums.data() + v, outTangents + v, outBitangents + v);
+            for (int i = 0; i < 4; i++)
+                if (missing & (1 << i))
+                    vertexFrame(normals[v + i], sums[v + i], outTangents[v + i], outBitangents[v + i]);
+        }
+#endif
+        for (; v < end; v++)
+            vertexFrame(normals[v], sums[v], outTangents[v], outBitangents[v]);
+    });
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// Generate a tangent frame for every vertex of an indexed triangle mesh,
+// following MikkTSpace: each triangle's unit tangent, weighted by the angle
+// of the triangle at the vertex, is summed and projected onto the tangent
+// plane of the vertex normal. The bitangent is rebuilt as sign * cross(n, t),
+// sign being the handedness of the UV mapping summed the same way. Triangles
+// with degenerate UVs add nothing, and vertices left without a tangent get
+// one perpendicular to the normal, so the output never contains NaNs.
+//
+// numThreads 0 uses the global thread pool, 1 runs on the calling thread.
+// The output doesn't depend on the number of threads.
+void generateTangents(const glm::vec3 *positions, const glm::vec2 *uvs,
+                      const glm::vec3 *normals, size_t numVertices,
+                      const unsigned int *indices, size_t numIndices,
+                      glm::vec3 *outTangents, glm::vec3 *outBitangents,
+                      unsigned int numThreads = 0);
@@ -0,0 +1,318 @@
+#include <string.h>
+#include <map>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+
+#include "texturearray.hpp"
+#include "compressedtexture.hpp"
+
+TexturePacker::TexturePacker(const TexturePackSettings &settings) : settings(settings)
+{
+}
+
+size_t TexturePacker::add(const std::shared_ptr<const MipChain> &chain)
+{
+    Source source;
+    source.chain = chain;
+    source.index = packed.size();
+    sources.push_back(source);
+    packed.push_back(PackedTexture());
+    return source.index;
+}
+
+size_t TexturePacker::add(const std::shared_ptr<const CompressedTexture> &compressed)
+{
+    Source source;
+    source.compressed = compressed;
+    source.index = packed.size();
+    sources.push_back(source);
+    packed.push_back(PackedTexture());
+    return source.index;
+}
+
+int TexturePacker::atlasBorder() const
+{
+    if (settings.atlasPadding <= 0)
+        return 0;
+    int border = 1;
+    while (border < settings.atlasPadding)
+        border *= 2;
+    return border;
+}
+
+// Pixel format of an uncompressed texture, as uploadTexture() uses
+static GLenum channelFormat(int channels)
+{
+    if (channels == 1)
+        return GL_RED;
+    if (channels == 2)
+        return GL_RG;
+    if (channels == 4)
+        return GL_RGBA;
+    return GL_RGB;
+}
+
+// Video memory of a level, drivers padding three channel texels to four
+static size_t paddedBytes(size_t bytes, int channels)
+{
+    return channels == 3 ? bytes / 3 * 4 : bytes;
+}
+
+// Sampling parameters of the bound array
+static void setArraySampling(const TextureSampling &sampling, GLenum wrap, int levels)
+{
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, sampling.minFilter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, sampling.magFilter);
+}
+
+// Texel of a row or column read for a border texel, wrapping or clamping
+static int borderTexel(int i, int size, bool repeat)
+{
+    if (repeat)
+        return (i % size + size) % size;
+    return i < 0 ? 0 : i >= size ? size - 1 : i;
+}
+
+TextureHandle TexturePacker::store(GLTexture texture, size_t bytes)
+{
+    std::shared_ptr<SharedTexture> shared = std::make_shared<SharedTexture>();
+    shared->texture = std::move(texture);
+    shared->bytes   = bytes;
+    counters.bytes += bytes;
+    return shared;
+}
+
+void TexturePacker::pack(const TextureSampling &sampling)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Group the textures by compression, channels, size and levels, sending
+    // small uncompressed ones to the atlas of their channels instead
+    typedef std::tuple<int, int, int, int, size_t> Key;
+    std::map<Key, std::vector<const Source *>> arrays;
+    std::map<int, std::vector<const Source *>> atlases;
+    int border = atlasBorder();
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        const Source &source = sources[i];
+        if (source.levels().empty())
+            continue;
+        int width  = source.width();
+        int height = source.height();
+        if (source.chain && width <= settings.atlasMaxSize && height <= settings.atlasMaxSize &&
+            width + 2 * border <= settings.atlasSize && height + 2 * border <= settings.atlasSize)
+        {
+            atlases[source.chain->channels].push_back(&source);
+            continue;
+        }
+        int compression = source.compressed ? static_cast<int>(source.compressed->format) + 1 : 0;
+        int channels    = source.chain ? source.chain->channels : 0;
+        arrays[Key(compression, channels, width, height, source.levels().size())].push_back(&source);
+    }
+
+    for (auto it = arrays.begin(); it != arrays.end(); ++it)
+        packArrays(it->second, sampling);
+    for (auto it = atlases.begin(); it != atlases.end(); ++it)
+        packAtlas(it->second, sampling);
+
+    counters.textures += sources.size();
+    counters.atlasUse  = atlasArea > 0.0 ? atlasTexels / atlasArea : 0.0;
+    counters.milliseconds += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    sources.clear();
+}
+
+void TexturePacker::packArrays(const std::vector<const Source *> &group, const TextureSampling &sampling)
+{
+    GLint maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    const Source &first = *group[0];
+    int width    = first.width();
+    int height   = first.height();
+    int channels = first.chain ? first.chain->channels : 0;
+    int levels   = usesMipmaps(sampling) ? static_cast<int>(first.levels().size()) : 1;
+    GLenum format = first.chain ? channelFormat(channels) : compressedInternalFormat(first.compressed->format);
+
+    for (size_t begin = 0; begin < group.size(); begin += maxLayers)
+    {
+        size_t layers = std::min(group.size() - begin, static_cast<size_t>(maxLayers));
+        GLTexture texture = GLTexture::create();
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture.get());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        // Every layer of a level in one upload
+        size_t bytes = 0;
+        std::vector<uint8_t> data;
+        for (int level = 0; level < levels; level++)
+        {
+            size_t layerBytes = first.levels()[level].size();
+            data.resize(layerBytes * layers);
+            for (size_t i = 0; i < layers; i++)
+                memcpy(data.data() + i * layerBytes, group[begin + i]->levels()[level].data(), layerBytes);
+
+            int levelWidth  = std::max(width >> level, 1);
+            int levelHeight = std::max(height >> level, 1);
+            if (first.compressed)
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelWidth, levelHeight,
+                                       static_cast<GLsizei>(layers), 0, static_cast<GLsizei>(data.size()),
+                                       data.data());
+            else
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelWidth, levelHeight,
+                             static_cast<GLsizei>(layers), 0, format, GL_UNSIGNED_BYTE, data.data());
+            bytes += paddedBytes(data.size(), channels);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        setArraySampling(sampling, sampling.wrap, levels);
+
+        // Specular maps are read as a colour, as in uploadCompressedTexture
+        if (first.compressed && first.compressed->format == TextureCompression::BC4)
+        {
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_G, GL_RED);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_B, GL_RED);
+        }
+
+        // Whole layers, so the coordinates are unchanged
+        TextureHandle array = store(std::move(texture), bytes);
+        for (size_t i = 0; i < layers; i++)
+        {
+            PackedTexture &result = packed[group[begin + i]->index];
+            result.array = array;
+            result.layer = static_cast<int>(i);
+            result.rect  = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        }
+        counters.arrays++;
+        counters.layers += layers;
+    }
+}
+
+void TexturePacker::packAtlas(const std::vector<const Source *> &group, const TextureSampling &sampling)
+{
+    GLint maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    // Mipmaps down to a border of one texel, with the cells aligned so that
+    // they start on a whole texel of every level
+    int size   = settings.atlasSize;
+    int border = atlasBorder();
+    int levels = 1;
+    if (usesMipmaps(sampling))
+        while ((border >> levels) > 0 && levels < mipLevelCount(size, size))
+            levels++;
+    int align = 1 << (levels - 1);
+
+    std::vector<Cell> cells(group.size());
+    for (size_t i = 0; i < group.size(); i++)
+    {
+        cells[i].source = group[i];
+        cells[i].width  = (group[i]->width() + 2 * border + align - 1) / align * align;
+        cells[i].height = (group[i]->height() + 2 * border + align - 1) / align * align;
+    }
+
+    // Shelves of the tallest textures first, so that little of each shelf's
+    // height is wasted
+    std::vector<Cell *> order;
+    for (size_t i = 0; i < cells.size(); i++)
+        order.push_back(&cells[i]);
+    std::stable_sort(order.begin(), order.end(), [](const Cell *a, const Cell *b)
+    {
+        return a->height != b->height ? a->height > b->height : a->width > b->width;
+    });
+    int page = 0, x = 0, y = 0, shelf = 0;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        Cell &cell = *order[i];
+        if (x + cell.width > size)
+        {
+            y += shelf;
+            x = shelf = 0;
+        }
+        if (y + cell.height > size)
+        {
+            page++;
+            x = y = shelf = 0;
+        }
+        cell.page = page;
+        cell.x    = x;
+        cell.y    = y;
+        x += cell.width;
+        shelf = std::max(shelf, cell.height);
+    }
+    int pages = page + 1;
+
+    // Fill the pages level by level from the textures' own mipmaps, their
+    // last level standing in for those they don't have
+    int channels = group[0]->chain->channels;
+    GLenum format = channelFormat(channels);
+    bool repeat = sampling.wrap == GL_REPEAT;
+    for (int firstPage = 0; firstPage < pages; firstPage += maxLayers)
+    {
+        int layers = std::min(pages - firstPage, static_cast<int>(maxLayers));
+        GLTexture texture = GLTexture::create();
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture.get());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        size_t bytes = 0;
+        std::vector<uint8_t> data;
+        for (int level = 0; level < levels; level++)
+        {
+            int levelSize = std::max(size >> level, 1);
+            size_t layerBytes = static_cast<size_t>(levelSize) * levelSize * channels;
+            data.assign(layerBytes * layers, 0);
+            for (size_t i = 0; i < cells.size(); i++)
+            {
+                const Cell &cell = cells[i];
+                if (cell.page < firstPage || cell.page >= firstPage + layers)
+                    continue;
+
+                // The texture at an offset of the border, which repeats or
+                // clamps it out to the edge of the cell
+                const MipChain &chain = *cell.source->chain;
+                size_t sourceLevel = std::min(static_cast<size_t>(level), chain.levels.size() - 1);
+                int sourceWidth  = chain.levelWidth(sourceLevel);
+                int sourceHeight = chain.levelHeight(sourceLevel);
+                const uint8_t *source = chain.levels[sourceLevel].data();
+                int offset = border >> level;
+                uint8_t *target = data.data() + (cell.page - firstPage) * layerBytes +
+                                  (static_cast<size_t>(cell.y >> level) * levelSize + (cell.x >> level)) * channels;
+                for (int row = 0; row < (cell.height >> level); row++)
+                {
+                    const uint8_t *sourceRow = source + static_cast<size_t>(
+                        borderTexel(row - offset, sourceHeight, repeat)) * sourceWidth * channels;
+                    uint8_t *targetRow = target + static_cast<size_t>(row) * levelSize * channels;
+                    for (int column = 0; column < (cell.width >> level); column++)
+                        memcpy(targetRow + column * channels,
+                               sourceRow + borderTexel(column - offset, sourceWidth, repeat) * channels, channels);
+                }
+            }
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelSize, levelSize, layers, 0, format,
+                         GL_UNSIGNED_BYTE, data.data());
+            bytes += paddedBytes(data.size(), channels);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // The borders do the wrapping, so never sample past the page
+        setArraySampling(sampling, GL_CLAMP_TO_EDGE, levels);
+
+        TextureHandle array = store(std::move(texture), bytes);
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            const Cell &cell = cells[i];
+            if (cell.page < firstPage || cell.page >= firstPage + layers)
+                continue;
+            PackedTexture &result = packed[cell.source->index];
+            result.array = array;
+            result.layer = cell.page - firstPage;
+            result.rect  = glm::vec4(cell.x + border, cell.y + border,
+                                     cell.source->width(), cell.source->height()) / static_cast<float>(size);
+            atlasTexels += static_cast<double>(cell.source->width()) * cell.source->height();
+        }
+        atlasArea += static_cast<double>(size) * size * layers;
+        counters.atlases++;
+        counters.layers += layers;
+    }
+}
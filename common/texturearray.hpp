@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "image.hpp"
+#include "ktx.hpp"
+#include "texturecache.hpp"
+
+// Where a packed texture ended up: a layer of a GL_TEXTURE_2D_ARRAY and the
+// part of that layer it covers. A shader samples it with
+//
+//     vec2 st = rect.xy + fract(uv) * rect.zw;
+//     textureGrad(map, vec3(st, layer), dFdx(uv) * rect.zw, dFdy(uv) * rect.zw)
+//
+// taking the gradients from the unwrapped coordinates so the mipmap level
+// doesn't jump where fract() wraps.
+struct PackedTexture
+{
+    TextureHandle array;
+    int       layer = 0;
+    glm::vec4 rect  = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);   // offset and scale of the coordinates
+};
+
+// How textures are packed
+struct TexturePackSettings
+{
+    // Uncompressed textures no wider or taller than this are packed into
+    // atlases, larger ones and compressed ones into arrays of their size
+    int atlasMaxSize = 256;
+
+    // Width and height of an atlas page, each a layer of an atlas array
+    int atlasSize = 1024;
+
+    // Texels of border around each texture of an atlas, rounded up to a
+    // power of two and filled by repeating or clamping the texture as its
+    // sampling does. Atlases have mipmaps down to the level where the border
+    // is one texel, so the texture never blends with its neighbours.
+    int atlasPadding = 8;
+};
+
+// Counters of a texture packer
+struct TexturePackStats
+{
+    size_t textures   = 0;  // packed
+    size_t arrays     = 0;  // arrays of same size textures
+    size_t atlases    = 0;  // arrays of atlas pages
+    size_t layers     = 0;  // in both
+    size_t bytes      = 0;  // video memory of both
+    double atlasUse   = 0.0;    // fraction of the atlas pages covered by textures
+    double milliseconds = 0.0;
+};
+
+// Packs textures into as few texture arrays as possible, so that objects
+// with different textures can bind the same ones and be drawn together.
+// Textures of the same size and format become layers of one array; small
+// uncompressed textures are shelf packed into atlas pages with a border for
+// filtering and their coordinates remapped. Must be used on the thread
+// owning the GL context.
+class TexturePacker
+{
+public:
+    TexturePacker(const TexturePackSettings &settings = TexturePackSettings());
+
+    TexturePacker(const TexturePacker &) = delete;
+    TexturePacker &operator=(const TexturePacker &) = delete;
+
+    // Add a texture to pack, returns its index. The levels are kept until
+    // pack() uploads them.
+    size_t add(const std::shared_ptr<const MipChain> &chain);
+    size_t add(const std::shared_ptr<const CompressedTexture> &compressed);
+
+    // Create the arrays of every texture added since the last pack. The
+    // sampling applies to all of them.
+    void pack(const TextureSampling &sampling = TextureSampling());
+
+    // Where a texture was packed, once pack() has been called
+    const PackedTexture &get(size_t index) const { return packed[index]; }
+
+    // Current counters
+    const TexturePackStats &stats() const { return counters; }
+
+private:
+    struct Source
+    {
+        std::shared_ptr<const MipChain>          chain;
+        std::shared_ptr<const CompressedTexture> compressed;
+        size_t index = 0;   // in packed
+
+        const std::vector<std::vector<uint8_t>> &levels() const
+        {
+            return chain ? chain->levels : compressed->levels;
+        }
+        int width() const  { return chain ? chain->width : compressed->width; }
+        int height() const { return chain ? chain->height : compressed->height; }
+    };
+
+    // Place of a texture in an atlas, in texels of level 0
+    struct Cell
+    {
+        const Source *source = NULL;
+        int page = 0;
+        int x = 0, y = 0;           // corner of the border
+        int width = 0, height = 0;  // including the border, rounded up
+    };
+
+    TexturePackSettings        settings;
+    std::vector<Source>        sources;     // added since the last pack
+    std::vector<PackedTexture> packed;
+    TexturePackStats           counters;
+    double                     atlasTexels = 0.0;   // covered by textures
+    double                     atlasArea   = 0.0;   // of every page
+
+    // Border around the textures of an atlas, a power of two so that it
+    // halves evenly down the mipmaps, or 0 for none
+    int atlasBorder() const;
+
+    // Upload textures of the same size and format as the layers of arrays,
+    // split at the context's layer limit
+    void packArrays(const std::vector<const Source *> &group, const TextureSampling &sampling);
+
+    // Shelf pack textures with the same channels into pages and upload them
+    // as the layers of an array
+    void packAtlas(const std::vector<const Source *> &group, const TextureSampling &sampling);
+
+    // Store an array and its size
+    TextureHandle store(GLTexture texture, size_t bytes);
+};
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <utility>
+#include <chrono>
+
+#include "texturebatch.hpp"
+#include "compressedtexture.hpp"
+
+TextureBatch::TextureBatch(ThreadPool &pool) : pool(pool)
+{
+}
+
+TextureBatch::~TextureBatch()
+{
+    // Wait for the workers still writing into the images
+    for (size_t i = 0; i < pending.size(); i++)
+        if (pending[i].decoded.valid())
+            pending[i].decoded.wait();
+}
+
+TextureBatch::Pending &TextureBatch::queue(const MaterialTexture &texture, TextureCompression compression,
+                                           const MipSettings &mips)
+{
+    // The wall clock time of the batch starts at the first decode
+    if (pending.empty())
+        start = std::chrono::steady_clock::now();
+
+    Pending entry;
+    entry.path = texture.specularPath.empty() ? texture.path : texture.path + "+" + texture.specularPath;
+    entry.name = texture.name();
+    entry.compression = compression;
+    entry.mips = mips;
+
+    // Share a texture that is already loaded
+    entry.cached = TextureCache::global().find(entry.name.c_str(), compression, TextureSampling(), mips);
+    if (entry.cached)
+    {
+        pending.push_back(std::move(entry));
+        return pending.back();
+    }
+
+    entry.decoded = pool.submit([texture, compression, mips]()
+    {
+        auto decodeStart = std::chrono::steady_clock::now();
+        Decoded decoded;
+        loadMaterialTexture(texture, compression, mips, decoded.compressed, decoded.mips);
+        decoded.milliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - decodeStart).count();
+        return decoded;
+    });
+    pending.push_back(std::move(entry));
+    return pending.back();
+}
+
+size_t TextureBatch::add(const char *path, TextureCompression compression, const MipSettings &mips)
+{
+    MaterialTexture texture;
+    texture.path = path;
+    Pending &entry = queue(texture, compression, mips);
+    entry.slot = textures.size();
+    textures.push_back(TextureHandle());
+    return entry.slot;
+}
+
+void TextureBatch::add(Model &model, const char *path, const std::string type)
+{
+    // Reserve the model's slot now so textures keep the order they were added in
+    MaterialTexture texture;
+    texture.path = path;
+    Pending &entry = queue(texture, model.textureCompression(type), model.mipSettings(type));
+    entry.model = &model;
+    entry.slot  = model.addTexture(0u, type);
+}
+
+void TextureBatch::addMaterial(Model &model, const char *diffusePath, const char *specularPath,
+                               const char *normalPath)
+{
+    MaterialTexture diffuse;
+    diffuse.path = diffusePath;
+    diffuse.specularPath = specularPath;
+    Pending &entry = queue(diffuse, model.materialCompression("diffuse"), model.mipSettings("diffuse"));
+    entry.model = &model;
+    entry.slot  = model.addTexture(0u, "diffuse");
+
+    MaterialTexture normal;
+    normal.path = normalPath;
+    normal.normalMap = true;
+    Pending &normalEntry = queue(normal, model.materialCompression("normal"), model.mipSettings("normal"));
+    normalEntry.model = &model;
+    normalEntry.slot  = model.addTexture(0u, "normal");
+}
+
+void TextureBatch::upload()
+{
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        Pending &entry = pending[i];
+        TextureLoadStats stat;
+        stat.path = entry.path;
+
+        TextureHandle texture = entry.cached;
+        if (texture)
+            stat.cached = true;
+        else
+        {
+            Decoded decoded = entry.decoded.get();
+            MipChain &mips = decoded.mips;
+            CompressedTexture &compressed = decoded.compressed;
+            bool isCompressed = !compressed.levels.empty();
+            if (!isCompressed && mips.levels.empty())
+                printf("Texture %s failed to load.\n", entry.path.c_str());
+            mips.settings    = entry.mips;
+            stat.width       = isCompressed ? compressed.width  : mips.width;
+            stat.height      = isCompressed ? compressed.height : mips.height;
+            stat.channels    = isCompressed ? 0 : mips.channels;
+            stat.compression = isCompressed ? compressed.format : TextureCompression::None;
+            stat.decodeMs    = decoded.milliseconds;
+
+            // Upload in the order the textures were added
+            auto uploadStart = std::chrono::steady_clock::now();
+            if (isCompressed)
+                texture = TextureCache::global().insert(entry.name.c_str(), entry.compression, std::move(compressed));
+            else
+                texture = TextureCache::global().insert(entry.name.c_str(), std::move(mips));
+            stat.uploadMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - uploadStart).count();
+        }
+
+        if (entry.model)
+            entry.model->setTexture(entry.slot, texture);
+        else
+            textures[entry.slot] = texture;
+        stats.push_back(stat);
+    }
+
+    if (!pending.empty())
+        wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    pending.clear();
+}
+
+void TextureBatch::printStats() const
+{
+    double decodeMs = 0.0, uploadMs = 0.0;
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        const TextureLoadStats &stat = stats[i];
+        if (stat.cached)
+            printf("  %-36s shared from the texture cache\n", stat.path.c_str());
+        else if (stat.compression != TextureCompression::None)
+            printf("  %-36s %5d x %-5d %s  decode %7.1f ms  upload %6.1f ms\n", stat.path.c_str(),
+                   stat.width, stat.height, compressionName(stat.compression), stat.decodeMs, stat.uploadMs);
+        else
+            printf("  %-36s %5d x %-5d x %d  decode %7.1f ms  upload %6.1f ms\n", stat.path.c_str(),
+                   stat.width, stat.height, stat.channels, stat.decodeMs, stat.uploadMs);
+        decodeMs += stat.decodeMs;
+        uploadMs += stat.uploadMs;
+    }
+    printf("%zu textures: decode %.1f ms on %u threads, upload %.1f ms, %.1f ms in total\n",
+           stats.size(), decodeMs, pool.size(), uploadMs, wallMs);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <future>
+#include <chrono>
+
+#include "model.hpp"
+#include "image.hpp"
+#include "material.hpp"
+#include "texturecache.hpp"
+#include "threadpool.hpp"
+
+// Time spent loading one texture
+struct TextureLoadStats
+{
+    std::string path;
+    int width = 0, height = 0, channels = 0;
+    bool cached = false;        // already alive in the texture cache
+    TextureCompression compression = TextureCompression::None;
+    double decodeMs = 0.0;      // on a worker thread, reading or writing the
+                                // compressed or mipmap cache
+    double uploadMs = 0.0;      // on the GL context thread
+};
+
+// Loads a set of textures at once. Every image is decoded concurrently on
+// a thread pool as soon as it's added; upload() then waits for them and
+// creates the GL textures in the order they were added. Textures already
+// in the global texture cache are shared rather than decoded again.
+class TextureBatch
+{
+public:
+    // Textures added without a model, in the order they were added
+    std::vector<TextureHandle> textures;
+
+    // Decode and upload times, in the order the textures were added
+    std::vector<TextureLoadStats> stats;
+
+    TextureBatch(ThreadPool &pool = ThreadPool::global());
+    ~TextureBatch();
+
+    TextureBatch(const TextureBatch &) = delete;
+    TextureBatch &operator=(const TextureBatch &) = delete;
+
+    // Start decoding a texture, returns its index in textures
+    size_t add(const char *path, TextureCompression compression = TextureCompression::None,
+               const MipSettings &mips = MipSettings());
+
+    // Start decoding a texture for a model, which holds a reference to it
+    // once it's uploaded. The model's settings choose the compression and
+    // mipmaps. The model must outlive the batch.
+    void add(Model &model, const char *path, const std::string type);
+
+    // Start decoding the textures of a packed material for a model, as
+    // Model::addMaterial() does
+    void addMaterial(Model &model, const char *diffusePath, const char *specularPath, const char *normalPath);
+
+    // Wait for the decodes and create the GL textures. Must be called on the
+    // thread owning the GL context.
+    void upload();
+
+    // Print the decode and upload time of every texture
+    void printStats() const;
+
+private:
+    struct Decoded
+    {
+        MipChain          mips;
+        CompressedTexture compressed;   // used instead of mips if it has levels
+        double            milliseconds = 0.0;
+    };
+
+    struct Pending
+    {
+        std::string          path;
+        std::string          name;  // shared under in the texture cache
+        Model               *model = NULL;
+        size_t               slot  = 0;     // in the model's textures, or in textures
+        TextureCompression   compression = TextureCompression::None;
+        MipSettings          mips;
+        TextureHandle        cached;
+        std::future<Decoded> decoded;
+    };
+
+    ThreadPool          &pool;
+    std::vector<Pending> pending;
+
+    // Wall clock time from the first decode to the last upload
+    std::chrono::steady_clock::time_point start;
+    double wallMs = 0.0;
+
+    // Queue the decode of a texture
+    Pending &queue(const MaterialTexture &texture, TextureCompression compression, const MipSettings &mips);
+};
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <utility>
+#include <stdlib.h>
+
+#include "texturecache.hpp"
+#include "compressedtexture.hpp"
+#include "textureuploader.hpp"
+
+std::string TextureCache::canonicalPath(const char *path)
+{
+#ifdef _WIN32
+    char resolved[_MAX_PATH];
+    if (_fullpath(resolved, path, _MAX_PATH))
+        return resolved;
+#else
+    char *resolved = realpath(path, NULL);
+    if (resolved)
+    {
+        std::string canonical(resolved);
+        free(resolved);
+        return canonical;
+    }
+#endif
+    return path;
+}
+
+std::string TextureCache::key(const std::string &canonical, TextureCompression compression,
+                              const TextureSampling &sampling, const MipSettings &mips)
+{
+    // The compression format decides how compressed mipmaps are built
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), "|%d|%x|%x|%x|", static_cast<int>(compression),
+             sampling.wrap, sampling.minFilter, sampling.magFilter);
+    if (compression == TextureCompression::None)
+        return canonical + suffix + mipSettingsName(mips);
+    return canonical + suffix;
+}
+
+TextureHandle TextureCache::lookup(const std::string &key)
+{
+    auto found = textures.find(key);
+    if (found == textures.end())
+        return TextureHandle();
+    TextureHandle texture = found->second.lock();
+    if (!texture)
+        textures.erase(found);
+    return texture;
+}
+
+TextureHandle TextureCache::store(const std::string &key, std::shared_ptr<SharedTexture> texture)
+{
+    misses++;
+
+    // Files that failed to load get an empty texture each time
+    if (texture->bytes > 0)
+        textures[key] = texture;
+    return texture;
+}
+
+TextureHandle TextureCache::find(const char *path, TextureCompression compression,
+                                 const TextureSampling &sampling, const MipSettings &mips)
+{
+    TextureHandle texture = lookup(key(canonicalPath(path), compression, sampling, mips));
+    if (texture)
+        hits++;
+    return texture;
+}
+
+TextureHandle TextureCache::insert(const char *path, MipChain chain, const TextureSampling &sampling)
+{
+    std::string canonical = canonicalPath(path);
+    std::string textureKey = key(canonical, TextureCompression::None, sampling, chain.settings);
+    TextureHandle existing = lookup(textureKey);
+    if (existing)
+    {
+        hits++;
+        return existing;
+    }
+
+    std::shared_ptr<SharedTexture> texture = std::make_shared<SharedTexture>();
+    texture->path    = canonical;
+    texture->bytes   = textureBytes(chain);
+    if (uploader)
+        uploader->upload(texture, std::move(chain), sampling);
+    else
+        texture->texture = uploadTexture(chain, sampling);
+    return store(textureKey, texture);
+}
+
+TextureHandle TextureCache::insert(const char *path, TextureCompression compression,
+                                   CompressedTexture compressed, const TextureSampling &sampling)
+{
+    std::string canonical = canonicalPath(path);
+    std::string textureKey = key(canonical, compression, sampling, MipSettings());
+    TextureHandle existing = lookup(textureKey);
+    if (existing)
+    {
+        hits++;
+        return existing;
+    }
+
+    std::shared_ptr<SharedTexture> texture = std::make_shared<SharedTexture>();
+    texture->path    = canonical;
+    texture->bytes   = compressed.bytes();
+    if (uploader)
+        uploader->upload(texture, std::move(compressed), sampling);
+    else
+        texture->texture = uploadCompressedTexture(compressed, sampling);
+    return store(textureKey, texture);
+}
+
+TextureHandle TextureCache::load(const char *path, TextureCompression compression,
+                                 const TextureSampling &sampling, const MipSettings &mips)
+{
+    TextureHandle texture = find(path, compression, sampling, mips);
+    if (texture)
+        return texture;
+
+    CompressedTexture compressed;
+    if (compression != TextureCompression::None && loadCompressedTexture(path, compression, compressed))
+        return insert(path, compression, std::move(compressed), sampling);
+
+    MipChain chain;
+    if (!loadMipChain(path, mips, chain))
+        printf("Texture %s failed to load.\n", path);
+    chain.settings = mips;
+    return insert(path, std::move(chain), sampling);
+}
+
+TextureHandle TextureCache::load(const MaterialTexture &texture, TextureCompression compression,
+                                 const TextureSampling &sampling, const MipSettings &mips)
+{
+    // Packed diffuse maps are stored under BC3, which they are compressed to
+    std::string name = texture.name();
+    if (!texture.specularPath.empty() && compression != TextureCompression::None)
+        compression = TextureCompression::BC3;
+    TextureHandle cached = find(name.c_str(), compression, sampling, mips);
+    if (cached)
+        return cached;
+
+    CompressedTexture compressed;
+    MipChain chain;
+    if (!loadMaterialTexture(texture, compression, mips, compressed, chain))
+        printf("Texture %s failed to load.\n", name.c_str());
+    if (!compressed.levels.empty())
+        return insert(name.c_str(), compression, std::move(compressed), sampling);
+    chain.settings = mips;
+    return insert(name.c_str(), std::move(chain), sampling);
+}
+
+TextureCacheStats TextureCache::stats()
+{
+    TextureCacheStats stats;
+    stats.hits   = hits;
+    stats.misses = misses;
+
+    // Drop the entries of released textures while counting the live ones
+    for (auto entry = textures.begin(); entry != textures.end();)
+    {
+        TextureHandle texture = entry->second.lock();
+        if (!texture)
+        {
+            entry = textures.erase(entry);
+            continue;
+        }
+        stats.textures++;
+        stats.bytes += texture->bytes;
+        ++entry;
+    }
+    return stats;
+}
+
+TextureCache &TextureCache::global()
+{
+    static TextureCache cache;
+    return cache;
+}
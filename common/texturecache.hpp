@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+#include "image.hpp"
+#include "ktx.hpp"
+#include "material.hpp"
+#include "glhandle.hpp"
+
+class TextureUploader;
+
+// A GL texture shared by everything using the same file and sampling. The
+// texture is deleted when the last handle to it is released.
+struct SharedTexture
+{
+    GLTexture   texture;
+    std::string path;       // canonical path of the file
+    size_t      bytes = 0;  // video memory
+};
+
+typedef std::shared_ptr<const SharedTexture> TextureHandle;
+
+// Counters of a texture cache
+struct TextureCacheStats
+{
+    size_t hits     = 0;    // requests served by a texture already loaded
+    size_t misses   = 0;    // requests that created a texture
+    size_t textures = 0;    // textures currently alive
+    size_t bytes    = 0;    // video memory of the textures alive
+};
+
+// Textures keyed by canonical file path, compression, sampling and mipmap
+// settings, so that a file used by several models is decoded and uploaded
+// once. The cache only holds weak references; the textures belong to the
+// handles given out. Must be used on the thread owning the GL context.
+class TextureCache
+{
+public:
+    TextureCache() {}
+    TextureCache(const TextureCache &) = delete;
+    TextureCache &operator=(const TextureCache &) = delete;
+
+    // Texture for a file, loading and uploading it on a miss. Compressed
+    // textures come from the KTX2 cache next to the file, or are compressed
+    // and cached; if that fails the file is loaded uncompressed, with its
+    // mipmaps also read from a KTX2 cache or built and cached.
+    TextureHandle load(const char *path, TextureCompression compression = TextureCompression::None,
+                       const TextureSampling &sampling = TextureSampling(),
+                       const MipSettings &mips = MipSettings());
+
+    // Texture of a packed material, loaded as load() does and shared under
+    // the texture's name. Packed diffuse maps are compressed to BC3 whatever
+    // the compression, as long as it isn't None.
+    TextureHandle load(const MaterialTexture &texture, TextureCompression compression = TextureCompression::None,
+                       const TextureSampling &sampling = TextureSampling(),
+                       const MipSettings &mips = MipSettings());
+
+    // Texture for a file if it's alive, otherwise an empty handle. Counts as
+    // a hit when found; a miss is counted by the insert that follows.
+    TextureHandle find(const char *path, TextureCompression compression = TextureCompression::None,
+                       const TextureSampling &sampling = TextureSampling(),
+                       const MipSettings &mips = MipSettings());
+
+    // Upload a mipmap chain loaded elsewhere, e.g. on a worker thread. If the
+    // same texture became alive in the meantime that one is returned instead.
+    TextureHandle insert(const char *path, MipChain chain,
+                         const TextureSampling &sampling = TextureSampling());
+
+    // Upload a texture compressed elsewhere, stored under the compression
+    // asked for
+    TextureHandle insert(const char *path, TextureCompression compression,
+                         CompressedTexture texture,
+                         const TextureSampling &sampling = TextureSampling());
+
+    // Stream new textures through an uploader rather than uploading them at
+    // once, or upload at once again if NULL. The textures can be drawn
+    // straight away, at a lower resolution until the uploader catches up.
+    void setUploader(TextureUploader *uploader) { this->uploader = uploader; }
+
+    // Current counters
+    TextureCacheStats stats();
+
+    // Cache shared by the whole program
+    static TextureCache &global();
+
+    // Absolute path of a file with links and . and .. resolved, or the path
+    // unchanged if it doesn't exist
+    static std::string canonicalPath(const char *path);
+
+private:
+    std::unordered_map<std::string, std::weak_ptr<const SharedTexture>> textures;
+    size_t hits   = 0;
+    size_t misses = 0;
+    TextureUploader *uploader = NULL;
+
+    // Key of a file, compression, sampling and, for uncompressed textures,
+    // mipmap settings
+    static std::string key(const std::string &canonical, TextureCompression compression,
+                           const TextureSampling &sampling, const MipSettings &mips);
+
+    // Store a new texture, unless it's empty because its file failed to load
+    TextureHandle store(const std::string &key, std::shared_ptr<SharedTexture> texture);
+
+    // Live texture for a key, if any
+    TextureHandle lookup(const std::string &key);
+};
@@ -0,0 +1,583 @@
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+
+#include "textureuploader.hpp"
+#include "texturecache.hpp"
+#include "compressedtexture.hpp"
+#include "blockcompress.hpp"
+#include "glextensions.hpp"
+
+TextureUploader::TextureUploader(size_t stagingBytes, unsigned int regions, int tailSize)
+    : stagingBytes(stagingBytes), regions(regions > 0 ? regions : 1), tailSize(tailSize)
+{
+}
+
+TextureUploader::~TextureUploader()
+{
+    // Deleting the buffer unmaps it
+    if (onGLContextThread())
+        for (size_t i = 0; i < fences.size(); i++)
+            if (fences[i])
+                glDeleteSync(fences[i]);
+}
+
+int TextureUploader::levelWidth(const Entry &entry, int level) const
+{
+    int size = entry.width >> level;
+    return size > 0 ? size : 1;
+}
+
+int TextureUploader::levelHeight(const Entry &entry, int level) const
+{
+    int size = entry.height >> level;
+    return size > 0 ? size : 1;
+}
+
+int TextureUploader::levelRows(const Entry &entry, int level) const
+{
+    int height = levelHeight(entry, level);
+    return entry.type == 0 ? (height + 3) / 4 : height;
+}
+
+size_t TextureUploader::rowBytes(const Entry &entry, int level) const
+{
+    int width = levelWidth(entry, level);
+    if (entry.type == 0)
+        return static_cast<size_t>((width + 3) / 4) * entry.texelBytes;
+    return static_cast<size_t>(width) * entry.texelBytes;
+}
+
+size_t TextureUploader::levelBytes(const Entry &entry, int level) const
+{
+    // Drivers pad three channel texels to four, as textureBytes() assumes
+    size_t bytes = (*entry.levels)[level].size();
+    return entry.type != 0 && entry.texelBytes == 3 ? bytes / 3 * 4 : bytes;
+}
+
+void TextureUploader::upload(const std::shared_ptr<SharedTexture> &texture, MipChain chain,
+                             const TextureSampling &sampling)
+{
+    upload(texture, std::shared_ptr<const MipChain>(std::make_shared<MipChain>(std::move(chain))), sampling);
+}
+
+void TextureUploader::upload(const std::shared_ptr<SharedTexture> &texture, CompressedTexture compressed,
+                             const TextureSampling &sampling)
+{
+    upload(texture, std::shared_ptr<const CompressedTexture>(
+        std::make_shared<CompressedTexture>(std::move(compressed))), sampling);
+}
+
+void TextureUploader::upload(const std::shared_ptr<SharedTexture> &texture,
+                             const std::shared_ptr<const MipChain> &chain, const TextureSampling &sampling)
+{
+    texture->texture = GLTexture::create();
+    if (chain->levels.empty())
+        return;
+
+    // Sized internal formats, as texture storage needs them
+    Entry entry;
+    entry.owner      = chain;
+    entry.levels     = &chain->levels;
+    entry.width      = chain->width;
+    entry.height     = chain->height;
+    entry.texelBytes = static_cast<size_t>(chain->channels);
+    entry.type       = GL_UNSIGNED_BYTE;
+    entry.format     = GL_RGB;
+    entry.internalFormat = GL_RGB8;
+    if (chain->channels == 1)
+    {
+        entry.format = GL_RED;
+        entry.internalFormat = GL_R8;
+    }
+    else if (chain->channels == 2)
+    {
+        entry.format = GL_RG;
+        entry.internalFormat = GL_RG8;
+    }
+    else if (chain->channels == 4)
+    {
+        entry.format = GL_RGBA;
+        entry.internalFormat = GL_RGBA8;
+    }
+    entry.sampling = sampling;
+    createTexture(texture, entry);
+}
+
+void TextureUploader::upload(const std::shared_ptr<SharedTexture> &texture,
+                             const std::shared_ptr<const CompressedTexture> &compressed,
+                             const TextureSampling &sampling)
+{
+    texture->texture = GLTexture::create();
+    if (compressed->levels.empty())
+        return;
+
+    Entry entry;
+    entry.owner      = compressed;
+    entry.levels     = &compressed->levels;
+    entry.width      = compressed->width;
+    entry.height     = compressed->height;
+    entry.texelBytes = blockBytes(compressed->format);
+    entry.internalFormat = compressedInternalFormat(compressed->format);
+    entry.format     = entry.internalFormat;
+    entry.type       = 0;
+    entry.sampling   = sampling;
+
+    // Specular maps are read as a colour, as in uploadCompressedTexture
+    entry.swizzleRed = compressed->format == TextureCompression::BC4;
+    createTexture(texture, entry);
+}
+
+size_t TextureUploader::storageBytes(const Entry &entry, int top) const
+{
+    size_t bytes = 0;
+    for (int level = top; level < entry.levelCount; level++)
+        bytes += levelBytes(entry, level);
+    return bytes;
+}
+
+GLTexture TextureUploader::allocate(const Entry &entry, int top, int base)
+{
+    GLTexture texture = GLTexture::create();
+    glBindTexture(GL_TEXTURE_2D, texture.get());
+
+    // Without immutable storage the largest level goes first, so drivers
+    // size the texture from it
+    int count = entry.levelCount - top;
+    static const bool textureStorage = GLEW_VERSION_4_2 || hasExtension("GL_ARB_texture_storage");
+    if (textureStorage)
+        glTexStorage2D(GL_TEXTURE_2D, count, entry.internalFormat, levelWidth(entry, top), levelHeight(entry, top));
+    else
+        for (int level = top; level < entry.levelCount; level++)
+        {
+            if (entry.type == 0)
+                glCompressedTexImage2D(GL_TEXTURE_2D, level - top, entry.internalFormat, levelWidth(entry, level),
+                                       levelHeight(entry, level), 0,
+                                       static_cast<GLsizei>((*entry.levels)[level].size()), NULL);
+            else
+                glTexImage2D(GL_TEXTURE_2D, level - top, entry.internalFormat, levelWidth(entry, level),
+                             levelHeight(entry, level), 0, entry.format, entry.type, NULL);
+        }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, count - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base - top);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, entry.sampling.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, entry.sampling.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, entry.sampling.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, entry.sampling.magFilter);
+    if (entry.swizzleRed)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+    return texture;
+}
+
+void TextureUploader::createTexture(const std::shared_ptr<SharedTexture> &texture, Entry &entry)
+{
+    entry.texture    = texture;
+    entry.levelCount = usesMipmaps(entry.sampling) ? static_cast<int>(entry.levels->size()) : 1;
+    entry.lastUsed   = frame;
+    entry.order      = uploads++;
+
+    // The mip tail is every level fitting in tailSize, and at least the
+    // coarsest level so the texture is complete
+    int tail = entry.levelCount;
+    while (tail > 0 && levelWidth(entry, tail - 1) <= tailSize && levelHeight(entry, tail - 1) <= tailSize)
+        tail--;
+    entry.tail     = tail < entry.levelCount ? tail : entry.levelCount - 1;
+    entry.top      = entry.tail;
+    entry.resident = entry.tail;
+    entry.wanted   = residency.onDemand ? entry.tail : 0;
+
+    // Upload the mip tail straight from client memory, so the texture can
+    // be drawn before the larger levels arrive
+    texture->texture = allocate(entry, entry.tail, entry.tail);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = entry.levelCount - 1; level >= entry.tail; level--)
+        copyRows(entry, level, 0, levelRows(entry, level), (*entry.levels)[level].data(),
+                 (*entry.levels)[level].size());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    entry.bytes    = storageBytes(entry, entry.tail);
+    texture->bytes = entry.bytes;
+
+    // A new texture may reuse the address of one released since the last
+    // update
+    auto found = entries.find(texture.get());
+    if (found != entries.end())
+        counters.resident -= found->second.bytes;
+    counters.resident += entry.bytes;
+    entries[texture.get()] = entry;
+}
+
+void TextureUploader::reallocate(Entry &entry, int top)
+{
+    std::shared_ptr<SharedTexture> texture = entry.texture.lock();
+    int oldTop = entry.top;
+
+    // Levels kept, including one partly copied if it still fits
+    int resident = entry.resident > top ? entry.resident : top;
+    int first = resident;
+    if (entry.row > 0 && entry.resident - 1 >= top)
+        first = entry.resident - 1;
+    else
+        entry.row = 0;
+
+    GLTexture created = allocate(entry, top, resident);
+    entry.top      = top;
+    entry.resident = resident;
+
+    // Copy on the GPU if possible, otherwise from system memory
+    static const bool copyImage = GLEW_VERSION_4_3 || hasExtension("GL_ARB_copy_image");
+    for (int level = first; level < entry.levelCount; level++)
+    {
+        if (copyImage)
+            glCopyImageSubData(texture->texture.get(), GL_TEXTURE_2D, level - oldTop, 0, 0, 0,
+                               created.get(), GL_TEXTURE_2D, level - top, 0, 0, 0,
+                               levelWidth(entry, level), levelHeight(entry, level), 1);
+        else
+            copyRows(entry, level, 0, levelRows(entry, level), (*entry.levels)[level].data(),
+                     (*entry.levels)[level].size());
+    }
+    texture->texture = std::move(created);
+
+    size_t bytes = storageBytes(entry, top);
+    counters.resident = counters.resident - entry.bytes + bytes;
+    counters.reallocs++;
+    if (top > oldTop)
+        counters.dropped += top - oldTop;
+    entry.bytes    = bytes;
+    texture->bytes = bytes;
+}
+
+int TextureUploader::levelForSize(const Entry &entry, float screenSize) const
+{
+    float texels = static_cast<float>(entry.width > entry.height ? entry.width : entry.height);
+    if (!(screenSize > 0.0f))
+        return entry.tail;
+    if (screenSize >= texels)
+        return 0;
+    int level = static_cast<int>(floorf(log2f(texels / screenSize)));
+    return level < entry.tail ? level : entry.tail;
+}
+
+void TextureUploader::request(const std::shared_ptr<const SharedTexture> &texture, float screenSize)
+{
+    auto found = entries.find(texture.get());
+    if (found == entries.end())
+        return;
+
+    // The first request of a frame replaces the level asked for before
+    Entry &entry = found->second;
+    int level = residency.onDemand ? levelForSize(entry, screenSize) : 0;
+    if (entry.lastUsed != frame || level < entry.wanted)
+        entry.wanted = level;
+    entry.lastUsed = frame;
+}
+
+bool TextureUploader::evict(size_t bytes, size_t before, const Entry *keep)
+{
+    // Textures with levels that can go, and how much would be freed
+    struct Victim
+    {
+        Entry *entry;
+        int    floor;   // finest level to keep
+    };
+    std::vector<Victim> victims;
+    size_t available = 0;
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        Entry &entry = it->second;
+        if (&entry == keep || entry.texture.expired())
+            continue;
+        Victim victim = { &entry, entry.lastUsed < before ? entry.tail : entry.wanted };
+        if (entry.top >= victim.floor)
+            continue;
+        available += entry.bytes - storageBytes(entry, victim.floor);
+        victims.push_back(victim);
+    }
+    if (available < bytes)
+        return false;
+
+    // Least recently used first, each freeing no more levels than needed
+    std::sort(victims.begin(), victims.end(), [](const Victim &a, const Victim &b)
+    {
+        return a.entry->lastUsed < b.entry->lastUsed;
+    });
+    size_t freed = 0;
+    for (size_t i = 0; i < victims.size() && freed < bytes; i++)
+    {
+        Entry &entry = *victims[i].entry;
+        int top = entry.top + 1;
+        while (top < victims[i].floor && entry.bytes - storageBytes(entry, top) < bytes - freed)
+            top++;
+        freed += entry.bytes - storageBytes(entry, top);
+        reallocate(entry, top);
+    }
+    return true;
+}
+
+void TextureUploader::copyRows(const Entry &entry, int level, int row, int rows, const void *pixels, size_t bytes)
+{
+    int width = levelWidth(entry, level);
+    int target = level - entry.top;
+    if (entry.type == 0)
+    {
+        // Rows of blocks, the last of which may be cut short by the level
+        int y = 4 * row;
+        int height = levelHeight(entry, level) - y;
+        height = height < 4 * rows ? height : 4 * rows;
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, target, 0, y, width, height, entry.format,
+                                  static_cast<GLsizei>(bytes), pixels);
+    }
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, target, 0, row, width, rows, entry.format, entry.type, pixels);
+}
+
+void TextureUploader::createStaging()
+{
+    if (buffer)
+        return;
+
+    fences.assign(regions, static_cast<GLsync>(0));
+    buffer = GLBuffer::create();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.get());
+    static const bool bufferStorage = GLEW_VERSION_4_4 || hasExtension("GL_ARB_buffer_storage");
+    if (bufferStorage)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, stagingBytes, NULL, flags);
+        mapped = static_cast<uint8_t *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, stagingBytes, flags));
+
+        // Immutable storage can't be respecified, so start again if the
+        // mapping failed
+        if (!mapped)
+        {
+            buffer = GLBuffer::create();
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.get());
+        }
+    }
+    if (!mapped)
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, stagingBytes, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureUploader::fenceRegion()
+{
+    // Only the persistent mapping reuses memory the GPU may still be reading
+    if (!mapped || offset == 0 || !dirty)
+        return;
+    if (fences[region])
+        glDeleteSync(fences[region]);
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    dirty = false;
+}
+
+bool TextureUploader::reserve(size_t bytes, size_t &at)
+{
+    // Keep copies 16 byte aligned
+    size_t regionBytes = stagingBytes / regions;
+    size_t start = (offset + 15) & ~static_cast<size_t>(15);
+    if (start + bytes > regionBytes)
+    {
+        fenceRegion();
+        unsigned int next = (region + 1) % regions;
+        if (mapped && fences[next])
+        {
+            GLenum status = glClientWaitSync(fences[next], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+                return false;
+            glDeleteSync(fences[next]);
+            fences[next] = 0;
+        }
+        else if (!mapped && next == 0)
+        {
+            // Orphan the buffer, the GPU keeps reading the old storage
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, stagingBytes, NULL, GL_STREAM_DRAW);
+        }
+        region = next;
+        start  = 0;
+    }
+
+    at     = region * regionBytes + start;
+    offset = start + bytes;
+    dirty  = true;
+    return true;
+}
+
+size_t TextureUploader::stream(size_t budgetBytes)
+{
+    auto start = std::chrono::steady_clock::now();
+    stalled = false;
+
+    // Forget released textures, their levels went with them
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (it->second.texture.expired())
+        {
+            counters.resident -= it->second.bytes;
+            it = entries.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    // Shrink to a budget lowered since the last update
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (residency.budgetBytes > 0 && counters.resident > residency.budgetBytes)
+        evict(counters.resident - residency.budgetBytes, frame, NULL);
+
+    // Textures with levels to copy, the most recently requested first, then
+    // the lowest resolution so that the textures sharpen together
+    std::vector<Entry *> queue;
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+        if (it->second.wanted < it->second.resident)
+            queue.push_back(&it->second);
+    if (queue.empty())
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        return 0;
+    }
+    std::sort(queue.begin(), queue.end(), [this](const Entry *a, const Entry *b)
+    {
+        if (a->lastUsed != b->lastUsed)
+            return a->lastUsed > b->lastUsed;
+        int sizeA = std::max(levelWidth(*a, a->resident), levelHeight(*a, a->resident));
+        int sizeB = std::max(levelWidth(*b, b->resident), levelHeight(*b, b->resident));
+        if (sizeA != sizeB)
+            return sizeA < sizeB;
+        return a->order < b->order;
+    });
+
+    createStaging();
+    size_t regionBytes = stagingBytes / regions;
+    size_t copied = 0;
+    for (size_t i = 0; i < queue.size() && copied < budgetBytes && !stalled; i++)
+    {
+        Entry &entry = *queue[i];
+        std::shared_ptr<SharedTexture> texture = entry.texture.lock();
+        while (entry.wanted < entry.resident && copied < budgetBytes)
+        {
+            // Move to storage down to the level asked for before copying
+            // finer levels, or as close to it as the budget allows after
+            // freeing levels of textures used less recently
+            int level = entry.resident - 1;
+            if (level < entry.top)
+            {
+                int top = entry.wanted;
+                for (; residency.budgetBytes > 0 && top < entry.top; top++)
+                {
+                    size_t needed = counters.resident + storageBytes(entry, top) - entry.bytes;
+                    if (needed <= residency.budgetBytes ||
+                        evict(needed - residency.budgetBytes, entry.lastUsed, &entry))
+                        break;
+                }
+                if (top >= entry.top)
+                    break;
+                reallocate(entry, top);
+            }
+
+            // As many rows as the budget and a region of the ring allow, and
+            // at least one
+            const std::vector<uint8_t> &pixels = (*entry.levels)[level];
+            size_t bytesPerRow = rowBytes(entry, level);
+            size_t limit = budgetBytes - copied < regionBytes ? budgetBytes - copied : regionBytes;
+            int rows = levelRows(entry, level) - entry.row;
+            if (static_cast<size_t>(rows) * bytesPerRow > limit)
+                rows = limit / bytesPerRow > 0 ? static_cast<int>(limit / bytesPerRow) : 1;
+            size_t bytes = static_cast<size_t>(rows) * bytesPerRow;
+            const uint8_t *source = pixels.data() + entry.row * bytesPerRow;
+
+            glBindTexture(GL_TEXTURE_2D, texture->texture.get());
+            if (bytes > regionBytes)
+            {
+                // A row larger than a region goes straight from client memory
+                copyRows(entry, level, entry.row, rows, source, bytes);
+            }
+            else
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.get());
+                size_t at;
+                if (!reserve(bytes, at))
+                {
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                    stalled = true;
+                    counters.stalls++;
+                    break;
+                }
+                if (mapped)
+                    memcpy(mapped + at, source, bytes);
+                else
+                {
+                    void *target = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, at, bytes, GL_MAP_WRITE_BIT |
+                                                    GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+                    if (target)
+                        memcpy(target, source, bytes);
+                    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                }
+                copyRows(entry, level, entry.row, rows, reinterpret_cast<const void *>(at), bytes);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+            copied += bytes;
+            counters.copies++;
+
+            // Sample the level once it's complete
+            entry.row += rows;
+            if (entry.row == levelRows(entry, level))
+            {
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - entry.top);
+                entry.resident = level;
+                entry.row      = 0;
+            }
+        }
+    }
+    fenceRegion();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (copied > 0)
+    {
+        counters.frames++;
+        counters.bytes += copied;
+        counters.peakBytes = copied > counters.peakBytes ? copied : counters.peakBytes;
+    }
+    counters.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return copied;
+}
+
+size_t TextureUploader::update(size_t budgetBytes)
+{
+    size_t copied = stream(budgetBytes);
+    frame++;
+    return copied;
+}
+
+void TextureUploader::finish()
+{
+    for (;;)
+    {
+        size_t copied = stream(static_cast<size_t>(-1));
+
+        // Wait for the GPU to finish reading the region the ring is stuck on
+        unsigned int next = (region + 1) % regions;
+        if (stalled && fences[next])
+            glClientWaitSync(fences[next], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        else if (copied == 0)
+            break;
+    }
+}
+
+size_t TextureUploader::pending() const
+{
+    size_t count = 0;
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+        if (it->second.wanted < it->second.resident && !it->second.texture.expired())
+            count++;
+    return count;
+}
+
+TextureUploader &TextureUploader::global()
+{
+    static TextureUploader uploader;
+    return uploader;
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "glhandle.hpp"
+#include "image.hpp"
+#include "ktx.hpp"
+
+struct SharedTexture;
+
+// Counters of a texture uploader
+struct TextureUploadStats
+{
+    size_t bytes     = 0;   // copied through the staging buffer
+    size_t copies    = 0;   // glTexSubImage2D calls from the staging buffer
+    size_t stalls    = 0;   // updates cut short by staging memory still in use
+    size_t frames    = 0;   // updates that copied anything
+    size_t peakBytes = 0;   // most bytes copied by one update
+    size_t dropped   = 0;   // levels freed to stay within the budget
+    size_t reallocs  = 0;   // textures moved to storage for more or fewer levels
+    size_t resident  = 0;   // video memory of the levels allocated now
+    double milliseconds = 0.0;
+};
+
+// Which levels of the streamed textures are kept in video memory
+struct TextureResidency
+{
+    // Stream the levels finer than the mip tail only once request() asks
+    // for them, rather than every level straight away
+    bool onDemand = false;
+
+    // Video memory the streamed textures may use, 0 for no limit. Levels of
+    // the textures requested least recently are freed to make room, down to
+    // their mip tail, which always stays.
+    size_t budgetBytes = 0;
+};
+
+// Streams textures to the GPU a few megabytes a frame instead of in one
+// synchronous glTexImage2D. upload() creates the texture with the small
+// levels of its mip tail, so it can be drawn at once; update() then copies
+// the larger levels, coarsest first, through a ring of staging memory in a
+// pixel buffer object, and lowers the texture's base level as each level
+// completes. The ring is persistently mapped when the context has
+// ARB_buffer_storage and orphaned when it wraps otherwise. Each region of
+// the ring is guarded by a fence, so memory is only reused once the GPU has
+// read it.
+//
+// The levels stay in system memory and a texture only has storage for the
+// levels it needs: it is moved to larger storage, copying the levels it has
+// on the GPU, before finer levels are streamed, and to smaller storage when
+// it isn't seen for a while and the budget is full. The GL name of a shared
+// texture therefore changes, so read it when binding. Must be used on the
+// thread owning the GL context.
+class TextureUploader
+{
+public:
+    // Staging memory split into regions, and the largest width and height
+    // of the levels uploaded at once
+    TextureUploader(size_t stagingBytes = 16u << 20, unsigned int regions = 4, int tailSize = 64);
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader &) = delete;
+    TextureUploader &operator=(const TextureUploader &) = delete;
+
+    // Create the GL texture of a shared texture and stream its levels. The
+    // levels are dropped once the texture is released. The shared overloads
+    // keep a reference to levels that may also be used elsewhere.
+    void upload(const std::shared_ptr<SharedTexture> &texture, MipChain chain,
+                const TextureSampling &sampling = TextureSampling());
+    void upload(const std::shared_ptr<SharedTexture> &texture, CompressedTexture compressed,
+                const TextureSampling &sampling = TextureSampling());
+    void upload(const std::shared_ptr<SharedTexture> &texture, const std::shared_ptr<const MipChain> &chain,
+                const TextureSampling &sampling = TextureSampling());
+    void upload(const std::shared_ptr<SharedTexture> &texture,
+                const std::shared_ptr<const CompressedTexture> &compressed,
+                const TextureSampling &sampling = TextureSampling());
+
+    // Mark a texture as seen this frame with its full width covering about
+    // screenSize pixels, asking for the level with a texel per pixel when
+    // streaming on demand. Textures seen by several models keep the finest
+    // level asked for.
+    void request(const std::shared_ptr<const SharedTexture> &texture, float screenSize);
+
+    // Change which levels are kept, applied from the next update
+    void setResidency(const TextureResidency &residency) { this->residency = residency; }
+    const TextureResidency &getResidency() const { return residency; }
+
+    // Free and copy levels, copying up to a number of bytes. Call once a
+    // frame. Returns the bytes copied.
+    size_t update(size_t budgetBytes = 4u << 20);
+
+    // Copy everything asked for, waiting for the GPU when the ring is full
+    void finish();
+
+    // Number of textures with levels asked for but not yet copied
+    size_t pending() const;
+
+    // Current counters
+    const TextureUploadStats &stats() const { return counters; }
+
+    // Uploader shared by the whole program
+    static TextureUploader &global();
+
+private:
+    // Levels of a streamed texture. The GL texture only has storage for the
+    // levels from top down, its level 0 being level top of the source, and
+    // is replaced to change that. Rows are texel rows, or rows of 4x4 blocks
+    // for compressed formats.
+    struct Entry
+    {
+        std::weak_ptr<SharedTexture>        texture;
+        std::shared_ptr<const void>         owner;      // keeps levels alive
+        const std::vector<std::vector<uint8_t>> *levels = NULL;
+        int    width  = 0;
+        int    height = 0;
+        GLenum internalFormat = 0;  // sized or compressed
+        GLenum format = 0;          // pixel format and type, type is 0 when
+        GLenum type   = 0;          // compressed
+        size_t texelBytes = 0;      // or bytes of a 4x4 block when compressed
+        TextureSampling sampling;
+        bool   swizzleRed = false;
+        int    levelCount = 0;      // levels sampled
+        int    tail     = 0;        // coarsest level streamed after creation
+        int    top      = 0;        // finest level allocated
+        int    resident = 0;        // finest complete level, the base level
+        int    wanted   = 0;        // finest level asked for
+        int    row      = 0;        // rows of level resident - 1 copied
+        size_t lastUsed = 0;        // frame of the last request
+        size_t order    = 0;        // upload order
+        size_t bytes    = 0;        // video memory of the levels allocated
+    };
+
+    size_t           stagingBytes;
+    unsigned int     regions;
+    int              tailSize;
+    TextureResidency residency;
+
+    GLBuffer             buffer;
+    uint8_t             *mapped = NULL;     // persistent mapping, if any
+    std::vector<GLsync>  fences;            // one per region
+    unsigned int         region = 0;
+    size_t               offset = 0;        // next free byte of the region
+    bool                 dirty = false;     // region written since its fence
+    bool                 stalled = false;
+
+    std::unordered_map<const SharedTexture *, Entry> entries;
+    size_t             frame = 0;
+    size_t             uploads = 0;
+    TextureUploadStats counters;
+
+    // Free and copy levels without starting a new frame
+    size_t stream(size_t budgetBytes);
+
+    // Start streaming a texture: allocate and upload its mip tail
+    void createTexture(const std::shared_ptr<SharedTexture> &texture, Entry &entry);
+
+    // New GL texture with storage for the levels from top down, sampling
+    // from base
+    GLTexture allocate(const Entry &entry, int top, int base);
+
+    // Move a texture to storage from another top level, keeping the levels
+    // both have. Expects an unpack alignment of 1.
+    void reallocate(Entry &entry, int top);
+
+    // Free levels of textures used before a frame, least recently used
+    // first, and levels finer than asked for of the others, until bytes are
+    // freed. Frees nothing and returns false if that isn't possible. Expects
+    // an unpack alignment of 1.
+    bool evict(size_t bytes, size_t before, const Entry *keep);
+
+    // Level whose width covers screenSize pixels at about a texel a pixel
+    int levelForSize(const Entry &entry, float screenSize) const;
+
+    // Copy rows of a level to the bound texture from client memory, or from
+    // the bound pixel buffer if pixels is an offset into it
+    void copyRows(const Entry &entry, int level, int row, int rows, const void *pixels, size_t bytes);
+
+    // Width, rows, bytes per row and video memory of a level, and the video
+    // memory of the levels from top down
+    int    levelWidth(const Entry &entry, int level) const;
+    int    levelHeight(const Entry &entry, int level) const;
+    int    levelRows(const Entry &entry, int level) const;
+    size_t rowBytes(const Entry &entry, int level) const;
+    size_t levelBytes(const Entry &entry, int level) const;
+    size_t storageBytes(const Entry &entry, int top) const;
+
+    // Create the staging buffer the first time it's needed
+    void createStaging();
+
+    // Find room for bytes in the ring, moving on to the next region if the
+    // current one is full. Returns false if that region is still in use.
+    bool reserve(size_t bytes, size_t &at);
+
+    // Fence the region being written
+    void fenceRegion();
+};
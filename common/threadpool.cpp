@@ -0,0 +1,113 @@
+#include <atomic>
+
+#include "threadpool.hpp"
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+    if (numThreads == 0)
+        numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0)
+        numThreads = 1;
+
+    for (unsigned int i = 0; i < numThreads; i++)
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+// Shared state of a parallelFor call. Helpers that start after all the work
+// has been claimed simply return, so the caller never waits on a queued task.
+struct ParallelForState
+{
+    std::function<void(size_t)> task;
+    size_t                      count;
+    std::atomic<size_t>         next;
+    std::atomic<size_t>         done;
+    std::mutex                  mutex;
+    std::condition_variable     finished;
+
+    void run()
+    {
+        size_t completed = 0;
+        for (size_t i = next++; i < count; i = next++)
+        {
+            task(i);
+            completed++;
+        }
+        if (completed > 0 && (done += completed) == count)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+        }
+    }
+};
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &task)
+{
+    if (count == 0)
+        return;
+    if (count == 1 || workers.empty())
+    {
+        for (size_t i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->task  = task;
+    state->count = count;
+    state->next  = 0;
+    state->done  = 0;
+
+    // Wake enough helpers for the remaining iterations
+    size_t numHelpers = count - 1 < workers.size() ? count - 1 : workers.size();
+    for (size_t i = 0; i < numHelpers; i++)
+        enqueue([state]() { state->run(); });
+
+    // Work on this thread too, then wait for the helpers to finish
+    state->run();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state]() { return state->done == state->count; });
+}
+
+ThreadPool &ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <memory>
+
+// Fixed size pool of worker threads
+class ThreadPool
+{
+public:
+    // Constructor, 0 threads means one per hardware core
+    ThreadPool(unsigned int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Number of worker threads
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+    // Queue a task and return a future for its result
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F task)
+    {
+        typedef typename std::result_of<F()>::type Result;
+        std::shared_ptr<std::packaged_task<Result()>> packaged =
+            std::make_shared<std::packaged_task<Result()>>(task);
+        std::future<Result> result = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return result;
+    }
+
+    // Run task(i) for every i in [0, count) across the pool. The calling
+    // thread takes part, so this is safe to call from inside a pool task.
+    void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+    // Pool shared by the whole program
+    static ThreadPool &global();
+
+private:
+    std::vector<std::thread>          workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex                        mutex;
+    std::condition_variable           condition;
+    bool                              stopping = false;
+
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+};
@@ -0,0 +1,183 @@
+#include <string.h>
+#include <math.h>
+
+#include "vertexformat.hpp"
+
+size_t vertexSize(VertexFormat format)
+{
+    return format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(StandardVertex);
+}
+
+size_t indexSize(size_t numVertices)
+{
+    return numVertices <= 0xFFFF ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void packIndices(const unsigned int *indices, size_t numIndices, size_t numVertices,
+                 std::vector<unsigned char> &outIndices)
+{
+    outIndices.resize(numIndices * indexSize(numVertices));
+    if (indexSize(numVertices) == sizeof(uint32_t))
+    {
+        memcpy(outIndices.data(), indices, outIndices.size());
+        return;
+    }
+    uint16_t *shortIndices = reinterpret_cast<uint16_t *>(outIndices.data());
+    for (size_t i = 0; i < numIndices; i++)
+        shortIndices[i] = static_cast<uint16_t>(indices[i]);
+}
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+
+    uint32_t sign     = (bits >> 16) & 0x8000u;
+    uint32_t exponent = (bits >> 23) & 0xFFu;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+
+    // Infinity and NaN
+    if (exponent == 0xFFu)
+        return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+
+    int halfExponent = static_cast<int>(exponent) - 127 + 15;
+
+    // Overflow to infinity
+    if (halfExponent >= 31)
+        return static_cast<uint16_t>(sign | 0x7C00u);
+
+    // Denormals and underflow to zero
+    if (halfExponent <= 0)
+    {
+        if (halfExponent < -10)
+            return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+        uint32_t half  = mantissa >> shift;
+        uint32_t rest  = mantissa & ((1u << shift) - 1u);
+        uint32_t middle = 1u << (shift - 1);
+        if (rest > middle || (rest == middle && (half & 1u)))
+            half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Normal numbers, rounded to nearest even. A carry out of the mantissa
+    // correctly increments the exponent.
+    uint32_t half = sign | (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFFu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+        half++;
+    return static_cast<uint16_t>(half);
+}
+
+float halfToFloat(uint16_t value)
+{
+    uint32_t sign     = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1Fu;
+    uint32_t mantissa = value & 0x3FFu;
+    uint32_t bits;
+
+    if (exponent == 0x1Fu)
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    else if (exponent != 0)
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    else if (mantissa != 0)
+    {
+        // Normalise the denormal
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400u) == 0)
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+    }
+    else
+        bits = sign;
+
+    float result;
+    memcpy(&result, &bits, 4);
+    return result;
+}
+
+static inline float signNotZero(float x)
+{
+    return x >= 0.0f ? 1.0f : -1.0f;
+}
+
+glm::vec2 octEncode(const glm::vec3 &n)
+{
+    float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    if (l1 == 0.0f)
+        return glm::vec2(0.0f, 0.0f);
+
+    glm::vec2 p(n.x / l1, n.y / l1);
+    if (n.z < 0.0f)
+        p = glm::vec2((1.0f - fabsf(p.y)) * signNotZero(p.x),
+                      (1.0f - fabsf(p.x)) * signNotZero(p.y));
+    return p;
+}
+
+glm::vec3 octDecode(const glm::vec2 &e)
+{
+    glm::vec3 n(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+    if (n.z < 0.0f)
+    {
+        float x = n.x;
+        n.x = (1.0f - fabsf(n.y)) * signNotZero(x);
+        n.y = (1.0f - fabsf(x)) * signNotZero(n.y);
+    }
+    return glm::normalize(n);
+}
+
+// Round a value in [-1, 1] to a normalised signed integer
+static inline int quantizeSigned(float value, int maximum)
+{
+    value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+    return static_cast<int>(floorf(value * maximum + 0.5f));
+}
+
+void interleaveVertices(VertexFormat format, const MeshStreams &mesh,
+                        std::vector<unsigned char> &outVertices)
+{
+    outVertices.resize(mesh.numVertices * vertexSize(format));
+
+    if (format == VertexFormat::Standard)
+    {
+        StandardVertex *vertices = reinterpret_cast<StandardVertex *>(outVertices.data());
+        for (size_t i = 0; i < mesh.numVertices; i++)
+        {
+            vertices[i].position  = mesh.positions[i];
+            vertices[i].uv        = mesh.uvs[i];
+            vertices[i].normal    = mesh.normals[i];
+            vertices[i].tangent   = mesh.tangents[i];
+            vertices[i].bitangent = mesh.bitangents[i];
+        }
+        return;
+    }
+
+    CompactVertex *vertices = reinterpret_cast<CompactVertex *>(outVertices.data());
+    for (size_t i = 0; i < mesh.numVertices; i++)
+    {
+        CompactVertex &vertex = vertices[i];
+        vertex.position = mesh.positions[i];
+        vertex.uv[0]    = floatToHalf(mesh.uvs[i].x);
+        vertex.uv[1]    = floatToHalf(mesh.uvs[i].y);
+
+        glm::vec2 normal = octEncode(mesh.normals[i]);
+        vertex.normal[0] = static_cast<int16_t>(quantizeSigned(normal.x, 32767));
+        vertex.normal[1] = static_cast<int16_t>(quantizeSigned(normal.y, 32767));
+
+        // The bitangent is rebuilt in the shader as sign * cross(normal, tangent)
+        glm::vec3 n = mesh.normals[i];
+        glm::vec3 t = mesh.tangents[i];
+        glm::vec3 b = mesh.bitangents[i];
+        float sign = glm::dot(glm::cross(n, t), b) < 0.0f ? -1.0f : 1.0f;
+
+        glm::vec2 tangent = octEncode(t);
+        vertex.tangent[0] = static_cast<int8_t>(quantizeSigned(tangent.x, 127));
+        vertex.tangent[1] = static_cast<int8_t>(quantizeSigned(tangent.y, 127));
+        vertex.tangent[2] = static_cast<int8_t>(quantizeSigned(sign, 127));
+        vertex.tangent[3] = 0;
+    }
+}
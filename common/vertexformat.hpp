@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// Range of the index buffer holding one level of detail, and the object
+// space error of its simplification
+struct MeshLod
+{
+    uint32_t offset;
+    uint32_t count;
+    float    error;
+};
+
+// Pointers to the vertex attribute and index arrays of a mesh. The index
+// array holds every level of detail one after another.
+struct MeshStreams
+{
+    size_t numVertices = 0;
+    size_t numIndices  = 0;
+    size_t numLods     = 0;
+    const glm::vec3    *positions  = NULL;
+    const glm::vec2    *uvs        = NULL;
+    const glm::vec3    *normals    = NULL;
+    const glm::vec3    *tangents   = NULL;
+    const glm::vec3    *bitangents = NULL;
+    const unsigned int *indices    = NULL;
+    const MeshLod      *lods       = NULL;
+};
+
+// Contents of a model's vertex and index buffers, ready to upload
+struct MeshBuffers
+{
+    const void *vertices    = NULL;
+    size_t      vertexBytes = 0;
+    const void *indices     = NULL;
+    size_t      indexBytes  = 0;
+    size_t      indexSize   = 0;        // 2 or 4 bytes per index
+};
+
+// Layout of the interleaved vertex buffer of a model
+//
+// Standard: 56 bytes, full floats for every attribute
+//   location 0  vec3 position
+//   location 1  vec2 uv
+//   location 2  vec3 normal
+//   location 3  vec3 tangent
+//   location 4  vec3 bitangent
+//
+// Compact: 24 bytes, needs the decode functions in the vertex shader
+//   location 0  vec3 position      3 x float
+//   location 1  vec2 uv            2 x half float
+//   location 2  vec2 normal        octahedral, 2 x normalised short
+//   location 3  vec4 tangent       octahedral in xy, 2 x normalised byte, and
+//                                  the bitangent sign in z
+enum class VertexFormat
+{
+    Standard,
+    Compact
+};
+
+struct StandardVertex
+{
+    glm::vec3 position;
+    glm::vec2 uv;
+    glm::vec3 normal;
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
+};
+
+struct CompactVertex
+{
+    glm::vec3 position;
+    uint16_t  uv[2];
+    int16_t   normal[2];
+    int8_t    tangent[4];
+};
+
+// Size in bytes of one vertex
+size_t vertexSize(VertexFormat format);
+
+// Interleave and encode the attribute streams into a vertex buffer
+void interleaveVertices(VertexFormat format, const MeshStreams &mesh,
+                        std::vector<unsigned char> &outVertices);
+
+// Size in bytes of an index into numVertices vertices, 16 bits when they
+// are big enough
+size_t indexSize(size_t numVertices);
+
+// Copy indices into an index buffer of indexSize(numVertices) byte indices
+void packIndices(const unsigned int *indices, size_t numIndices, size_t numVertices,
+                 std::vector<unsigned char> &outIndices);
+
+// IEEE half precision conversion
+uint16_t floatToHalf(float value);
+float    halfToFloat(uint16_t value);
+
+// Octahedral encoding of a unit vector into [-1, 1]^2
+glm::vec2 octEncode(const glm::vec3 &n);
+glm::vec3 octDecode(const glm::vec2 &e);
@@ -0,0 +1,61 @@
+#include <common/viewbuffer.hpp>
+#include <common/shaderprogram.hpp>
+
+static_assert(sizeof(ViewBlock) == 6 * 64, "ViewBlock must match the std140 layout of View");
+
+// Inverse of a view matrix made of a rotation and a translation, as both of
+// Camera's are, without a general 4x4 inverse
+static glm::mat4 inverseRigid(const glm::mat4 &view)
+{
+    glm::mat3 rotation = glm::transpose(glm::mat3(view));
+    glm::mat4 inverse(rotation);
+    inverse[3] = glm::vec4(-(rotation * glm::vec3(view[3])), 1.0f);
+    return inverse;
+}
+
+bool ViewBuffer::update(const Camera &camera)
+{
+    // Every program reads the camera from the same binding point
+    static bool blockBound = false;
+    if (!blockBound)
+    {
+        ShaderProgram::bindBlock("View", binding);
+        blockBound = true;
+    }
+    
+    // Make the buffer the first time
+    if (!buffer)
+    {
+        buffer = GLBuffer::create();
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(ViewBlock), NULL, GL_DYNAMIC_DRAW);
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer.get());
+    
+    if (uploaded && camera.revision == revision)
+        return false;
+    
+    // The projection's inverse only changes with the projection
+    if (!uploaded || camera.projection() != block.projection)
+    {
+        block.projection        = camera.projection();
+        block.inverseProjection = glm::inverse(camera.projection());
+    }
+    block.view                  = camera.view();
+    block.viewProjection        = camera.projection() * camera.view();
+    block.inverseView           = inverseRigid(camera.view());
+    block.inverseViewProjection = block.inverseView * block.inverseProjection;
+    
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ViewBlock), &block);
+    uploaded = true;
+    revision = camera.revision;
+    uploads++;
+    return true;
+}
+
+void ViewBuffer::deleteBuffers()
+{
+    buffer.reset();
+    uploaded = false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <common/camera.hpp>
+#include <common/glhandle.hpp>
+
+// The matrices of a camera as the shaders' View uniform block holds them,
+// in std140 layout
+struct ViewBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseView;
+    glm::mat4 inverseProjection;
+    glm::mat4 inverseViewProjection;
+};
+
+// A uniform buffer with the matrices of a camera, bound to the binding
+// point shared by every program so that objects only send their model
+// matrix. It is uploaded again only when the camera changes.
+class ViewBuffer
+{
+public:
+    // Binding point of the View block in every program
+    static const unsigned int binding = 1;
+    
+    // What the buffer holds
+    ViewBlock block;
+    
+    // Number of uploads so far
+    size_t uploads = 0;
+    
+    // Upload the camera's matrices unless the buffer has them already,
+    // returns whether it uploaded
+    bool update(const Camera &camera);
+    
+    // Delete the uniform buffer
+    void deleteBuffers();
+    
+private:
+    GLBuffer buffer;
+    bool uploaded = false;
+    unsigned int revision = 0;      // of the camera when last uploaded
+};